@@ -0,0 +1,132 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+
+namespace {
+
+// resetAll()のために、生きているスレッドのアリーナを覚えておく
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<FrameArena*>& registry() {
+    static std::vector<FrameArena*> arenas;
+    return arenas;
+}
+
+struct ThreadArena {
+    FrameArena arena;
+    ThreadArena() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(&arena);
+    }
+    ~ThreadArena() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto& arenas = registry();
+        arenas.erase(std::remove(arenas.begin(), arenas.end(), &arena), arenas.end());
+    }
+};
+
+} // namespace
+
+FrameArena::FrameArena(size_t blockSize, std::pmr::memory_resource* upstream)
+    : upstream_(upstream), blockSize_(blockSize), current_(0), offset_(0) {}
+
+FrameArena::~FrameArena() {
+    releaseBlocks();
+}
+
+FrameArena::Marker FrameArena::mark() const noexcept {
+    return Marker{current_, offset_};
+}
+
+void FrameArena::rewind(const Marker& marker) noexcept {
+    current_ = marker.block;
+    offset_ = marker.offset;
+}
+
+void FrameArena::reset() {
+    if (blocks_.size() > 1) {
+        size_t total = 0;
+        for (const Block& block : blocks_) {
+            total += block.size;
+        }
+        releaseBlocks();
+        addBlock(total);
+    }
+    current_ = 0;
+    offset_ = 0;
+}
+
+size_t FrameArena::getUsedBytes() const noexcept {
+    size_t used = offset_;
+    for (size_t i = 0; i < current_ && i < blocks_.size(); ++i) {
+        used += blocks_[i].size;
+    }
+    return used;
+}
+
+size_t FrameArena::getCapacity() const noexcept {
+    size_t capacity = 0;
+    for (const Block& block : blocks_) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+FrameArena& FrameArena::threadLocal() {
+    thread_local ThreadArena threadArena;
+    return threadArena.arena;
+}
+
+void FrameArena::resetAll() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (FrameArena* arena : registry()) {
+        arena->reset();
+    }
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    if (blocks_.empty()) {
+        addBlock(bytes + alignment);
+    }
+    for (;;) {
+        Block& block = blocks_[current_];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+        const uintptr_t aligned = (base + offset_ + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        const size_t end = static_cast<size_t>(aligned - base) + bytes;
+        if (end <= block.size) {
+            offset_ = end;
+            return reinterpret_cast<void*>(aligned);
+        }
+        // 前のフレームで増やしたブロックが残っていればそれを使い、無ければ足す
+        if (current_ + 1 >= blocks_.size()) {
+            addBlock(bytes + alignment);
+        }
+        ++current_;
+        offset_ = 0;
+    }
+}
+
+void FrameArena::do_deallocate(void*, size_t, size_t) {
+    // 個別には解放しない (reset()かrewind()でまとめて戻す)
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void FrameArena::addBlock(size_t minimumSize) {
+    const size_t size = std::max(blockSize_, minimumSize);
+    unsigned char* data = static_cast<unsigned char*>(upstream_->allocate(size, alignof(std::max_align_t)));
+    blocks_.push_back(Block{data, size});
+}
+
+void FrameArena::releaseBlocks() noexcept {
+    for (const Block& block : blocks_) {
+        upstream_->deallocate(block.data, block.size, alignof(std::max_align_t));
+    }
+    blocks_.clear();
+}
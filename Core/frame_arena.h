@@ -0,0 +1,84 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// フレーム単位で使い捨てるメモリのためのバンプアロケータ (std::pmr::memory_resource)
+// 確保はポインタを進めるだけで、個別の解放は何もしない。reset()でまとめて巻き戻す。
+// スレッドごとに1つ持たせるので、確保でロックを取ることはない。
+//
+//   std::pmr::vector<float> scratch(&FrameArena::threadLocal());
+//
+// 注意:
+// - アリーナから確保したコンテナは、作ったスレッドの中でだけ伸ばすこと (解放はどのスレッドでもよい)
+// - メモリはresetAll()まで有効。フレームをまたいで持ち越さないこと
+class FrameArena : public std::pmr::memory_resource {
+public:
+    explicit FrameArena(size_t blockSize = 1 << 20,
+                        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~FrameArena() override;
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // 確保位置の目印。rewind()でそこまで巻き戻せる
+    struct Marker {
+        size_t block;
+        size_t offset;
+    };
+    Marker mark() const noexcept;
+    void rewind(const Marker& marker) noexcept;
+
+    // すべて巻き戻す。複数のブロックを使っていたら、次からは1つで足りる大きさにまとめる
+    void reset();
+
+    // 今使っているバイト数と、確保済みの容量
+    size_t getUsedBytes() const noexcept;
+    size_t getCapacity() const noexcept;
+
+    // このスレッドのアリーナ
+    static FrameArena& threadLocal();
+    // すべてのスレッドのアリーナをreset()する
+    // フレームの終わりなど、どのスレッドもアリーナを使っていないときに呼ぶこと
+    static void resetAll();
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    struct Block {
+        unsigned char* data;
+        size_t size;
+    };
+
+    void addBlock(size_t minimumSize);
+    void releaseBlocks() noexcept;
+
+    std::pmr::memory_resource* upstream_;
+    size_t blockSize_;
+    std::vector<Block> blocks_;
+    size_t current_;    // 使用中のブロック
+    size_t offset_;     // 使用中のブロック内の位置
+};
+
+// スコープを抜けるとアリーナをスコープに入る前の位置へ戻す
+// 関数内の作業領域を、フレームの終わりを待たずに返したいときに使う
+class ArenaScope {
+public:
+    explicit ArenaScope(FrameArena& arena = FrameArena::threadLocal()) noexcept
+        : arena_(arena), marker_(arena.mark()) {}
+    ~ArenaScope() { arena_.rewind(marker_); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    FrameArena& arena() noexcept { return arena_; }
+
+private:
+    FrameArena& arena_;
+    FrameArena::Marker marker_;
+};
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,449 @@
+#include "job_system.h"
+#include "object_pool.h"
+#include <algorithm>
+#include <exception>
+
+struct Job {
+    std::function<void()> task;
+    // ハンドル・キュー・継続リスト・子がそれぞれ1つずつ持つ
+    std::atomic<int> refCount{1};
+    // 未完了の依存先の数 + 積み終わるまでのガード1
+    std::atomic<int> pendingDependencies{1};
+    // 自分 + 未完了の子の数
+    std::atomic<int> unfinished{1};
+    std::atomic<bool> finished{false};
+    Job* parent = nullptr;
+    // parallelForの区間 (forStateがあればtaskの代わりにこちらを実行する)
+    JobSystem::ParallelForState* forState = nullptr;
+    size_t rangeBegin = 0;
+    size_t rangeEnd = 0;
+
+    std::mutex mutex;           // continuationsとdoneを守る
+    bool done = false;
+    std::vector<Job*> continuations;
+    std::exception_ptr exception;
+};
+
+namespace {
+
+void retain(Job* job) noexcept {
+    job->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void release(Job* job) noexcept {
+    if (job->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        ObjectPool<Job>::destroy(job);
+    }
+}
+
+// 今のスレッドがどのJobSystemの何番目のワーカーか
+thread_local const JobSystem* currentSystem = nullptr;
+thread_local size_t currentWorker = 0;
+thread_local uint32_t stealSeed = 0x9e3779b9u;
+
+uint32_t nextRandom() noexcept {
+    // xorshift32
+    uint32_t x = stealSeed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    stealSeed = x;
+    return x;
+}
+
+} // namespace
+
+// Chase-Levのワークスティーリングデック (固定容量)
+// pushとtakeは所有ワーカーだけが末尾(bottom)で行い、stealは他のスレッドが先頭(top)から行う。
+// メモリ順序は Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models" (2013) に従う。
+class WorkStealingDeque {
+public:
+    static constexpr int64_t CAPACITY = 1 << 12;
+
+    bool push(Job* job) noexcept {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY) {
+            return false;
+        }
+        buffer_[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    Job* take() noexcept {
+        const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job* job = buffer_[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // 最後の1つはstealと取り合いになる
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* steal() noexcept {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        Job* job = buffer_[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    alignas(64) std::atomic<Job*> buffer_[CAPACITY] = {};
+};
+
+struct JobSystem::ParallelForState {
+    const std::function<void(size_t, size_t)>& fn;
+    size_t grain;
+    std::mutex mutex;
+    std::exception_ptr exception;
+};
+
+// JobHandle
+JobHandle::JobHandle(const JobHandle& other) noexcept : job_(other.job_) {
+    if (job_) {
+        retain(job_);
+    }
+}
+
+JobHandle::JobHandle(JobHandle&& other) noexcept : job_(other.job_) {
+    other.job_ = nullptr;
+}
+
+JobHandle& JobHandle::operator=(const JobHandle& other) noexcept {
+    if (this != &other) {
+        if (other.job_) {
+            retain(other.job_);
+        }
+        if (job_) {
+            release(job_);
+        }
+        job_ = other.job_;
+    }
+    return *this;
+}
+
+JobHandle& JobHandle::operator=(JobHandle&& other) noexcept {
+    if (this != &other) {
+        if (job_) {
+            release(job_);
+        }
+        job_ = other.job_;
+        other.job_ = nullptr;
+    }
+    return *this;
+}
+
+JobHandle::~JobHandle() {
+    if (job_) {
+        release(job_);
+    }
+}
+
+bool JobHandle::isDone() const noexcept {
+    return job_ == nullptr || job_->finished.load(std::memory_order_acquire);
+}
+
+// JobSystem
+JobSystem::JobSystem(size_t workerCount)
+    : injectedCount_(0), workEpoch_(0), sleepers_(0), stopping_(false) {
+    if (workerCount == 0) {
+        const unsigned hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+    deques_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        deques_.push_back(std::make_unique<WorkStealingDeque>());
+    }
+    workers_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers_.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_.store(true);
+    }
+    sleepCondition_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+JobSystem& JobSystem::instance() {
+    static JobSystem system;
+    return system;
+}
+
+JobHandle JobSystem::schedule(std::function<void()> task) {
+    return schedule(std::move(task), nullptr, 0);
+}
+
+JobHandle JobSystem::schedule(std::function<void()> task, std::initializer_list<JobHandle> dependencies) {
+    return schedule(std::move(task), dependencies.begin(), dependencies.size());
+}
+
+JobHandle JobSystem::schedule(std::function<void()> task, const std::vector<JobHandle>& dependencies) {
+    return schedule(std::move(task), dependencies.data(), dependencies.size());
+}
+
+JobHandle JobSystem::then(const JobHandle& job, std::function<void()> continuation) {
+    return schedule(std::move(continuation), &job, 1);
+}
+
+JobHandle JobSystem::schedule(std::function<void()> task, const JobHandle* dependencies, size_t count) {
+    Job* job = createJob(std::move(task), nullptr);
+    JobHandle handle(job);
+    addDependencies(job, dependencies, count);
+    // ガードを外す。依存先がすべて終わっていればここで積む
+    if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        retain(job);
+        enqueue(job);
+    }
+    return handle;
+}
+
+void JobSystem::wait(const JobHandle& handle) {
+    Job* job = handle.job_;
+    if (!job) {
+        return;
+    }
+    while (!job->finished.load(std::memory_order_acquire)) {
+        if (!runOne()) {
+            std::this_thread::yield();
+        }
+    }
+    if (job->exception) {
+        std::rethrow_exception(job->exception);
+    }
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grain,
+                            const std::function<void(size_t, size_t)>& fn) {
+    if (end <= begin) {
+        return;
+    }
+    const size_t count = end - begin;
+    if (grain == 0) {
+        // 盗み合いで負荷を均せるよう、スレッドあたり8チャンク程度にする
+        grain = std::max<size_t>(1, count / (getConcurrency() * 8));
+    }
+    if (count <= grain) {
+        fn(begin, end);
+        return;
+    }
+
+    ParallelForState state{fn, grain, {}, {}};
+    // rootはどのキューにも積まず、呼び出し側が最初の区間を実行してから完了を待つ
+    Job* root = createJob(nullptr, nullptr);
+    JobHandle handle(root);
+    splitRange(state, begin, end, root);
+    finish(root);
+    wait(handle);
+    if (state.exception) {
+        std::rethrow_exception(state.exception);
+    }
+}
+
+void JobSystem::splitRange(ParallelForState& state, size_t begin, size_t end, Job* root) {
+    // 後半を子として積み、前半を自分で続ける
+    while (end - begin > state.grain) {
+        const size_t middle = begin + (end - begin) / 2;
+        // 区間はジョブに直接持たせ、std::functionを作らない
+        Job* child = createJob(nullptr, root);
+        child->forState = &state;
+        child->rangeBegin = middle;
+        child->rangeEnd = end;
+        child->pendingDependencies.store(0, std::memory_order_relaxed);
+        enqueue(child);
+        end = middle;
+    }
+    try {
+        state.fn(begin, end);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.exception) {
+            state.exception = std::current_exception();
+        }
+    }
+}
+
+Job* JobSystem::createJob(std::function<void()> task, Job* parent) {
+    Job* job = ObjectPool<Job>::create();
+    job->task = std::move(task);
+    if (parent) {
+        // 子が終わるまで親は完了しない
+        parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+        retain(parent);
+        job->parent = parent;
+    }
+    return job;
+}
+
+void JobSystem::addDependencies(Job* job, const JobHandle* dependencies, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        Job* dependency = dependencies[i].job_;
+        if (!dependency) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->done) {
+            continue;
+        }
+        job->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+        retain(job);
+        dependency->continuations.push_back(job);
+    }
+}
+
+// jobの参照を1つキューに渡す
+void JobSystem::enqueue(Job* job) {
+    const bool isWorker = currentSystem == this;
+    if (!isWorker || !deques_[currentWorker]->push(job)) {
+        if (isWorker) {
+            // デックが満杯ならその場で実行する
+            execute(job);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(injectMutex_);
+        injected_.push_back(job);
+        injectedCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // 眠っているワーカーがいれば起こす (workEpoch_とsleepers_はseq_cstで順序を保証する)
+    workEpoch_.fetch_add(1);
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        sleepCondition_.notify_one();
+    }
+}
+
+void JobSystem::execute(Job* job) {
+    if (job->forState) {
+        splitRange(*job->forState, job->rangeBegin, job->rangeEnd, job->parent);
+    } else if (job->task) {
+        try {
+            job->task();
+        } catch (...) {
+            job->exception = std::current_exception();
+        }
+    }
+    finish(job);
+    release(job);
+}
+
+void JobSystem::finish(Job* job) {
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    std::vector<Job*> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
+        continuations.swap(job->continuations);
+    }
+    job->task = nullptr;
+    job->finished.store(true, std::memory_order_release);
+
+    for (Job* continuation : continuations) {
+        // 継続リストが持っていた参照はそのままキューへ渡す
+        if (continuation->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            enqueue(continuation);
+        } else {
+            release(continuation);
+        }
+    }
+    if (Job* parent = job->parent) {
+        finish(parent);
+        release(parent);
+    }
+}
+
+Job* JobSystem::findJob() {
+    const bool isWorker = currentSystem == this;
+    if (isWorker) {
+        if (Job* job = deques_[currentWorker]->take()) {
+            return job;
+        }
+    }
+    if (injectedCount_.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(injectMutex_);
+        if (!injected_.empty()) {
+            Job* job = injected_.front();
+            injected_.pop_front();
+            injectedCount_.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    // ランダムな位置から順に盗みに行く
+    const size_t count = deques_.size();
+    const size_t start = nextRandom() % count;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t victim = (start + i) % count;
+        if (isWorker && victim == currentWorker) {
+            continue;
+        }
+        if (Job* job = deques_[victim]->steal()) {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+bool JobSystem::runOne() {
+    Job* job = findJob();
+    if (!job) {
+        return false;
+    }
+    execute(job);
+    return true;
+}
+
+void JobSystem::workerLoop(size_t index) {
+    currentSystem = this;
+    currentWorker = index;
+    stealSeed = 0x9e3779b9u * static_cast<uint32_t>(index + 1);
+
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        const uint64_t epoch = workEpoch_.load();
+        if (runOne()) {
+            continue;
+        }
+        // 少し回ってから眠る
+        bool found = false;
+        for (int spin = 0; spin < 64 && !found; ++spin) {
+            std::this_thread::yield();
+            found = runOne();
+        }
+        if (found) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_.fetch_add(1);
+        sleepCondition_.wait(lock, [this, epoch] {
+            return stopping_.load() || workEpoch_.load() != epoch;
+        });
+        sleepers_.fetch_sub(1);
+    }
+    currentSystem = nullptr;
+}
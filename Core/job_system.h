@@ -0,0 +1,106 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+class WorkStealingDeque;
+
+// スケジュールしたジョブへの参照 (コピー可能、参照カウントで寿命を管理する)
+class JobHandle {
+public:
+    JobHandle() noexcept : job_(nullptr) {}
+    JobHandle(const JobHandle& other) noexcept;
+    JobHandle(JobHandle&& other) noexcept;
+    JobHandle& operator=(const JobHandle& other) noexcept;
+    JobHandle& operator=(JobHandle&& other) noexcept;
+    ~JobHandle();
+
+    bool isValid() const noexcept { return job_ != nullptr; }
+    // ジョブ (parallelForなら全チャンク) が終わったか
+    bool isDone() const noexcept;
+
+private:
+    friend class JobSystem;
+    explicit JobHandle(Job* job) noexcept : job_(job) {}
+    Job* job_;
+};
+
+// ワークスティーリング方式のジョブスケジューラ
+// 各ワーカーが自分のデックの末尾で積み下ろしを行い、手が空いたら他のワーカーのデックの先頭から盗む。
+// wait()を呼んだスレッドも待つ間にジョブを実行するので、ジョブの中から入れ子でwait()してよい。
+class JobSystem {
+public:
+    // workerCountが0ならハードウェアスレッド数-1 (呼び出し側のスレッドも働くため)
+    explicit JobSystem(size_t workerCount = 0);
+    // 実行中・待機中のジョブはすべてwait()してから破棄すること
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // プロセス共通のインスタンス
+    static JobSystem& instance();
+
+    size_t getWorkerCount() const noexcept { return workers_.size(); }
+    // 同時に動けるスレッド数 (ワーカー + 呼び出し側)
+    size_t getConcurrency() const noexcept { return workers_.size() + 1; }
+
+    // すぐに実行できるジョブを積む
+    JobHandle schedule(std::function<void()> task);
+    // dependenciesがすべて終わってから実行するジョブを積む
+    JobHandle schedule(std::function<void()> task, std::initializer_list<JobHandle> dependencies);
+    JobHandle schedule(std::function<void()> task, const std::vector<JobHandle>& dependencies);
+    // jobの後に続けて実行する (継続)
+    JobHandle then(const JobHandle& job, std::function<void()> continuation);
+
+    // jobが終わるまで、ほかのジョブを実行しながら待つ
+    // jobの中で投げられた例外はここで投げ直す (依存先が失敗しても継続は実行される)
+    void wait(const JobHandle& job);
+
+    // [begin, end)をgrain個ずつのチャンクに分けてfn(chunkBegin, chunkEnd)を並列に呼ぶ
+    // grainが0なら同時実行数から決める。範囲は二分割しながら積むので、盗まれた側も大きな塊を持っていける。
+    // 最初に投げられた例外を、すべてのチャンクが終わってから投げ直す。
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn);
+
+private:
+    friend struct Job;
+    struct ParallelForState;
+
+    JobHandle schedule(std::function<void()> task, const JobHandle* dependencies, size_t count);
+    Job* createJob(std::function<void()> task, Job* parent);
+    void addDependencies(Job* job, const JobHandle* dependencies, size_t count);
+    void enqueue(Job* job);
+    void execute(Job* job);
+    void finish(Job* job);
+    Job* findJob();
+    bool runOne();
+    void workerLoop(size_t index);
+    void splitRange(ParallelForState& state, size_t begin, size_t end, Job* root);
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques_;
+    // ワーカー以外のスレッドから積まれたジョブ
+    std::mutex injectMutex_;
+    std::deque<Job*> injected_;
+    std::atomic<size_t> injectedCount_;
+
+    // 眠っているワーカーを起こすための仕組み
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCondition_;
+    std::atomic<uint64_t> workEpoch_;
+    std::atomic<size_t> sleepers_;
+    std::atomic<bool> stopping_;
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,70 @@
+#include "object_pool.h"
+#include <algorithm>
+
+FixedSizePool::FixedSizePool(size_t blockSize, size_t blocksPerChunk)
+    : blockSize_(blockSize),
+      blocksPerChunk_(std::max<size_t>(1, blocksPerChunk)),
+      ownerThread_(std::this_thread::get_id()),
+      localFree_(nullptr),
+      remoteFree_(nullptr) {
+    // 空きブロックにはFreeNodeを書き込むので、その大きさは必要
+    const size_t payload = std::max(blockSize, sizeof(FreeNode));
+    const size_t align = alignof(std::max_align_t);
+    stride_ = sizeof(Header) + (payload + align - 1) / align * align;
+}
+
+FixedSizePool::~FixedSizePool() {
+    // 貸し出し中のブロックが残っていても、まとめて返す
+    for (void* chunk : chunks_) {
+        ::operator delete(chunk);
+    }
+}
+
+void* FixedSizePool::allocate() {
+    if (!localFree_) {
+        // ほかのスレッドが返したブロックを一度に引き取る
+        localFree_ = remoteFree_.exchange(nullptr, std::memory_order_acquire);
+        if (!localFree_) {
+            addChunk();
+        }
+    }
+    FreeNode* node = localFree_;
+    localFree_ = node->next;
+    return node;
+}
+
+void FixedSizePool::deallocate(void* p) noexcept {
+    if (!p) {
+        return;
+    }
+    Header* header = reinterpret_cast<Header*>(static_cast<unsigned char*>(p) - sizeof(Header));
+    FixedSizePool* pool = header->owner;
+    FreeNode* node = static_cast<FreeNode*>(p);
+    if (std::this_thread::get_id() == pool->ownerThread_) {
+        node->next = pool->localFree_;
+        pool->localFree_ = node;
+    } else {
+        pool->pushRemote(node);
+    }
+}
+
+void FixedSizePool::addChunk() {
+    unsigned char* chunk = static_cast<unsigned char*>(::operator new(stride_ * blocksPerChunk_));
+    chunks_.push_back(chunk);
+    // 先頭のブロックから順に配られるよう、後ろから積む
+    for (size_t i = blocksPerChunk_; i-- > 0;) {
+        unsigned char* slot = chunk + i * stride_;
+        new (slot) Header{this};
+        FreeNode* node = reinterpret_cast<FreeNode*>(slot + sizeof(Header));
+        node->next = localFree_;
+        localFree_ = node;
+    }
+}
+
+void FixedSizePool::pushRemote(FreeNode* node) noexcept {
+    // 取り出しはexchangeでまとめて行うだけなので、ABAの心配はない
+    FreeNode* head = remoteFree_.load(std::memory_order_relaxed);
+    do {
+        node->next = head;
+    } while (!remoteFree_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+}
@@ -0,0 +1,81 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 同じ大きさのブロックを配るプール
+// 確保は持ち主のスレッドだけが行い、解放はどのスレッドからでもよい。
+// 持ち主以外からの解放はロックなしのリストに積まれ、持ち主の空きリストが尽きたときにまとめて回収する。
+// そのためスレッド間でオブジェクトを受け渡しても、mallocのようにロックを取り合うことはない。
+class FixedSizePool {
+public:
+    explicit FixedSizePool(size_t blockSize, size_t blocksPerChunk = 256);
+    ~FixedSizePool();
+    FixedSizePool(const FixedSizePool&) = delete;
+    FixedSizePool& operator=(const FixedSizePool&) = delete;
+
+    // 持ち主のスレッドからだけ呼ぶこと
+    void* allocate();
+    // allocate()で得たブロックを返す (どのスレッドからでもよい)
+    static void deallocate(void* p) noexcept;
+
+    size_t getBlockSize() const noexcept { return blockSize_; }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+    // ブロックの直前に置き、返却先のプールを覚えておく
+    struct alignas(std::max_align_t) Header {
+        FixedSizePool* owner;
+    };
+
+    void addChunk();
+    void pushRemote(FreeNode* node) noexcept;
+
+    size_t blockSize_;
+    size_t stride_;
+    size_t blocksPerChunk_;
+    std::thread::id ownerThread_;
+    FreeNode* localFree_;
+    std::atomic<FreeNode*> remoteFree_;
+    std::vector<void*> chunks_;
+};
+
+// 型Tのオブジェクトを、スレッドごとのFixedSizePoolから作る
+// スレッドが終わってもプールは解放しない (ほかのスレッドがまだブロックを返してくるかもしれないため)
+template <typename T>
+class ObjectPool {
+public:
+    template <typename... Args>
+    static T* create(Args&&... args) {
+        void* p = pool().allocate();
+        try {
+            return new (p) T(std::forward<Args>(args)...);
+        } catch (...) {
+            FixedSizePool::deallocate(p);
+            throw;
+        }
+    }
+
+    static void destroy(T* object) noexcept {
+        if (object) {
+            object->~T();
+            FixedSizePool::deallocate(object);
+        }
+    }
+
+private:
+    static FixedSizePool& pool() {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned types are not supported");
+        thread_local FixedSizePool* threadPool = new FixedSizePool(sizeof(T));
+        return *threadPool;
+    }
+};
+
+#endif // OBJECT_POOL_H
@@ -0,0 +1,62 @@
+#include "batch_transform.h"
+
+namespace {
+
+// 1チャンクの点の数 (これ以下なら分割しない)
+const size_t TRANSFORM_GRAIN = 4096;
+
+// 行列の要素をローカルに取り出しておくと、ループの中で再読込されずベクトル化されやすい
+template <typename Load, typename Store>
+void transformRange(const Matrix4& matrix, size_t begin, size_t end, Load load, Store store) {
+    const float m00 = matrix.m[0][0], m01 = matrix.m[0][1], m02 = matrix.m[0][2], m03 = matrix.m[0][3];
+    const float m10 = matrix.m[1][0], m11 = matrix.m[1][1], m12 = matrix.m[1][2], m13 = matrix.m[1][3];
+    const float m20 = matrix.m[2][0], m21 = matrix.m[2][1], m22 = matrix.m[2][2], m23 = matrix.m[2][3];
+    for (size_t i = begin; i < end; ++i) {
+        float x, y, z;
+        load(i, x, y, z);
+        store(i,
+              m00 * x + m01 * y + m02 * z + m03,
+              m10 * x + m11 * y + m12 * z + m13,
+              m20 * x + m21 * y + m22 * z + m23);
+    }
+}
+
+void transformPointRange(const Matrix4& matrix, const Vector3* points, Vector3* out, size_t begin, size_t end) {
+    transformRange(matrix, begin, end,
+        [points](size_t i, float& x, float& y, float& z) { x = points[i].x; y = points[i].y; z = points[i].z; },
+        [out](size_t i, float x, float y, float z) { out[i].x = x; out[i].y = y; out[i].z = z; });
+}
+
+void transformPositionRange(const Matrix4& matrix, const float* positions, float* out, size_t begin, size_t end) {
+    transformRange(matrix, begin, end,
+        [positions](size_t i, float& x, float& y, float& z) {
+            x = positions[i * 3]; y = positions[i * 3 + 1]; z = positions[i * 3 + 2];
+        },
+        [out](size_t i, float x, float y, float z) {
+            out[i * 3] = x; out[i * 3 + 1] = y; out[i * 3 + 2] = z;
+        });
+}
+
+} // namespace
+
+void transformPoints(const Matrix4& matrix, const Vector3* points, Vector3* out, size_t count) {
+    transformPointRange(matrix, points, out, 0, count);
+}
+
+void transformPoints(const Matrix4& matrix, const Vector3* points, Vector3* out, size_t count,
+                     JobSystem& jobs) {
+    jobs.parallelFor(0, count, TRANSFORM_GRAIN, [&](size_t begin, size_t end) {
+        transformPointRange(matrix, points, out, begin, end);
+    });
+}
+
+void transformPositions(const Matrix4& matrix, const float* positions, float* out, size_t vertexCount) {
+    transformPositionRange(matrix, positions, out, 0, vertexCount);
+}
+
+void transformPositions(const Matrix4& matrix, const float* positions, float* out, size_t vertexCount,
+                        JobSystem& jobs) {
+    jobs.parallelFor(0, vertexCount, TRANSFORM_GRAIN, [&](size_t begin, size_t end) {
+        transformPositionRange(matrix, positions, out, begin, end);
+    });
+}
@@ -0,0 +1,20 @@
+#ifndef BATCH_TRANSFORM_H
+#define BATCH_TRANSFORM_H
+
+#include <cstddef>
+#include "vector_space.h"
+#include "Core/job_system.h"
+
+// 点列をまとめてアフィン変換する (w=1として扱い、射影除算はしない)
+// pointsとoutは同じ配列でもよい
+void transformPoints(const Matrix4& matrix, const Vector3* points, Vector3* out, size_t count);
+// countが大きいときはjobsで分割して並列に変換する
+void transformPoints(const Matrix4& matrix, const Vector3* points, Vector3* out, size_t count,
+                     JobSystem& jobs);
+
+// xyzが詰まったfloat配列版 (Polygon3Dの頂点配列など)。vertexCountは頂点数
+void transformPositions(const Matrix4& matrix, const float* positions, float* out, size_t vertexCount);
+void transformPositions(const Matrix4& matrix, const float* positions, float* out, size_t vertexCount,
+                        JobSystem& jobs);
+
+#endif // BATCH_TRANSFORM_H
@@ -0,0 +1,283 @@
+#include "conjugate_gradient.h"
+#include <cmath>
+#include <stdexcept>
+#include "operators.h"
+
+namespace {
+
+// 並列に回すときの1チャンクの要素数
+const size_t CG_GRAIN = 8192;
+
+// jobsがあれば並列版、無ければ逐次版を呼ぶ
+double dotWith(const std::vector<double>& a, const std::vector<double>& b, JobSystem* jobs) {
+  return jobs ? dot(a, b, *jobs) : dot(a, b);
+}
+
+void axpyWith(double k, const std::vector<double>& x, std::vector<double>& y, JobSystem* jobs) {
+  if (jobs) {
+    axpy(k, x, y, *jobs);
+  } else {
+    axpy(k, x, y);
+  }
+}
+
+// 行列ベクトル積だけがCSRとBSRで違う
+template <typename Matrix>
+void multiplyWith(const Matrix& a, const std::vector<double>& x, std::vector<double>& y, JobSystem* jobs) {
+  if (jobs) {
+    a.multiply(x, y, *jobs);
+  } else {
+    a.multiply(x, y);
+  }
+}
+
+template <typename Function>
+void forEachRange(size_t count, JobSystem* jobs, const Function& fn) {
+  if (jobs) {
+    jobs->parallelFor(0, count, CG_GRAIN, fn);
+  } else {
+    fn(0, count);
+  }
+}
+
+// IC(0)の下三角因子L (A ≒ L L^T)。各行の最後が対角成分
+struct IncompleteCholeskyFactor {
+  std::vector<size_t> rowOffsets;
+  std::vector<size_t> columns;
+  std::vector<double> values;
+
+  // 対角をshift倍だけ大きくして分解する。途中で対角が正でなくなったらfalse
+  bool factorize(const SparseMatrix& a, double shift) {
+    const size_t n = a.rows();
+    const std::vector<size_t>& offsets = a.getRowOffsets();
+    const std::vector<size_t>& cols = a.getColumnIndices();
+    const std::vector<double>& vals = a.getValues();
+
+    rowOffsets.assign(n + 1, 0);
+    columns.clear();
+    values.clear();
+    // 下三角だけなので、Aの非ゼロ数あれば足りる
+    columns.reserve(a.nonZeros());
+    values.reserve(a.nonZeros());
+    for (size_t i = 0; i < n; ++i) {
+      double diagonal = 0;
+      for (size_t k = offsets[i]; k < offsets[i + 1] && cols[k] <= i; ++k) {
+        if (cols[k] == i) {
+          diagonal = vals[k] * (1 + shift);
+          continue;
+        }
+        // L_ik = (A_ik - Σ_{j<k} L_ij L_kj) / L_kk (行iと行kの共通の列だけを足す)
+        const size_t col = cols[k];
+        double sum = vals[k];
+        size_t p = rowOffsets[i];
+        size_t q = rowOffsets[col];
+        const size_t pEnd = columns.size();
+        const size_t qEnd = rowOffsets[col + 1] - 1;
+        while (p < pEnd && q < qEnd) {
+          if (columns[p] < columns[q]) {
+            ++p;
+          } else if (columns[p] > columns[q]) {
+            ++q;
+          } else {
+            sum -= values[p++] * values[q++];
+          }
+        }
+        columns.push_back(col);
+        values.push_back(sum / values[qEnd]);
+      }
+      for (size_t p = rowOffsets[i]; p < columns.size(); ++p) {
+        diagonal -= values[p] * values[p];
+      }
+      if (!(diagonal > 0)) {
+        return false;
+      }
+      columns.push_back(i);
+      values.push_back(std::sqrt(diagonal));
+      rowOffsets[i + 1] = columns.size();
+    }
+    return true;
+  }
+
+  // z = (L L^T)^-1 r
+  void solve(const std::vector<double>& r, std::vector<double>& z) const {
+    const size_t n = rowOffsets.size() - 1;
+    z = r;
+    // L y = r (前進代入)
+    for (size_t i = 0; i < n; ++i) {
+      double sum = z[i];
+      const size_t last = rowOffsets[i + 1] - 1;
+      for (size_t k = rowOffsets[i]; k < last; ++k) {
+        sum -= values[k] * z[columns[k]];
+      }
+      z[i] = sum / values[last];
+    }
+    // L^T z = y (後退代入。Lを行ごとに読むので、求まった成分を上の行へ押し出していく)
+    for (size_t i = n; i-- > 0;) {
+      const size_t last = rowOffsets[i + 1] - 1;
+      z[i] /= values[last];
+      for (size_t k = rowOffsets[i]; k < last; ++k) {
+        z[columns[k]] -= values[k] * z[i];
+      }
+    }
+  }
+};
+
+class PreconditionerState {
+public:
+  PreconditionerState(const SparseMatrix& a, Preconditioner type) : type_(type) {
+    if (type_ == Preconditioner::IncompleteCholesky) {
+      // 分解が破綻したら対角を少しずつ大きくしてやり直す (Manteuffelのシフト)
+      double shift = 0;
+      for (int attempt = 0; attempt < 8; ++attempt) {
+        if (factor_.factorize(a, shift)) {
+          return;
+        }
+        shift = shift == 0 ? 1e-3 : shift * 10;
+      }
+      // それでも駄目ならJacobiで代用する
+      type_ = Preconditioner::Jacobi;
+    }
+    if (type_ == Preconditioner::Jacobi) {
+      inverseDiagonal_ = a.diagonal();
+      for (double& d : inverseDiagonal_) {
+        d = d != 0 ? 1 / d : 1;
+      }
+    }
+  }
+
+  void apply(const std::vector<double>& r, std::vector<double>& z, JobSystem* jobs) const {
+    switch (type_) {
+    case Preconditioner::None:
+      z = r;
+      break;
+    case Preconditioner::Jacobi:
+      z.resize(r.size());
+      forEachRange(r.size(), jobs, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          z[i] = r[i] * inverseDiagonal_[i];
+        }
+      });
+      break;
+    case Preconditioner::IncompleteCholesky:
+      factor_.solve(r, z);
+      break;
+    }
+  }
+
+private:
+  Preconditioner type_;
+  std::vector<double> inverseDiagonal_;
+  IncompleteCholeskyFactor factor_;
+};
+
+// BSRの前処理はCSRに戻して作る (ブロックの中の0も構造として残るので、IC(0)の非ゼロ構造はブロック単位になる)
+SparseMatrix toCsr(const BlockSparseMatrix& a) {
+  const size_t blockSize = a.getBlockSize();
+  const std::vector<size_t>& offsets = a.getRowOffsets();
+  const std::vector<size_t>& blockColumns = a.getBlockColumns();
+  const std::vector<double>& values = a.getValues();
+  std::vector<Triplet> triplets;
+  triplets.reserve(values.size());
+  for (size_t blockRow = 0; blockRow + 1 < offsets.size(); ++blockRow) {
+    for (size_t k = offsets[blockRow]; k < offsets[blockRow + 1]; ++k) {
+      const double* block = &values[k * blockSize * blockSize];
+      for (size_t i = 0; i < blockSize; ++i) {
+        for (size_t j = 0; j < blockSize; ++j) {
+          triplets.push_back(Triplet{blockRow * blockSize + i, blockColumns[k] * blockSize + j,
+                                     block[i * blockSize + j]});
+        }
+      }
+    }
+  }
+  return SparseMatrix::fromTriplets(a.rows(), a.cols(), triplets);
+}
+
+// 前処理は右辺が0でないと分かってから作る (makePreconditionerはPreconditionerStateを返す)
+template <typename Matrix, typename MakePreconditioner>
+ConjugateGradientResult solve(const Matrix& a, const std::vector<double>& b, std::vector<double>& x,
+                              const ConjugateGradientOptions& options, const MakePreconditioner& makePreconditioner) {
+  const size_t n = a.rows();
+  if (a.cols() != n || b.size() != n) {
+    throw std::invalid_argument("Conjugate gradient needs a square matrix and a matching right-hand side");
+  }
+  if (x.size() != n) {
+    x.assign(n, 0.0);
+  }
+  JobSystem* jobs = options.jobs;
+  ConjugateGradientResult result;
+
+  const double bNorm = std::sqrt(dotWith(b, b, jobs));
+  if (bNorm == 0) {
+    x.assign(n, 0.0);
+    result.converged = true;
+    return result;
+  }
+
+  const PreconditionerState preconditioner = makePreconditioner();
+  std::vector<double> r(n), z(n), p(n), ap(n);
+
+  // r = b - A x
+  multiplyWith(a, x, ap, jobs);
+  forEachRange(n, jobs, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      r[i] = b[i] - ap[i];
+    }
+  });
+  result.relativeResidual = std::sqrt(dotWith(r, r, jobs)) / bNorm;
+  if (result.relativeResidual < options.tolerance) {
+    result.converged = true;
+    return result;
+  }
+
+  preconditioner.apply(r, z, jobs);
+  p = z;
+  double rz = dotWith(r, z, jobs);
+
+  while (result.iterations < options.maxIterations) {
+    multiplyWith(a, p, ap, jobs);
+    const double pap = dotWith(p, ap, jobs);
+    if (!(pap > 0)) {
+      // 正定値でない (または探索方向が0になった)
+      break;
+    }
+    const double alpha = rz / pap;
+    axpyWith(alpha, p, x, jobs);
+    axpyWith(-alpha, ap, r, jobs);
+    ++result.iterations;
+
+    result.relativeResidual = std::sqrt(dotWith(r, r, jobs)) / bNorm;
+    if (result.relativeResidual < options.tolerance) {
+      result.converged = true;
+      break;
+    }
+
+    preconditioner.apply(r, z, jobs);
+    const double rzNext = dotWith(r, z, jobs);
+    const double beta = rzNext / rz;
+    rz = rzNext;
+    // p = z + beta p
+    forEachRange(n, jobs, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        p[i] = z[i] + beta * p[i];
+      }
+    });
+  }
+  return result;
+}
+
+} // namespace
+
+ConjugateGradientResult conjugateGradient(const SparseMatrix& a, const std::vector<double>& b,
+                                          std::vector<double>& x, const ConjugateGradientOptions& options) {
+  return solve(a, b, x, options, [&] { return PreconditionerState(a, options.preconditioner); });
+}
+
+ConjugateGradientResult conjugateGradient(const BlockSparseMatrix& a, const std::vector<double>& b,
+                                          std::vector<double>& x, const ConjugateGradientOptions& options) {
+  return solve(a, b, x, options, [&] {
+    if (options.preconditioner == Preconditioner::None) {
+      return PreconditionerState(SparseMatrix(), Preconditioner::None);
+    }
+    return PreconditionerState(toCsr(a), options.preconditioner);
+  });
+}
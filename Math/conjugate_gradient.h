@@ -0,0 +1,41 @@
+#ifndef CONJUGATE_GRADIENT_H
+#define CONJUGATE_GRADIENT_H
+
+#include <cstddef>
+#include <vector>
+#include "sparse_matrix.h"
+#include "Core/job_system.h"
+
+// 前処理の種類
+enum class Preconditioner {
+  None,
+  Jacobi,              // 対角成分で割る
+  IncompleteCholesky,  // IC(0): Aの下三角と同じ非ゼロ構造に限った不完全コレスキー分解
+};
+
+struct ConjugateGradientOptions {
+  size_t maxIterations = 1000;
+  // 相対残差 |b - Ax| / |b| がこれを下回ったら止める
+  double tolerance = 1e-8;
+  Preconditioner preconditioner = Preconditioner::Jacobi;
+  // 指定すると行列ベクトル積・内積・axpyを並列に行う (IC(0)の前進・後退代入は逐次のまま)
+  JobSystem* jobs = nullptr;
+};
+
+struct ConjugateGradientResult {
+  size_t iterations = 0;
+  double relativeResidual = 0;
+  bool converged = false;
+};
+
+// 対称正定値行列Aについて Ax = b を前処理付き共役勾配法で解く
+// xは初期値として使う (大きさが合わなければ0から始める)
+ConjugateGradientResult conjugateGradient(const SparseMatrix& a, const std::vector<double>& b,
+                                          std::vector<double>& x,
+                                          const ConjugateGradientOptions& options = ConjugateGradientOptions());
+// BSRの行列で解く (行列ベクトル積はBSRのまま。前処理は一度CSRに戻して作る)
+ConjugateGradientResult conjugateGradient(const BlockSparseMatrix& a, const std::vector<double>& b,
+                                          std::vector<double>& x,
+                                          const ConjugateGradientOptions& options = ConjugateGradientOptions());
+
+#endif // CONJUGATE_GRADIENT_H
@@ -0,0 +1,425 @@
+#include "convex_hull.h"
+#include <algorithm>
+#include <cmath>
+#include "geometric_predicates.h"
+
+namespace {
+
+const uint32_t NONE = UINT32_MAX;
+// 振り分ける点がこれより多ければ並列にする
+const size_t PARALLEL_ASSIGN_SIZE = 4096;
+const size_t ASSIGN_GRAIN = 1024;
+// 衝突リストを新しく作るときの容量
+const size_t INITIAL_CONFLICT_CAPACITY = 16;
+
+// 衝突リスト (点とその面からの距離)。面が消えたら空にしてプールへ返し、容量ごと使い回す
+struct ConflictList {
+  std::vector<uint32_t> points;
+  std::vector<double> distances;
+};
+
+struct Face {
+  uint32_t v[3];
+  // 辺 v[i] -> v[(i+1)%3] の向こうの面
+  uint32_t neighbor[3];
+  // 外向きの単位法線と原点からの距離 (どの面から一番遠いかを比べるのに使う)
+  double normal[3];
+  double offset;
+  // この面の外側にあり、この面に振り分けられた点のリスト (conflictLists_の番号、無ければNONE)
+  uint32_t conflicts;
+  bool alive;
+  uint32_t visitStamp;
+  bool visible;
+};
+
+class QuickhullBuilder {
+public:
+  QuickhullBuilder(const Vector3* points, size_t count, JobSystem* jobs)
+      : points_(points), count_(count), jobs_(jobs), stamp_(0) {}
+
+  ConvexHull build() {
+    ConvexHull hull;
+    uint32_t simplex[4] = {};
+    if (!findInitialSimplex(simplex)) {
+      return hull;
+    }
+    createInitialHull(simplex);
+
+    // 面は後ろに足されていくので、1回なめれば新しい面も処理される
+    for (size_t f = 0; f < faces_.size(); ++f) {
+      if (faces_[f].alive && faces_[f].conflicts != NONE) {
+        addPoint(static_cast<uint32_t>(f));
+      }
+    }
+
+    std::vector<uint32_t> remap(count_, NONE);
+    for (const Face& face : faces_) {
+      if (!face.alive) {
+        continue;
+      }
+      for (uint32_t v : face.v) {
+        if (remap[v] == NONE) {
+          remap[v] = static_cast<uint32_t>(hull.vertices.size());
+          hull.vertices.push_back(points_[v]);
+          hull.sourceIndices.push_back(v);
+        }
+        hull.indices.push_back(remap[v]);
+      }
+    }
+    return hull;
+  }
+
+private:
+  const Vector3& point(uint32_t i) const { return points_[i]; }
+
+  // 面の外側 (法線の側) に厳密にあるか
+  bool isOutside(const Face& face, uint32_t p) const {
+    return orient3d(point(face.v[0]), point(face.v[1]), point(face.v[2]), point(p)) < 0;
+  }
+
+  double distance(const Face& face, uint32_t p) const {
+    const Vector3& q = point(p);
+    return face.normal[0] * q.x + face.normal[1] * q.y + face.normal[2] * q.z - face.offset;
+  }
+
+  // 互いに最も離れた軸方向の端点2つ、その直線から最も遠い点、その平面から最も遠い点
+  bool findInitialSimplex(uint32_t simplex[4]) const {
+    if (count_ < 4) {
+      return false;
+    }
+    uint32_t extremes[6] = {0, 0, 0, 0, 0, 0};
+    for (uint32_t i = 1; i < count_; ++i) {
+      const Vector3& p = point(i);
+      if (p.x < point(extremes[0]).x) extremes[0] = i;
+      if (p.x > point(extremes[1]).x) extremes[1] = i;
+      if (p.y < point(extremes[2]).y) extremes[2] = i;
+      if (p.y > point(extremes[3]).y) extremes[3] = i;
+      if (p.z < point(extremes[4]).z) extremes[4] = i;
+      if (p.z > point(extremes[5]).z) extremes[5] = i;
+    }
+    double best = 0;
+    for (int i = 0; i < 6; ++i) {
+      for (int j = i + 1; j < 6; ++j) {
+        const double d = squaredDistance(point(extremes[i]), point(extremes[j]));
+        if (d > best) {
+          best = d;
+          simplex[0] = extremes[i];
+          simplex[1] = extremes[j];
+        }
+      }
+    }
+    if (best == 0) {
+      return false;
+    }
+
+    const Vector3& a = point(simplex[0]);
+    const double ab[3] = {static_cast<double>(point(simplex[1]).x) - a.x,
+                          static_cast<double>(point(simplex[1]).y) - a.y,
+                          static_cast<double>(point(simplex[1]).z) - a.z};
+    best = 0;
+    for (uint32_t i = 0; i < count_; ++i) {
+      const double ap[3] = {static_cast<double>(point(i).x) - a.x,
+                            static_cast<double>(point(i).y) - a.y,
+                            static_cast<double>(point(i).z) - a.z};
+      const double c[3] = {ab[1] * ap[2] - ab[2] * ap[1], ab[2] * ap[0] - ab[0] * ap[2], ab[0] * ap[1] - ab[1] * ap[0]};
+      const double d = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
+      if (d > best) {
+        best = d;
+        simplex[2] = i;
+      }
+    }
+    if (best == 0) {
+      return false;
+    }
+
+    best = 0;
+    simplex[3] = NONE;
+    for (uint32_t i = 0; i < count_; ++i) {
+      const double d = std::fabs(orient3dFast(point(simplex[0]), point(simplex[1]), point(simplex[2]), point(i)));
+      if (d > best) {
+        best = d;
+        simplex[3] = i;
+      }
+    }
+    if (simplex[3] == NONE ||
+        orient3d(point(simplex[0]), point(simplex[1]), point(simplex[2]), point(simplex[3])) == 0) {
+      // 近似で選んだ点がちょうど平面上なら、平面から外れた点を正確な判定で探し直す
+      simplex[3] = NONE;
+      for (uint32_t i = 0; i < count_ && simplex[3] == NONE; ++i) {
+        if (orient3d(point(simplex[0]), point(simplex[1]), point(simplex[2]), point(i)) != 0) {
+          simplex[3] = i;
+        }
+      }
+      if (simplex[3] == NONE) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static double squaredDistance(const Vector3& a, const Vector3& b) {
+    const double dx = static_cast<double>(a.x) - b.x;
+    const double dy = static_cast<double>(a.y) - b.y;
+    const double dz = static_cast<double>(a.z) - b.z;
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  uint32_t addFace(uint32_t a, uint32_t b, uint32_t c) {
+    Face face;
+    face.v[0] = a;
+    face.v[1] = b;
+    face.v[2] = c;
+    face.neighbor[0] = face.neighbor[1] = face.neighbor[2] = NONE;
+    const Vector3& pa = point(a);
+    const double u[3] = {static_cast<double>(point(b).x) - pa.x, static_cast<double>(point(b).y) - pa.y,
+                         static_cast<double>(point(b).z) - pa.z};
+    const double w[3] = {static_cast<double>(point(c).x) - pa.x, static_cast<double>(point(c).y) - pa.y,
+                         static_cast<double>(point(c).z) - pa.z};
+    double n[3] = {u[1] * w[2] - u[2] * w[1], u[2] * w[0] - u[0] * w[2], u[0] * w[1] - u[1] * w[0]};
+    const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length > 0) {
+      n[0] /= length;
+      n[1] /= length;
+      n[2] /= length;
+    }
+    face.normal[0] = n[0];
+    face.normal[1] = n[1];
+    face.normal[2] = n[2];
+    face.offset = n[0] * pa.x + n[1] * pa.y + n[2] * pa.z;
+    face.conflicts = NONE;
+    face.alive = true;
+    face.visitStamp = 0;
+    face.visible = false;
+    faces_.push_back(face);
+    return static_cast<uint32_t>(faces_.size() - 1);
+  }
+
+  // 辺 from -> to を持つ面の、その辺の番号
+  int edgeIndex(const Face& face, uint32_t from, uint32_t to) const {
+    for (int i = 0; i < 3; ++i) {
+      if (face.v[i] == from && face.v[(i + 1) % 3] == to) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  void createInitialHull(uint32_t simplex[4]) {
+    // simplex[3]が面012の内側 (orient3dが正) になるように並べる
+    if (orient3d(point(simplex[0]), point(simplex[1]), point(simplex[2]), point(simplex[3])) < 0) {
+      std::swap(simplex[1], simplex[2]);
+    }
+    const uint32_t a = simplex[0], b = simplex[1], c = simplex[2], d = simplex[3];
+    const uint32_t initial[4] = {addFace(a, b, c), addFace(a, d, b), addFace(b, d, c), addFace(c, d, a)};
+    for (uint32_t f : initial) {
+      for (int i = 0; i < 3; ++i) {
+        const uint32_t from = faces_[f].v[i];
+        const uint32_t to = faces_[f].v[(i + 1) % 3];
+        for (uint32_t g : initial) {
+          if (g != f && edgeIndex(faces_[g], to, from) >= 0) {
+            faces_[f].neighbor[i] = g;
+          }
+        }
+      }
+    }
+
+    std::vector<uint32_t> candidates;
+    candidates.reserve(count_);
+    for (uint32_t i = 0; i < count_; ++i) {
+      if (i != a && i != b && i != c && i != d) {
+        candidates.push_back(i);
+      }
+    }
+    assignPoints(candidates, initial, 4);
+  }
+
+  // candidatesの各点を、外側にある面のうち最も遠い面の衝突リストに入れる (どの面の外側にも無ければ捨てる)
+  void assignPoints(const std::vector<uint32_t>& candidates, const uint32_t* faceIds, size_t faceCount) {
+    bestFace_.resize(candidates.size());
+    bestDistance_.resize(candidates.size());
+    auto assignRange = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        uint32_t best = NONE;
+        double bestDistance = 0;
+        for (size_t k = 0; k < faceCount; ++k) {
+          const uint32_t f = faceIds[k];
+          const Face& face = faces_[f];
+          if (!isOutside(face, candidates[i])) {
+            continue;
+          }
+          const double d = distance(face, candidates[i]);
+          if (best == NONE || d > bestDistance) {
+            best = f;
+            bestDistance = d;
+          }
+        }
+        bestFace_[i] = best;
+        bestDistance_[i] = bestDistance;
+      }
+    };
+    if (jobs_ && candidates.size() > PARALLEL_ASSIGN_SIZE) {
+      jobs_->parallelFor(0, candidates.size(), ASSIGN_GRAIN, assignRange);
+    } else {
+      assignRange(0, candidates.size());
+    }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      if (bestFace_[i] != NONE) {
+        ConflictList& list = conflictList(faces_[bestFace_[i]]);
+        list.points.push_back(candidates[i]);
+        list.distances.push_back(bestDistance_[i]);
+      }
+    }
+  }
+
+  // 面の衝突リスト。まだ無ければプールから空のリストを割り当てる
+  ConflictList& conflictList(Face& face) {
+    if (face.conflicts == NONE) {
+      if (freeConflictLists_.empty()) {
+        // 新しいリストは最初から少し容量を持たせ、伸ばすたびの確保を減らす
+        face.conflicts = static_cast<uint32_t>(conflictLists_.size());
+        conflictLists_.emplace_back();
+        conflictLists_.back().points.reserve(INITIAL_CONFLICT_CAPACITY);
+        conflictLists_.back().distances.reserve(INITIAL_CONFLICT_CAPACITY);
+      } else {
+        face.conflicts = freeConflictLists_.back();
+        freeConflictLists_.pop_back();
+      }
+    }
+    return conflictLists_[face.conflicts];
+  }
+
+  void addPoint(uint32_t start) {
+    // 最も遠い点を選ぶ (距離は点の番号とは別の連続した配列に持つ)
+    const ConflictList& startList = conflictLists_[faces_[start].conflicts];
+    const double* distances = startList.distances.data();
+    size_t furthest = 0;
+    double furthestDistance = distances[0];
+    for (size_t i = 1; i < startList.distances.size(); ++i) {
+      if (distances[i] > furthestDistance) {
+        furthestDistance = distances[i];
+        furthest = i;
+      }
+    }
+    const uint32_t eye = startList.points[furthest];
+
+    // eyeから見える面を隣接をたどって集め、見えない面との境目 (地平線) の辺を記録する
+    ++stamp_;
+    visible_.clear();
+    horizon_.clear();
+    faces_[start].visitStamp = stamp_;
+    faces_[start].visible = true;
+    visible_.push_back(start);
+    for (size_t k = 0; k < visible_.size(); ++k) {
+      const uint32_t f = visible_[k];
+      for (int i = 0; i < 3; ++i) {
+        const uint32_t n = faces_[f].neighbor[i];
+        Face& neighbor = faces_[n];
+        if (neighbor.visitStamp != stamp_) {
+          neighbor.visitStamp = stamp_;
+          neighbor.visible = isOutside(neighbor, eye);
+          if (neighbor.visible) {
+            visible_.push_back(n);
+          }
+        }
+        if (!neighbor.visible) {
+          horizon_.push_back(HorizonEdge{faces_[f].v[i], faces_[f].v[(i + 1) % 3], n});
+        }
+      }
+    }
+
+    // 地平線の辺ごとにeyeとの三角形を作る。辺の向きは見えていた面と同じなので、外向きのまま
+    newFaces_.clear();
+    startAt_.resize(count_, NONE);
+    for (const HorizonEdge& edge : horizon_) {
+      const uint32_t f = addFace(edge.from, edge.to, eye);
+      faces_[f].neighbor[0] = edge.outside;
+      Face& outside = faces_[edge.outside];
+      outside.neighbor[edgeIndex(outside, edge.to, edge.from)] = f;
+      newFaces_.push_back(f);
+      startAt_[edge.from] = f;
+    }
+    for (uint32_t f : newFaces_) {
+      // 辺 to -> eye の向こうは、toから始まる新しい面
+      const uint32_t next = startAt_[faces_[f].v[1]];
+      faces_[f].neighbor[1] = next;
+      faces_[next].neighbor[2] = f;
+    }
+    for (const HorizonEdge& edge : horizon_) {
+      startAt_[edge.from] = NONE;
+    }
+
+    // 見えていた面の衝突リストの点を新しい面に振り分け直す
+    candidates_.clear();
+    for (uint32_t f : visible_) {
+      Face& face = faces_[f];
+      face.alive = false;
+      if (face.conflicts == NONE) {
+        continue;
+      }
+      ConflictList& list = conflictLists_[face.conflicts];
+      for (uint32_t p : list.points) {
+        if (p != eye) {
+          candidates_.push_back(p);
+        }
+      }
+      list.points.clear();
+      list.distances.clear();
+      freeConflictLists_.push_back(face.conflicts);
+      face.conflicts = NONE;
+    }
+    assignPoints(candidates_, newFaces_.data(), newFaces_.size());
+  }
+
+  struct HorizonEdge {
+    uint32_t from;
+    uint32_t to;
+    uint32_t outside;
+  };
+
+  const Vector3* points_;
+  size_t count_;
+  JobSystem* jobs_;
+  std::vector<Face> faces_;
+  uint32_t stamp_;
+  // addPointの作業領域 (毎回確保しないよう使い回す)
+  std::vector<uint32_t> visible_;
+  std::vector<HorizonEdge> horizon_;
+  std::vector<uint32_t> newFaces_;
+  // 地平線の頂点 -> そこから始まる新しい面 (使い終わったらNONEに戻す)
+  std::vector<uint32_t> startAt_;
+  std::vector<uint32_t> candidates_;
+  std::vector<uint32_t> bestFace_;
+  std::vector<double> bestDistance_;
+  // 衝突リストのプール (面が消えると番号がfreeConflictLists_に戻り、次に作る面が容量ごと使い回す)
+  std::vector<ConflictList> conflictLists_;
+  std::vector<uint32_t> freeConflictLists_;
+};
+
+} // namespace
+
+void ConvexHull::appendTriangleList(std::vector<float>& out) const {
+  out.reserve(out.size() + indices.size() * 3);
+  for (uint32_t index : indices) {
+    out.push_back(vertices[index].x);
+    out.push_back(vertices[index].y);
+    out.push_back(vertices[index].z);
+  }
+}
+
+ConvexHull quickhull(const Vector3* points, size_t count, JobSystem& jobs) {
+  return QuickhullBuilder(points, count, &jobs).build();
+}
+
+ConvexHull quickhull(const std::vector<Vector3>& points, JobSystem& jobs) {
+  return quickhull(points.data(), points.size(), jobs);
+}
+
+void quickhullBatch(const std::vector<std::vector<Vector3>>& pointSets, std::vector<ConvexHull>& hulls,
+                    JobSystem& jobs) {
+  hulls.resize(pointSets.size());
+  jobs.parallelFor(0, pointSets.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      hulls[i] = QuickhullBuilder(pointSets[i].data(), pointSets[i].size(), nullptr).build();
+    }
+  });
+}
@@ -0,0 +1,35 @@
+#ifndef CONVEX_HULL_H
+#define CONVEX_HULL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector_space.h"
+#include "Core/job_system.h"
+
+// 3次元の凸包 (三角形に分割した表面)
+struct ConvexHull {
+  // 凸包の頂点 (入力点の写し) と、それぞれの入力での番号
+  std::vector<Vector3> vertices;
+  std::vector<size_t> sourceIndices;
+  // 3つで1三角形。外から見て反時計回り (OpenGLの既定の表面)
+  std::vector<uint32_t> indices;
+
+  size_t triangleCount() const noexcept { return indices.size() / 3; }
+  // 三角形リスト (頂点ごとにxyz) を追加する。Polygon3D::setVerticesにそのまま渡せる
+  void appendTriangleList(std::vector<float>& out) const;
+};
+
+// Quickhullで凸包を求める
+// 面の向きの判定は頑健な述語(orient3d)で行い、面の平面上にある点は凸包の頂点にしない。
+// 点が多いときは、衝突リスト (各面の外側にある点) の振り分けだけをjobsで並列に行う。
+// 点の追加 (見える面の探索と面の張り替え) は1点ずつ逐次で、独立した面を同時に処理することはしない。
+// 全点が同一平面上 (または点が4つ未満) のときは三角形を持たない凸包を返す。
+ConvexHull quickhull(const Vector3* points, size_t count, JobSystem& jobs = JobSystem::instance());
+ConvexHull quickhull(const std::vector<Vector3>& points, JobSystem& jobs = JobSystem::instance());
+
+// 多数の点群の凸包をまとめて求める (点群ごとに並列。1つの点群の中は逐次)
+void quickhullBatch(const std::vector<std::vector<Vector3>>& pointSets, std::vector<ConvexHull>& hulls,
+                    JobSystem& jobs = JobSystem::instance());
+
+#endif // CONVEX_HULL_H
@@ -0,0 +1,186 @@
+#include "geometric_predicates.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// 有限個のdoubleの和で値を正確に表す展開(expansion)は、スタック上の固定長配列と成分数で持つ
+// (成分は絶対値の小さい順、0は持たない)。
+// orient3dExactで必要な長さには上限があるので (Shewchuk論文の4.3節)、ヒープは使わない:
+//   座標の差 2 -> 2x2の積 8 -> 2x2行列式 16 -> 3x3行列式の各項 64 -> 行列式 192
+
+const double EPSILON = std::numeric_limits<double>::epsilon() / 2;  // 2^-53
+// orient3dのdouble計算の誤差の上限 (permanentに掛ける)
+const double ORIENT3D_ERROR_BOUND = (7.0 + 56.0 * EPSILON) * EPSILON;
+
+// multiplyExpansionで一度に掛けられる展開の長さの上限 (2x2行列式の16)
+const int MAX_SCALED_LENGTH = 16;
+
+// a + b = x + y (xは丸めた和、yは丸め誤差)
+inline void twoSum(double a, double b, double& x, double& y) {
+  x = a + b;
+  const double bVirtual = x - a;
+  const double aVirtual = x - bVirtual;
+  y = (a - aVirtual) + (b - bVirtual);
+}
+
+inline void twoDiff(double a, double b, double& x, double& y) {
+  twoSum(a, -b, x, y);
+}
+
+// a * b = x + y (fmaは丸めずに積和を計算するので、誤差がそのまま取り出せる)
+inline void twoProduct(double a, double b, double& x, double& y) {
+  x = a * b;
+  y = std::fma(a, b, -x);
+}
+
+// h = e + b (hはelen + 1要素。eと同じ配列でもよい)。hの成分数を返す
+int growExpansion(int elen, const double* e, double b, double* h) {
+  double q = b;
+  int hlen = 0;
+  for (int i = 0; i < elen; ++i) {
+    double sum, error;
+    twoSum(q, e[i], sum, error);
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+    q = sum;
+  }
+  if (q != 0) {
+    h[hlen++] = q;
+  }
+  return hlen;
+}
+
+// h = e + f (hはelen + flen要素。eと同じ配列でもよいが、fとは重ならないこと)
+int addExpansion(int elen, const double* e, int flen, const double* f, double* h) {
+  if (h != e) {
+    std::copy(e, e + elen, h);
+  }
+  int hlen = elen;
+  for (int i = 0; i < flen; ++i) {
+    hlen = growExpansion(hlen, h, f[i], h);
+  }
+  return hlen;
+}
+
+// h = e * b (hは2 * elen要素)
+int scaleExpansion(int elen, const double* e, double b, double* h) {
+  double q = 0;
+  int hlen = 0;
+  for (int i = 0; i < elen; ++i) {
+    double product, productError;
+    twoProduct(e[i], b, product, productError);
+    double sum, error;
+    twoSum(q, productError, sum, error);
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+    twoSum(product, sum, q, error);
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+  }
+  if (q != 0) {
+    h[hlen++] = q;
+  }
+  return hlen;
+}
+
+// h = e * f (hは2 * elen * flen要素、elenはMAX_SCALED_LENGTH以下)
+int multiplyExpansion(int elen, const double* e, int flen, const double* f, double* h) {
+  double scaled[2 * MAX_SCALED_LENGTH];
+  int hlen = 0;
+  for (int i = 0; i < flen; ++i) {
+    const int slen = scaleExpansion(elen, e, f[i], scaled);
+    hlen = addExpansion(hlen, h, slen, scaled, h);
+  }
+  return hlen;
+}
+
+void negateExpansion(int elen, double* e) {
+  for (int i = 0; i < elen; ++i) {
+    e[i] = -e[i];
+  }
+}
+
+// h = a - b (hは2要素)
+int difference(double a, double b, double* h) {
+  double x, y;
+  twoDiff(a, b, x, y);
+  int hlen = 0;
+  if (y != 0) {
+    h[hlen++] = y;
+  }
+  if (x != 0) {
+    h[hlen++] = x;
+  }
+  return hlen;
+}
+
+// 2x2の行列式 ad - bc = a*d - b*c を正確に計算する (hは16要素)
+int determinant2(int alen, const double* a, int dlen, const double* d,
+                 int blen, const double* b, int clen, const double* c, double* h) {
+  double ad[8], bc[8];
+  const int adlen = multiplyExpansion(alen, a, dlen, d, ad);
+  const int bclen = multiplyExpansion(blen, b, clen, c, bc);
+  negateExpansion(bclen, bc);
+  return addExpansion(adlen, ad, bclen, bc, h);
+}
+
+// 正確な値の符号を持つ近似値 (最も大きい成分)
+double estimate(int elen, const double* e) {
+  return elen == 0 ? 0.0 : e[elen - 1];
+}
+
+double orient3dExact(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d) {
+  double adx[2], ady[2], adz[2], bdx[2], bdy[2], bdz[2], cdx[2], cdy[2], cdz[2];
+  const int adxlen = difference(a.x, d.x, adx), adylen = difference(a.y, d.y, ady), adzlen = difference(a.z, d.z, adz);
+  const int bdxlen = difference(b.x, d.x, bdx), bdylen = difference(b.y, d.y, bdy), bdzlen = difference(b.z, d.z, bdz);
+  const int cdxlen = difference(c.x, d.x, cdx), cdylen = difference(c.y, d.y, cdy), cdzlen = difference(c.z, d.z, cdz);
+
+  double bc[16], ca[16], ab[16];
+  const int bclen = determinant2(bdxlen, bdx, cdylen, cdy, cdxlen, cdx, bdylen, bdy, bc);
+  const int calen = determinant2(cdxlen, cdx, adylen, ady, adxlen, adx, cdylen, cdy, ca);
+  const int ablen = determinant2(adxlen, adx, bdylen, bdy, bdxlen, bdx, adylen, ady, ab);
+
+  double adet[64], bdet[64], cdet[64];
+  const int alen = multiplyExpansion(bclen, bc, adzlen, adz, adet);
+  const int blen = multiplyExpansion(calen, ca, bdzlen, bdz, bdet);
+  const int clen = multiplyExpansion(ablen, ab, cdzlen, cdz, cdet);
+
+  double det[192];
+  int detlen = addExpansion(alen, adet, blen, bdet, det);
+  detlen = addExpansion(detlen, det, clen, cdet, det);
+  return estimate(detlen, det);
+}
+
+} // namespace
+
+double orient3dFast(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d) {
+  const double adx = static_cast<double>(a.x) - d.x, ady = static_cast<double>(a.y) - d.y, adz = static_cast<double>(a.z) - d.z;
+  const double bdx = static_cast<double>(b.x) - d.x, bdy = static_cast<double>(b.y) - d.y, bdz = static_cast<double>(b.z) - d.z;
+  const double cdx = static_cast<double>(c.x) - d.x, cdy = static_cast<double>(c.y) - d.y, cdz = static_cast<double>(c.z) - d.z;
+  return adx * (bdy * cdz - bdz * cdy) + bdx * (cdy * adz - cdz * ady) + cdx * (ady * bdz - adz * bdy);
+}
+
+double orient3d(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d) {
+  const double adx = static_cast<double>(a.x) - d.x, ady = static_cast<double>(a.y) - d.y, adz = static_cast<double>(a.z) - d.z;
+  const double bdx = static_cast<double>(b.x) - d.x, bdy = static_cast<double>(b.y) - d.y, bdz = static_cast<double>(b.z) - d.z;
+  const double cdx = static_cast<double>(c.x) - d.x, cdy = static_cast<double>(c.y) - d.y, cdz = static_cast<double>(c.z) - d.z;
+
+  const double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  const double cdxady = cdx * ady, adxcdy = adx * cdy;
+  const double adxbdy = adx * bdy, bdxady = bdx * ady;
+  const double det = adz * (bdxcdy - cdxbdy) + bdz * (cdxady - adxcdy) + cdz * (adxbdy - bdxady);
+
+  const double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy)) * std::fabs(adz) +
+                           (std::fabs(cdxady) + std::fabs(adxcdy)) * std::fabs(bdz) +
+                           (std::fabs(adxbdy) + std::fabs(bdxady)) * std::fabs(cdz);
+  const double bound = ORIENT3D_ERROR_BOUND * permanent;
+  if (det > bound || -det > bound) {
+    return det;
+  }
+  return orient3dExact(a, b, c, d);
+}
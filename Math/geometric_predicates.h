@@ -0,0 +1,19 @@
+#ifndef GEOMETRIC_PREDICATES_H
+#define GEOMETRIC_PREDICATES_H
+
+#include "vector_space.h"
+
+// 頑健な幾何述語 (Shewchuk, "Adaptive Precision Floating-Point Arithmetic and Fast Robust
+// Geometric Predicates", 1997 の方式)
+// まずdoubleで計算し、誤差の上限より値が小さいときだけ多倍長の展開(expansion)で正確に計算し直す。
+// 戻り値は符号だけが正確で、大きさは近似値。
+
+// aからdへの4点の向き
+// a, b, cを上から見て反時計回りに並ぶとき、dがその平面より下にあれば正、上にあれば負、同一平面上なら0
+// (値は (a-d)・((b-d)×(c-d)) で、四面体abcdの符号付き体積の6倍)
+double orient3d(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d);
+
+// 誤差を考えないdouble版 (大まかな距離の比較に使う)
+double orient3dFast(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& d);
+
+#endif // GEOMETRIC_PREDICATES_H
@@ -6,21 +6,12 @@
 #include <numeric>
 #include <algorithm>
 #include <functional>
-#include "vector_space.h"
+#include "gram_schmidt_normalization.h"
+#include "operators.h"
 
 using namespace std;
 
-// Define the missing functions
-void sub_inplace(vector<double>& a, const vector<double>& b) {
-  transform(a.begin(), a.end(), b.begin(), a.begin(), minus<double>());
-}
-
-vector<double> scalar_multiple(const vector<double>& a, double scalar) {
-  vector<double> result(a.size());
-  transform(a.begin(), a.end(), result.begin(), bind(multiplies<double>(), placeholders::_1, scalar));
-  return result;
-}
-
+// operators.hに無いその場で書き換える演算
 void scalar_multiple_inplace(vector<double>& a, double scalar) {
   transform(a.begin(), a.end(), a.begin(), bind(multiplies<double>(), placeholders::_1, scalar));
 }
@@ -34,11 +25,32 @@ void gram_schmidt_normalization(vector<vector<double>>& a) {
       double dot_product = dot(a[i], a[j]);
       double norm_squared = dot(a[j], a[j]);
       double scalar = dot_product / norm_squared;
-      sub_inplace(a[i], scalar_multiple(a[j], scalar));
+      axpy(-scalar, a[j], a[i]);
     }
   }
   for (int i = 0; i < n; ++i) {
     double norm_val = norm(a[i]);
     scalar_multiple_inplace(a[i], 1 / norm_val);
   }
+}
+
+void gram_schmidt_normalization_parallel(vector<vector<double>>& a, JobSystem& jobs) {
+  const size_t n = a.size();
+  if (n == 0) {
+    return;
+  }
+  // 1チャンクあたり数万回の積和になるようにする
+  const size_t dimension = a[0].size();
+  const size_t grain = max<size_t>(1, 16384 / max<size_t>(1, dimension));
+
+  for (size_t j = 0; j < n; ++j) {
+    scalar_multiple_inplace(a[j], 1 / norm(a[j]));
+    const vector<double>& q = a[j];
+    // a[j]より後ろのベクトルは互いに独立に更新できる
+    jobs.parallelFor(j + 1, n, grain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        axpy(-dot(a[i], q), q, a[i]);
+      }
+    });
+  }
 }
\ No newline at end of file
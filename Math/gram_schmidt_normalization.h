@@ -0,0 +1,16 @@
+#ifndef GRAM_SCHMIDT_NORMALIZATION_H
+#define GRAM_SCHMIDT_NORMALIZATION_H
+
+#include <vector>
+#include "Core/job_system.h"
+
+// グラムシュミットの正規直交化
+// a: n次元ベクトルの集合 (その場で正規直交基底に置き換える)
+void gram_schmidt_normalization(std::vector<std::vector<double>>& a);
+
+// 修正グラムシュミット法の列指向版
+// a[j]を正規化したら、残りのa[i] (i > j) からa[j]の成分を並列に取り除く
+void gram_schmidt_normalization_parallel(std::vector<std::vector<double>>& a,
+                                         JobSystem& jobs = JobSystem::instance());
+
+#endif // GRAM_SCHMIDT_NORMALIZATION_H
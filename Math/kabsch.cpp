@@ -0,0 +1,121 @@
+#include "kabsch.h"
+#include "svd3.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// 相互共分散を足し合わせる1チャンクの点数
+const size_t COVARIANCE_GRAIN = 4096;
+// 回転と並進を仕上げる1チャンクの組数
+const size_t KABSCH_GRAIN = 1024;
+
+// チャンクごとの部分和 (桁落ちを避けるため、最初の点からの差で足す)
+struct CovarianceSum {
+  double source[3] = {0.0, 0.0, 0.0};
+  double target[3] = {0.0, 0.0, 0.0};
+  double products[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+};
+
+// 符号付きSVDのu、vは回転なので、R = v u^T もそのまま回転になる
+RigidTransform transformFromSvd(const PointCovariance& covariance, const Svd3& svd) {
+  Matrix3 r;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      r.m[i][j] = svd.v.m[i][0] * svd.u.m[j][0] + svd.v.m[i][1] * svd.u.m[j][1] +
+                  svd.v.m[i][2] * svd.u.m[j][2];
+    }
+  }
+  const Vector3& p = covariance.sourceCentroid;
+  const Vector3& q = covariance.targetCentroid;
+  RigidTransform result;
+  result.rotation = Quaternion::fromMatrix(r);
+  result.translation = Vector3(q.x - (r.m[0][0] * p.x + r.m[0][1] * p.y + r.m[0][2] * p.z),
+                               q.y - (r.m[1][0] * p.x + r.m[1][1] * p.y + r.m[1][2] * p.z),
+                               q.z - (r.m[2][0] * p.x + r.m[2][1] * p.y + r.m[2][2] * p.z));
+  return result;
+}
+
+} // namespace
+
+PointCovariance crossCovariance(const Vector3* source, const Vector3* target, size_t count, JobSystem& jobs) {
+  PointCovariance result;
+  result.count = count;
+  result.covariance = Matrix3(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+  if (count == 0) {
+    return result;
+  }
+
+  const double p0[3] = {source[0].x, source[0].y, source[0].z};
+  const double q0[3] = {target[0].x, target[0].y, target[0].z};
+  const size_t chunkCount = (count + COVARIANCE_GRAIN - 1) / COVARIANCE_GRAIN;
+  std::vector<CovarianceSum> sums(chunkCount);
+  jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+      CovarianceSum& sum = sums[c];
+      const size_t end = std::min(count, (c + 1) * COVARIANCE_GRAIN);
+      for (size_t k = c * COVARIANCE_GRAIN; k < end; ++k) {
+        const double p[3] = {source[k].x - p0[0], source[k].y - p0[1], source[k].z - p0[2]};
+        const double q[3] = {target[k].x - q0[0], target[k].y - q0[1], target[k].z - q0[2]};
+        for (int i = 0; i < 3; ++i) {
+          sum.source[i] += p[i];
+          sum.target[i] += q[i];
+          for (int j = 0; j < 3; ++j) {
+            sum.products[i][j] += p[i] * q[j];
+          }
+        }
+      }
+    }
+  });
+
+  CovarianceSum total;
+  for (const CovarianceSum& sum : sums) {
+    for (int i = 0; i < 3; ++i) {
+      total.source[i] += sum.source[i];
+      total.target[i] += sum.target[i];
+      for (int j = 0; j < 3; ++j) {
+        total.products[i][j] += sum.products[i][j];
+      }
+    }
+  }
+
+  // Σ (p - p̄)(q - q̄)^T = Σ p q^T - n p̄ q̄^T (p、qは最初の点からの差)
+  const double n = static_cast<double>(count);
+  const double p[3] = {total.source[0] / n, total.source[1] / n, total.source[2] / n};
+  const double q[3] = {total.target[0] / n, total.target[1] / n, total.target[2] / n};
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      result.covariance.m[i][j] = static_cast<float>(total.products[i][j] - n * p[i] * q[j]);
+    }
+  }
+  result.sourceCentroid = Vector3(static_cast<float>(p0[0] + p[0]), static_cast<float>(p0[1] + p[1]),
+                                  static_cast<float>(p0[2] + p[2]));
+  result.targetCentroid = Vector3(static_cast<float>(q0[0] + q[0]), static_cast<float>(q0[1] + q[1]),
+                                  static_cast<float>(q0[2] + q[2]));
+  return result;
+}
+
+RigidTransform kabsch(const Vector3* source, const Vector3* target, size_t count, JobSystem& jobs) {
+  return kabsch(crossCovariance(source, target, count, jobs));
+}
+
+RigidTransform kabsch(const PointCovariance& covariance) {
+  if (covariance.count == 0) {
+    return RigidTransform();
+  }
+  return transformFromSvd(covariance, svd3(covariance.covariance));
+}
+
+void kabschBatch(const PointCovariance* covariances, size_t count, RigidTransform* out, JobSystem& jobs) {
+  std::vector<Matrix3> matrices(count);
+  for (size_t i = 0; i < count; ++i) {
+    matrices[i] = covariances[i].covariance;
+  }
+  std::vector<Svd3> svds(count);
+  svd3Batch(matrices.data(), count, svds.data(), jobs);
+  jobs.parallelFor(0, count, KABSCH_GRAIN, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = covariances[i].count == 0 ? RigidTransform() : transformFromSvd(covariances[i], svds[i]);
+    }
+  });
+}
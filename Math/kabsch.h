@@ -0,0 +1,39 @@
+#ifndef KABSCH_H
+#define KABSCH_H
+
+#include <cstddef>
+#include "vector_space.h"
+#include "quaternion.h"
+#include "Core/job_system.h"
+
+// 剛体変換 p -> rotation * p + translation
+struct RigidTransform {
+  Quaternion rotation;
+  Vector3 translation;
+};
+
+// 対応点の組の重心と相互共分散 covariance = Σ (p - sourceCentroid)(q - targetCentroid)^T
+struct PointCovariance {
+  Vector3 sourceCentroid;
+  Vector3 targetCentroid;
+  Matrix3 covariance;
+  size_t count = 0;
+};
+
+// source[i]とtarget[i]を対応点として重心と相互共分散を求める
+// 大きな点列はjobsでチャンクに分けて倍精度で足し合わせる (チャンクの順に合わせるので結果は毎回同じ)
+PointCovariance crossCovariance(const Vector3* source, const Vector3* target, size_t count,
+                                JobSystem& jobs = JobSystem::instance());
+
+// Σ|R p + t - q|^2 を最小にする回転Rと並進tを求める (Kabschの方法)
+// covariance = U diag(sigma) V^T の符号付きSVDから R = V U^T とするので、鏡映は返さない。
+// 点が無ければ恒等変換、一直線上の点のように回転が決まらない場合はそのうちの1つを返す。
+RigidTransform kabsch(const Vector3* source, const Vector3* target, size_t count,
+                      JobSystem& jobs = JobSystem::instance());
+RigidTransform kabsch(const PointCovariance& covariance);
+
+// 多数の組 (ICPの各反復や、物体ごとの位置合わせ) をまとめて解く。SVDはsvd3Batchでレーンに並べて計算する
+void kabschBatch(const PointCovariance* covariances, size_t count, RigidTransform* out,
+                 JobSystem& jobs = JobSystem::instance());
+
+#endif // KABSCH_H
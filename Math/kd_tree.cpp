@@ -0,0 +1,250 @@
+#include "kd_tree.h"
+#include <algorithm>
+
+namespace {
+
+// これ以下の区間は木をたどらずに全部調べる
+const size_t LEAF_SIZE = 8;
+// これより大きな部分木は片側を別のジョブで作る
+const size_t PARALLEL_BUILD_SIZE = 1 << 14;
+// 一括クエリの1チャンクのクエリ数
+const size_t QUERY_GRAIN = 256;
+
+struct BuildItem {
+  Vector3 point;
+  size_t index;
+};
+
+inline float component(const Vector3& v, int axis) {
+  return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+inline float distanceSquared(const Vector3& a, const Vector3& b) {
+  const float dx = a.x - b.x;
+  const float dy = a.y - b.y;
+  const float dz = a.z - b.z;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// 最大ヒープの比較 (先頭が最も遠い)
+inline bool closer(const Neighbor& a, const Neighbor& b) {
+  return a.distanceSquared < b.distanceSquared;
+}
+
+// 区間の中央で、いちばん広がっている軸に沿って分割する
+void buildRange(BuildItem* items, uint8_t* axes, size_t begin, size_t end, JobSystem& jobs) {
+  if (end - begin <= 1) {
+    if (end > begin) {
+      axes[begin] = 0;
+    }
+    return;
+  }
+  float lo[3] = {items[begin].point.x, items[begin].point.y, items[begin].point.z};
+  float hi[3] = {lo[0], lo[1], lo[2]};
+  for (size_t i = begin + 1; i < end; ++i) {
+    const Vector3& p = items[i].point;
+    lo[0] = std::min(lo[0], p.x); hi[0] = std::max(hi[0], p.x);
+    lo[1] = std::min(lo[1], p.y); hi[1] = std::max(hi[1], p.y);
+    lo[2] = std::min(lo[2], p.z); hi[2] = std::max(hi[2], p.z);
+  }
+  int axis = 0;
+  for (int k = 1; k < 3; ++k) {
+    if (hi[k] - lo[k] > hi[axis] - lo[axis]) {
+      axis = k;
+    }
+  }
+
+  const size_t mid = begin + (end - begin) / 2;
+  std::nth_element(items + begin, items + mid, items + end, [axis](const BuildItem& a, const BuildItem& b) {
+    return component(a.point, axis) < component(b.point, axis);
+  });
+  axes[mid] = static_cast<uint8_t>(axis);
+
+  if (end - begin > PARALLEL_BUILD_SIZE) {
+    JobHandle left = jobs.schedule([items, axes, begin, mid, &jobs] {
+      buildRange(items, axes, begin, mid, jobs);
+    });
+    buildRange(items, axes, mid + 1, end, jobs);
+    jobs.wait(left);
+  } else {
+    buildRange(items, axes, begin, mid, jobs);
+    buildRange(items, axes, mid + 1, end, jobs);
+  }
+}
+
+} // namespace
+
+KdTree::KdTree() {}
+
+KdTree::KdTree(const std::vector<Vector3>& points, JobSystem& jobs) : KdTree(points.data(), points.size(), jobs) {}
+
+KdTree::KdTree(const Vector3* points, size_t count, JobSystem& jobs) {
+  std::vector<BuildItem> items(count);
+  for (size_t i = 0; i < count; ++i) {
+    items[i].point = points[i];
+    items[i].index = i;
+  }
+  axes_.resize(count);
+  buildRange(items.data(), axes_.data(), 0, count, jobs);
+
+  // 検索で読むのは点だけなので、番号とは別の配列に詰める
+  points_.resize(count);
+  indices_.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    points_[i] = items[i].point;
+    indices_[i] = items[i].index;
+  }
+}
+
+size_t KdTree::nearest(const Vector3& query, float* distanceSquared) const {
+  std::vector<Neighbor> result;
+  knn(query, 1, result);
+  if (result.empty()) {
+    return SIZE_MAX;
+  }
+  if (distanceSquared) {
+    *distanceSquared = result[0].distanceSquared;
+  }
+  return result[0].index;
+}
+
+void KdTree::knn(const Vector3& query, size_t k, std::vector<Neighbor>& out) const {
+  out.clear();
+  if (k == 0) {
+    return;
+  }
+  out.reserve(std::min(k, size()));
+  searchKnn(0, size(), query, k, out);
+  std::sort_heap(out.begin(), out.end(), closer);
+  for (Neighbor& n : out) {
+    n.index = indices_[n.index];
+  }
+}
+
+void KdTree::radiusSearch(const Vector3& query, float radius, std::vector<Neighbor>& out) const {
+  out.clear();
+  searchRadius(0, size(), query, radius * radius, out);
+  for (Neighbor& n : out) {
+    n.index = indices_[n.index];
+  }
+}
+
+void KdTree::knnBatch(const Vector3* queries, size_t count, size_t k, std::vector<Neighbor>& out,
+                      JobSystem& jobs) const {
+  out.assign(count * k, Neighbor{SIZE_MAX, 0.0f});
+  if (k == 0) {
+    return;
+  }
+  jobs.parallelFor(0, count, QUERY_GRAIN, [&](size_t begin, size_t end) {
+    std::vector<Neighbor> heap;
+    heap.reserve(std::min(k, size()));
+    for (size_t q = begin; q < end; ++q) {
+      heap.clear();
+      searchKnn(0, size(), queries[q], k, heap);
+      std::sort_heap(heap.begin(), heap.end(), closer);
+      for (size_t i = 0; i < heap.size(); ++i) {
+        out[q * k + i] = Neighbor{indices_[heap[i].index], heap[i].distanceSquared};
+      }
+    }
+  });
+}
+
+void KdTree::radiusBatch(const Vector3* queries, size_t count, float radius, NeighborLists& out,
+                         JobSystem& jobs) const {
+  // 結果の数が前もって分からないので、決まった大きさのチャンクごとに集めてからつなぐ
+  const size_t chunkCount = (count + QUERY_GRAIN - 1) / QUERY_GRAIN;
+  std::vector<std::vector<Neighbor>> chunks(chunkCount);
+  out.offsets.assign(count + 1, 0);
+  const float radiusSquared = radius * radius;
+  jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+      const size_t end = std::min(count, (c + 1) * QUERY_GRAIN);
+      for (size_t q = c * QUERY_GRAIN; q < end; ++q) {
+        const size_t before = chunks[c].size();
+        searchRadius(0, size(), queries[q], radiusSquared, chunks[c]);
+        out.offsets[q + 1] = chunks[c].size() - before;
+      }
+    }
+  });
+  for (size_t q = 0; q < count; ++q) {
+    out.offsets[q + 1] += out.offsets[q];
+  }
+  out.neighbors.resize(out.offsets[count]);
+  jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+      Neighbor* dst = out.neighbors.data() + out.offsets[c * QUERY_GRAIN];
+      for (const Neighbor& n : chunks[c]) {
+        *dst++ = Neighbor{indices_[n.index], n.distanceSquared};
+      }
+    }
+  });
+}
+
+// heapは最も遠い点が先頭の最大ヒープ。indexは木の中の位置のまま入れ、最後に元の番号へ直す
+void KdTree::searchKnn(size_t begin, size_t end, const Vector3& query, size_t k, std::vector<Neighbor>& heap) const {
+  if (end - begin <= LEAF_SIZE) {
+    for (size_t i = begin; i < end; ++i) {
+      const float d = distanceSquared(points_[i], query);
+      if (heap.size() < k) {
+        heap.push_back(Neighbor{i, d});
+        std::push_heap(heap.begin(), heap.end(), closer);
+      } else if (d < heap.front().distanceSquared) {
+        std::pop_heap(heap.begin(), heap.end(), closer);
+        heap.back() = Neighbor{i, d};
+        std::push_heap(heap.begin(), heap.end(), closer);
+      }
+    }
+    return;
+  }
+  const size_t mid = begin + (end - begin) / 2;
+  const float d = distanceSquared(points_[mid], query);
+  if (heap.size() < k) {
+    heap.push_back(Neighbor{mid, d});
+    std::push_heap(heap.begin(), heap.end(), closer);
+  } else if (d < heap.front().distanceSquared) {
+    std::pop_heap(heap.begin(), heap.end(), closer);
+    heap.back() = Neighbor{mid, d};
+    std::push_heap(heap.begin(), heap.end(), closer);
+  }
+
+  // クエリのある側を先に調べ、分割面までの距離が今のk番目より近ければ反対側も調べる
+  const int axis = axes_[mid];
+  const float diff = component(query, axis) - component(points_[mid], axis);
+  if (diff < 0) {
+    searchKnn(begin, mid, query, k, heap);
+    if (heap.size() < k || diff * diff < heap.front().distanceSquared) {
+      searchKnn(mid + 1, end, query, k, heap);
+    }
+  } else {
+    searchKnn(mid + 1, end, query, k, heap);
+    if (heap.size() < k || diff * diff < heap.front().distanceSquared) {
+      searchKnn(begin, mid, query, k, heap);
+    }
+  }
+}
+
+void KdTree::searchRadius(size_t begin, size_t end, const Vector3& query, float radiusSquared,
+                          std::vector<Neighbor>& out) const {
+  if (end - begin <= LEAF_SIZE) {
+    for (size_t i = begin; i < end; ++i) {
+      const float d = distanceSquared(points_[i], query);
+      if (d <= radiusSquared) {
+        out.push_back(Neighbor{i, d});
+      }
+    }
+    return;
+  }
+  const size_t mid = begin + (end - begin) / 2;
+  const float d = distanceSquared(points_[mid], query);
+  if (d <= radiusSquared) {
+    out.push_back(Neighbor{mid, d});
+  }
+  const int axis = axes_[mid];
+  const float diff = component(query, axis) - component(points_[mid], axis);
+  if (diff <= 0 || diff * diff <= radiusSquared) {
+    searchRadius(begin, mid, query, radiusSquared, out);
+  }
+  if (diff >= 0 || diff * diff <= radiusSquared) {
+    searchRadius(mid + 1, end, query, radiusSquared, out);
+  }
+}
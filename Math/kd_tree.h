@@ -0,0 +1,63 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "vector_space.h"
+#include "Core/job_system.h"
+
+// 近傍探索の結果 (indexは構築に使った点列での番号)
+struct Neighbor {
+  size_t index;
+  float distanceSquared;
+};
+
+// 一括クエリの結果 (クエリiの近傍は neighbors[offsets[i]] から neighbors[offsets[i+1]-1] まで)
+struct NeighborLists {
+  std::vector<size_t> offsets;
+  std::vector<Neighbor> neighbors;
+};
+
+// 点群のk-d木
+// ノードを持たない暗黙の配置で、点を並べ替えた配列そのものが木になる。
+// 区間[begin, end)の中央の点がその部分木の根で、左右の子は[begin, mid)と[mid+1, end)。
+// 子をたどるとき読むのは連続した配列の一部だけなので、ポインタをたどる木よりキャッシュに載りやすい。
+// 構築後は読み取り専用なので、複数のスレッドから同時に検索してよい。
+class KdTree {
+public:
+  KdTree();
+  // pointsの写しから木を作る (大きな部分木はjobsで並列に分割する)
+  KdTree(const Vector3* points, size_t count, JobSystem& jobs = JobSystem::instance());
+  explicit KdTree(const std::vector<Vector3>& points, JobSystem& jobs = JobSystem::instance());
+
+  size_t size() const noexcept { return points_.size(); }
+  bool empty() const noexcept { return points_.empty(); }
+
+  // 最も近い点の番号 (空ならSIZE_MAX)
+  size_t nearest(const Vector3& query, float* distanceSquared = nullptr) const;
+  // 近い順にk個 (点がk個より少なければあるだけ)
+  void knn(const Vector3& query, size_t k, std::vector<Neighbor>& out) const;
+  // 距離radius以内のすべての点 (順不同)
+  void radiusSearch(const Vector3& query, float radius, std::vector<Neighbor>& out) const;
+
+  // クエリ列をまとめて並列に検索する
+  // knnはクエリごとにちょうどk個の枠を取り、足りない分はindex = SIZE_MAXで埋める
+  void knnBatch(const Vector3* queries, size_t count, size_t k, std::vector<Neighbor>& out,
+                JobSystem& jobs = JobSystem::instance()) const;
+  void radiusBatch(const Vector3* queries, size_t count, float radius, NeighborLists& out,
+                   JobSystem& jobs = JobSystem::instance()) const;
+
+private:
+  void searchKnn(size_t begin, size_t end, const Vector3& query, size_t k, std::vector<Neighbor>& heap) const;
+  void searchRadius(size_t begin, size_t end, const Vector3& query, float radiusSquared,
+                    std::vector<Neighbor>& out) const;
+
+  // 木の順に並べた点と、元の番号
+  std::vector<Vector3> points_;
+  std::vector<size_t> indices_;
+  // 各ノード (中央の位置) で分割した軸 0:x 1:y 2:z
+  std::vector<uint8_t> axes_;
+};
+
+#endif // KD_TREE_H
@@ -0,0 +1,193 @@
+#include "morton.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// 1チャンクの要素数 (符号の計算と基数ソートの各パス)
+const size_t SORT_GRAIN = 1 << 14;
+// 1パスで見る桁の最大ビット数 (ヒストグラムがL1に収まる大きさ)
+const unsigned MAX_RADIX_BITS = 11;
+
+// 下位10ビットを3ビットおきに広げる
+inline uint32_t expandBits10(uint32_t v) {
+  v &= 0x3ffu;
+  v = (v | (v << 16)) & 0x030000ffu;
+  v = (v | (v << 8)) & 0x0300f00fu;
+  v = (v | (v << 4)) & 0x030c30c3u;
+  v = (v | (v << 2)) & 0x09249249u;
+  return v;
+}
+
+// 下位21ビットを3ビットおきに広げる
+inline uint64_t expandBits21(uint64_t v) {
+  v &= 0x1fffffu;
+  v = (v | (v << 32)) & 0x001f00000000ffffull;
+  v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+  v = (v | (v << 8)) & 0x100f00f00f00f00full;
+  v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+  v = (v | (v << 2)) & 0x1249249249249249ull;
+  return v;
+}
+
+// [0, 1)を[0, 2^bits)の整数へ (NaNは0)
+inline uint32_t quantize(float v, unsigned bits) {
+  const float scale = static_cast<float>(uint32_t(1) << bits);
+  const float q = v * scale;
+  if (!(q > 0.0f)) {
+    return 0;
+  }
+  const uint32_t maximum = (uint32_t(1) << bits) - 1;
+  return q >= static_cast<float>(maximum) ? maximum : static_cast<uint32_t>(q);
+}
+
+} // namespace
+
+uint32_t mortonCode30(float x, float y, float z) {
+  return (expandBits10(quantize(x, 10)) << 2) | (expandBits10(quantize(y, 10)) << 1) |
+         expandBits10(quantize(z, 10));
+}
+
+uint64_t mortonCode63(float x, float y, float z) {
+  return (expandBits21(quantize(x, 21)) << 2) | (expandBits21(quantize(y, 21)) << 1) |
+         expandBits21(quantize(z, 21));
+}
+
+void computeMortonCodes(const Vector3* points, size_t count, std::vector<uint64_t>& codes,
+                        MortonPrecision precision, JobSystem& jobs) {
+  codes.resize(count);
+  if (count == 0) {
+    return;
+  }
+
+  // チャンクごとのバウンディングボックスをまとめる
+  const size_t chunkCount = (count + SORT_GRAIN - 1) / SORT_GRAIN;
+  std::vector<Vector3> lows(chunkCount);
+  std::vector<Vector3> highs(chunkCount);
+  jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+      const float inf = std::numeric_limits<float>::infinity();
+      Vector3 lo(inf, inf, inf);
+      Vector3 hi(-inf, -inf, -inf);
+      const size_t end = std::min(count, (c + 1) * SORT_GRAIN);
+      for (size_t i = c * SORT_GRAIN; i < end; ++i) {
+        lo = Vector3(std::min(lo.x, points[i].x), std::min(lo.y, points[i].y), std::min(lo.z, points[i].z));
+        hi = Vector3(std::max(hi.x, points[i].x), std::max(hi.y, points[i].y), std::max(hi.z, points[i].z));
+      }
+      lows[c] = lo;
+      highs[c] = hi;
+    }
+  });
+  Vector3 lo = lows[0];
+  Vector3 hi = highs[0];
+  for (size_t c = 1; c < chunkCount; ++c) {
+    lo = Vector3(std::min(lo.x, lows[c].x), std::min(lo.y, lows[c].y), std::min(lo.z, lows[c].z));
+    hi = Vector3(std::max(hi.x, highs[c].x), std::max(hi.y, highs[c].y), std::max(hi.z, highs[c].z));
+  }
+  // 幅が0の軸はすべて0に写す
+  const float sx = hi.x > lo.x ? 1.0f / (hi.x - lo.x) : 0.0f;
+  const float sy = hi.y > lo.y ? 1.0f / (hi.y - lo.y) : 0.0f;
+  const float sz = hi.z > lo.z ? 1.0f / (hi.z - lo.z) : 0.0f;
+
+  const bool wide = precision == MortonPrecision::Bits63;
+  jobs.parallelFor(0, count, SORT_GRAIN, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const float x = (points[i].x - lo.x) * sx;
+      const float y = (points[i].y - lo.y) * sy;
+      const float z = (points[i].z - lo.z) * sz;
+      codes[i] = wide ? mortonCode63(x, y, z) : mortonCode30(x, y, z);
+    }
+  });
+}
+
+void radixSortOrder(const uint64_t* keys, size_t count, unsigned keyBits, std::vector<uint32_t>& order,
+                    JobSystem& jobs) {
+  if (count > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("Too many keys for 32-bit sort indices");
+  }
+  order.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = static_cast<uint32_t>(i);
+  }
+  if (count < 2) {
+    return;
+  }
+
+  // キーと番号を組にして2つのバッファの間で書き出しを繰り返す
+  std::vector<uint64_t> keyBuffer(keys, keys + count);
+  std::vector<uint64_t> keyScratch(count);
+  std::vector<uint32_t> orderScratch(count);
+  uint64_t* srcKeys = keyBuffer.data();
+  uint64_t* dstKeys = keyScratch.data();
+  uint32_t* srcOrder = order.data();
+  uint32_t* dstOrder = orderScratch.data();
+
+  // パス数を最小にして、桁の幅を均等に割り振る (30ビットなら10ビットずつ3パス)
+  keyBits = std::min(keyBits, 64u);
+  const unsigned passCount = (keyBits + MAX_RADIX_BITS - 1) / MAX_RADIX_BITS;
+  const unsigned radixBits = passCount == 0 ? 1 : (keyBits + passCount - 1) / passCount;
+  const size_t radix = size_t(1) << radixBits;
+
+  const size_t chunkCount = (count + SORT_GRAIN - 1) / SORT_GRAIN;
+  // histograms[c * radix + d]: チャンクcの桁dの個数 (接頭和の後は書き出し位置)
+  std::vector<size_t> histograms(chunkCount * radix);
+
+  for (unsigned shift = 0; shift < keyBits; shift += radixBits) {
+    std::fill(histograms.begin(), histograms.end(), 0);
+    jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+      for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+        size_t* histogram = &histograms[c * radix];
+        const size_t end = std::min(count, (c + 1) * SORT_GRAIN);
+        for (size_t i = c * SORT_GRAIN; i < end; ++i) {
+          ++histogram[(srcKeys[i] >> shift) & (radix - 1)];
+        }
+      }
+    });
+
+    // 桁ごと、その中はチャンクの順に並ぶように書き出し位置を決める (これで安定になる)
+    size_t offset = 0;
+    bool single = false;
+    for (size_t d = 0; d < radix; ++d) {
+      const size_t before = offset;
+      for (size_t c = 0; c < chunkCount; ++c) {
+        const size_t n = histograms[c * radix + d];
+        histograms[c * radix + d] = offset;
+        offset += n;
+      }
+      if (offset - before == count) {
+        single = true;
+        break;
+      }
+    }
+    // すべて同じ桁なら並びは変わらない
+    if (single) {
+      continue;
+    }
+
+    jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+      for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+        size_t* position = &histograms[c * radix];
+        const size_t end = std::min(count, (c + 1) * SORT_GRAIN);
+        for (size_t i = c * SORT_GRAIN; i < end; ++i) {
+          const size_t slot = position[(srcKeys[i] >> shift) & (radix - 1)]++;
+          dstKeys[slot] = srcKeys[i];
+          dstOrder[slot] = srcOrder[i];
+        }
+      }
+    });
+    std::swap(srcKeys, dstKeys);
+    std::swap(srcOrder, dstOrder);
+  }
+
+  if (srcOrder != order.data()) {
+    std::copy(srcOrder, srcOrder + count, order.data());
+  }
+}
+
+void mortonOrder(const Vector3* points, size_t count, std::vector<uint32_t>& order, MortonPrecision precision,
+                 JobSystem& jobs) {
+  std::vector<uint64_t> codes;
+  computeMortonCodes(points, count, codes, precision, jobs);
+  radixSortOrder(codes.data(), count, precision == MortonPrecision::Bits63 ? 63 : 30, order, jobs);
+}
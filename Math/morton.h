@@ -0,0 +1,92 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "vector_space.h"
+#include "Core/job_system.h"
+
+// Morton符号 (Z順序曲線) の精度
+enum class MortonPrecision {
+  Bits30, // 各軸10ビット (1024分割)
+  Bits63, // 各軸21ビット
+};
+
+// [0, 1)に正規化した座標のMorton符号 (範囲外はクランプ)。ビットはx, y, zの順に上位から交互に並ぶ
+uint32_t mortonCode30(float x, float y, float z);
+uint64_t mortonCode63(float x, float y, float z);
+
+// 点列のバウンディングボックスを求め、その中で正規化した座標のMorton符号を計算する
+// (30ビットでも結果はuint64_tに入れる)
+void computeMortonCodes(const Vector3* points, size_t count, std::vector<uint64_t>& codes,
+                        MortonPrecision precision = MortonPrecision::Bits30,
+                        JobSystem& jobs = JobSystem::instance());
+
+// keysの下位keyBitsビットで安定に並べ替えたときの順序 (order[i]はi番目に来る要素の元の番号)
+// 最大11ビットずつのLSD基数ソート (30ビットなら3パス、63ビットなら6パス)。
+// 各パスはチャンクごとのヒストグラム、接頭和、書き出しをjobsで並列に行う。
+// すべてのキーが同じ桁になるパスは飛ばす。番号を32ビットで持つので、countは2^32未満であること。
+void radixSortOrder(const uint64_t* keys, size_t count, unsigned keyBits, std::vector<uint32_t>& order,
+                    JobSystem& jobs = JobSystem::instance());
+
+// 点列のMorton順 (computeMortonCodes + radixSortOrder)
+void mortonOrder(const Vector3* points, size_t count, std::vector<uint32_t>& order,
+                 MortonPrecision precision = MortonPrecision::Bits30,
+                 JobSystem& jobs = JobSystem::instance());
+
+// data[i * stride]から始まるstride個の要素をi番目の要素として、その場で並べ替える
+// 並べ替え後のi番目は元のorder[i]番目。orderが0からcount-1の置換でなければ (範囲外や重複)、
+// dataに触れる前にstd::invalid_argumentを投げる。
+// 巡回置換ごとにたどるので、追加のメモリは訪問済みの印 (1要素1バイト) とstride個の退避だけ。
+template <typename T>
+void permuteInPlace(T* data, size_t stride, const uint32_t* order, size_t count) {
+  // 印を先に置換の検査に使う (重複があると巡回が閉じずに終わらない)
+  std::vector<unsigned char> done(count, 0);
+  for (size_t i = 0; i < count; ++i) {
+    if (order[i] >= count || done[order[i]]) {
+      throw std::invalid_argument("Order is not a permutation");
+    }
+    done[order[i]] = 1;
+  }
+  std::fill(done.begin(), done.end(), 0);
+  std::vector<T> saved(stride);
+  for (size_t start = 0; start < count; ++start) {
+    if (done[start] || order[start] == start) {
+      done[start] = 1;
+      continue;
+    }
+    // startの要素を退避し、穴へ次の要素を引き寄せていく
+    for (size_t k = 0; k < stride; ++k) {
+      saved[k] = std::move(data[start * stride + k]);
+    }
+    size_t hole = start;
+    while (true) {
+      done[hole] = 1;
+      const size_t next = order[hole];
+      if (next == start) {
+        break;
+      }
+      for (size_t k = 0; k < stride; ++k) {
+        data[hole * stride + k] = std::move(data[next * stride + k]);
+      }
+      hole = next;
+    }
+    for (size_t k = 0; k < stride; ++k) {
+      data[hole * stride + k] = std::move(saved[k]);
+    }
+  }
+}
+
+template <typename T>
+void permuteInPlace(std::vector<T>& data, const std::vector<uint32_t>& order) {
+  if (data.size() != order.size()) {
+    throw std::invalid_argument("Permutation size does not match data size");
+  }
+  permuteInPlace(data.data(), 1, order.data(), order.size());
+}
+
+#endif // MORTON_H
@@ -1,16 +1,44 @@
 #include "operators.h"
+#include <algorithm>
+#include "Core/frame_arena.h"
 
-double dot(const std::vector<double>& a, const std::vector<double>& b) {
-  double sum = 0;
-  for (int i = 0; i < a.size(); ++i) {
-	sum += a[i] * b[i];
+namespace {
+
+// 並列版の1チャンクの要素数 (部分和の切れ目になるので、スレッド数によって変えない)
+const size_t VECTOR_GRAIN = 8192;
+
+// 和を4本に分けて持つと、足し算の依存が切れてSIMDレジスタに載る
+// (-ffast-mathなしでは1本の和は並べ替えられないため)
+double dotRange(const double* a, const double* b, size_t begin, size_t end) {
+  double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+	s0 += a[i] * b[i];
+	s1 += a[i + 1] * b[i + 1];
+	s2 += a[i + 2] * b[i + 2];
+	s3 += a[i + 3] * b[i + 3];
   }
-  return sum;
+  for (; i < end; ++i) {
+	s0 += a[i] * b[i];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+void axpyRange(double k, const double* x, double* y, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+	y[i] += k * x[i];
+  }
+}
+
+} // namespace
+
+double dot(const std::vector<double>& a, const std::vector<double>& b) {
+  return dotRange(a.data(), b.data(), 0, a.size());
 }
 
 std::vector<double> scalar_multiple(const std::vector<double>& a, double k) {
   std::vector<double> res(a.size());
-  for (int i = 0; i < a.size(); ++i) {
+  for (size_t i = 0; i < a.size(); ++i) {
 	res[i] = a[i] * k;
   }
   return res;
@@ -18,7 +46,7 @@ std::vector<double> scalar_multiple(const std::vector<double>& a, double k) {
 
 std::vector<double> add(const std::vector<double>& a, const std::vector<double>& b) {
   std::vector<double> res(a.size());
-  for (int i = 0; i < a.size(); ++i) {
+  for (size_t i = 0; i < a.size(); ++i) {
 	res[i] = a[i] + b[i];
   }
   return res;
@@ -26,7 +54,7 @@ std::vector<double> add(const std::vector<double>& a, const std::vector<double>&
 
 std::vector<double> sub(const std::vector<double>& a, const std::vector<double>& b) {
   std::vector<double> res(a.size());
-  for (int i = 0; i < a.size(); ++i) {
+  for (size_t i = 0; i < a.size(); ++i) {
 	res[i] = a[i] - b[i];
   }
   return res;
@@ -36,6 +64,40 @@ double norm(const std::vector<double>& a) {
   return std::sqrt(dot(a, a));
 }
 
+void axpy(double k, const std::vector<double>& x, std::vector<double>& y) {
+  axpyRange(k, x.data(), y.data(), 0, y.size());
+}
+
+double dot(const std::vector<double>& a, const std::vector<double>& b, JobSystem& jobs) {
+  const size_t size = a.size();
+  if (size <= VECTOR_GRAIN) {
+	return dot(a, b);
+  }
+  ArenaScope scratch;
+  std::pmr::vector<double> partial((size + VECTOR_GRAIN - 1) / VECTOR_GRAIN, &scratch.arena());
+  jobs.parallelFor(0, partial.size(), 1, [&](size_t begin, size_t end) {
+	for (size_t c = begin; c < end; ++c) {
+	  const size_t first = c * VECTOR_GRAIN;
+	  partial[c] = dotRange(a.data(), b.data(), first, std::min(size, first + VECTOR_GRAIN));
+	}
+  });
+  double sum = 0;
+  for (double p : partial) {
+	sum += p;
+  }
+  return sum;
+}
+
+double norm(const std::vector<double>& a, JobSystem& jobs) {
+  return std::sqrt(dot(a, a, jobs));
+}
+
+void axpy(double k, const std::vector<double>& x, std::vector<double>& y, JobSystem& jobs) {
+  jobs.parallelFor(0, y.size(), VECTOR_GRAIN, [&](size_t begin, size_t end) {
+	axpyRange(k, x.data(), y.data(), begin, end);
+  });
+}
+
 std::vector<double> operator+(const std::vector<double>& a, const std::vector<double>& b) {
   return add(a, b);
 }
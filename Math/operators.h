@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cmath>
+#include "Core/job_system.h"
 
 // ベクトルの内積
 double dot(const std::vector<double>& a, const std::vector<double>& b);
@@ -19,6 +20,15 @@ std::vector<double> sub(const std::vector<double>& a, const std::vector<double>&
 // ベクトルのノルム
 double norm(const std::vector<double>& a);
 
+// y += k * x (yをその場で書き換えるので一時ベクトルを作らない)
+void axpy(double k, const std::vector<double>& x, std::vector<double>& y);
+
+// 大きなベクトル向けの並列版
+// 部分和は決まった大きさのチャンクごとに取り、チャンクの順に足すので、結果はスレッド数によらない
+double dot(const std::vector<double>& a, const std::vector<double>& b, JobSystem& jobs);
+double norm(const std::vector<double>& a, JobSystem& jobs);
+void axpy(double k, const std::vector<double>& x, std::vector<double>& y, JobSystem& jobs);
+
 // 演算子オーバーロード
 std::vector<double> operator+(const std::vector<double>& a, const std::vector<double>& b);
 std::vector<double> operator-(const std::vector<double>& a, const std::vector<double>& b);
@@ -1,4 +1,5 @@
 #include "quaternion.h"
+#include <algorithm>
 #include <cmath>
 
 Quaternion::Quaternion() : w(1.0f), x(0.0f), y(0.0f), z(0.0f) {}
@@ -67,6 +68,36 @@ glm::mat4 Quaternion::toMatrix() const {
     return result;
 }
 
+// 回転行列から変換
+Quaternion Quaternion::fromMatrix(const Matrix3& m) {
+    const float trace = m.m[0][0] + m.m[1][1] + m.m[2][2];
+    Quaternion q;
+    if (trace >= m.m[0][0] && trace >= m.m[1][1] && trace >= m.m[2][2]) {
+        // wが最大 (4w^2 = 1 + trace)
+        const float s = 2.0f * std::sqrt(std::max(0.0f, 1.0f + trace));
+        q = Quaternion(0.25f * s, (m.m[2][1] - m.m[1][2]) / s, (m.m[0][2] - m.m[2][0]) / s,
+                       (m.m[1][0] - m.m[0][1]) / s);
+    } else if (m.m[0][0] >= m.m[1][1] && m.m[0][0] >= m.m[2][2]) {
+        const float s = 2.0f * std::sqrt(std::max(0.0f, 1.0f + m.m[0][0] - m.m[1][1] - m.m[2][2]));
+        q = Quaternion((m.m[2][1] - m.m[1][2]) / s, 0.25f * s, (m.m[0][1] + m.m[1][0]) / s,
+                       (m.m[0][2] + m.m[2][0]) / s);
+    } else if (m.m[1][1] >= m.m[2][2]) {
+        const float s = 2.0f * std::sqrt(std::max(0.0f, 1.0f - m.m[0][0] + m.m[1][1] - m.m[2][2]));
+        q = Quaternion((m.m[0][2] - m.m[2][0]) / s, (m.m[0][1] + m.m[1][0]) / s, 0.25f * s,
+                       (m.m[1][2] + m.m[2][1]) / s);
+    } else {
+        const float s = 2.0f * std::sqrt(std::max(0.0f, 1.0f - m.m[0][0] - m.m[1][1] + m.m[2][2]));
+        q = Quaternion((m.m[1][0] - m.m[0][1]) / s, (m.m[0][2] + m.m[2][0]) / s, (m.m[1][2] + m.m[2][1]) / s,
+                       0.25f * s);
+    }
+    // w >= 0 にそろえる
+    if (q.w < 0.0f) {
+        q = q * -1.0f;
+    }
+    q.normalize();
+    return q;
+}
+
 // 線形補間
 Quaternion Quaternion::lerp(const Quaternion& q1, const Quaternion& q2, float t) {
     return q1 * (1.0f - t) + q2 * t;
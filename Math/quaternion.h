@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "vector_space.h"
 
 // 四元数クラス
 class Quaternion {
@@ -35,15 +36,19 @@ public:
     // 回転行列に変換
     glm::mat4 toMatrix() const;
 
+    // 回転行列 (m[行][列]) から変換する。toMatrixの添字をm[行][列]と読んだものの逆になる
+    // 対角成分の大きい側から求める (Shepperdの方法) ので、180度近くの回転でも精度が落ちない
+    static Quaternion fromMatrix(const Matrix3& m);
+
     //線型補間
     static Quaternion lerp(const Quaternion& q1, const Quaternion& q2, float t);
 
   };
 
 //四元数の共役
-inline Quaternion conjugate(const Quaternion& q);
+Quaternion conjugate(const Quaternion& q);
 
 // 四元数の逆元
-inline Quaternion inverse(const Quaternion& q);
+Quaternion inverse(const Quaternion& q);
 
 #endif // QUATERNION_H
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "sparse_matrix.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// 並列SpMVの1チャンクの行数
+const size_t SPMV_GRAIN = 1024;
+
+} // namespace
+
+// SparseMatrix
+SparseMatrix::SparseMatrix() : rows_(0), cols_(0), rowOffsets_(1, 0) {}
+
+SparseMatrix::SparseMatrix(size_t rows, size_t cols) : rows_(rows), cols_(cols), rowOffsets_(rows + 1, 0) {}
+
+SparseMatrix SparseMatrix::fromTriplets(size_t rows, size_t cols, const std::vector<Triplet>& triplets) {
+  SparseMatrix matrix(rows, cols);
+
+  // 行ごとの個数を数えてから、行の順に並べ替える (計数ソート)
+  std::vector<size_t> counts(rows + 1, 0);
+  for (const Triplet& t : triplets) {
+    if (t.row >= rows || t.col >= cols) {
+      throw std::out_of_range("Triplet is outside of the matrix");
+    }
+    ++counts[t.row + 1];
+  }
+  for (size_t i = 0; i < rows; ++i) {
+    counts[i + 1] += counts[i];
+  }
+  std::vector<std::pair<size_t, double>> entries(triplets.size());
+  std::vector<size_t> cursor(counts.begin(), counts.end() - 1);
+  for (const Triplet& t : triplets) {
+    entries[cursor[t.row]++] = std::make_pair(t.col, t.value);
+  }
+
+  // 行の中を列で並べ、重複をまとめる
+  matrix.columnIndices_.reserve(entries.size());
+  matrix.values_.reserve(entries.size());
+  for (size_t i = 0; i < rows; ++i) {
+    auto first = entries.begin() + counts[i];
+    auto last = entries.begin() + counts[i + 1];
+    std::sort(first, last, [](const std::pair<size_t, double>& a, const std::pair<size_t, double>& b) {
+      return a.first < b.first;
+    });
+    for (auto it = first; it != last; ++it) {
+      if (matrix.columnIndices_.size() > matrix.rowOffsets_[i] && matrix.columnIndices_.back() == it->first) {
+        matrix.values_.back() += it->second;
+      } else {
+        matrix.columnIndices_.push_back(it->first);
+        matrix.values_.push_back(it->second);
+      }
+    }
+    matrix.rowOffsets_[i + 1] = matrix.columnIndices_.size();
+  }
+  return matrix;
+}
+
+double SparseMatrix::coeff(size_t row, size_t col) const {
+  const auto first = columnIndices_.begin() + rowOffsets_[row];
+  const auto last = columnIndices_.begin() + rowOffsets_[row + 1];
+  const auto it = std::lower_bound(first, last, col);
+  if (it == last || *it != col) {
+    return 0;
+  }
+  return values_[it - columnIndices_.begin()];
+}
+
+std::vector<double> SparseMatrix::diagonal() const {
+  std::vector<double> d(std::min(rows_, cols_));
+  for (size_t i = 0; i < d.size(); ++i) {
+    d[i] = coeff(i, i);
+  }
+  return d;
+}
+
+void SparseMatrix::multiply(const std::vector<double>& x, std::vector<double>& y) const {
+  if (x.size() != cols_) {
+    throw std::invalid_argument("Vector size does not match the matrix");
+  }
+  y.resize(rows_);
+  multiplyRows(x.data(), y.data(), 0, rows_);
+}
+
+void SparseMatrix::multiply(const std::vector<double>& x, std::vector<double>& y, JobSystem& jobs) const {
+  if (x.size() != cols_) {
+    throw std::invalid_argument("Vector size does not match the matrix");
+  }
+  y.resize(rows_);
+  jobs.parallelFor(0, rows_, SPMV_GRAIN, [&](size_t begin, size_t end) {
+    multiplyRows(x.data(), y.data(), begin, end);
+  });
+}
+
+void SparseMatrix::multiplyRows(const double* x, double* y, size_t begin, size_t end) const {
+  const size_t* offsets = rowOffsets_.data();
+  const size_t* columns = columnIndices_.data();
+  const double* values = values_.data();
+  for (size_t i = begin; i < end; ++i) {
+    double sum = 0;
+    for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+      sum += values[k] * x[columns[k]];
+    }
+    y[i] = sum;
+  }
+}
+
+// BlockSparseMatrix
+BlockSparseMatrix::BlockSparseMatrix() : blockSize_(1), blockRows_(0), blockCols_(0), rowOffsets_(1, 0) {}
+
+BlockSparseMatrix BlockSparseMatrix::fromCsr(const SparseMatrix& matrix, size_t blockSize) {
+  if (blockSize == 0 || matrix.rows() % blockSize != 0 || matrix.cols() % blockSize != 0) {
+    throw std::invalid_argument("Matrix size is not a multiple of the block size");
+  }
+  BlockSparseMatrix result;
+  result.blockSize_ = blockSize;
+  result.blockRows_ = matrix.rows() / blockSize;
+  result.blockCols_ = matrix.cols() / blockSize;
+  result.rowOffsets_.assign(result.blockRows_ + 1, 0);
+
+  const std::vector<size_t>& offsets = matrix.getRowOffsets();
+  const std::vector<size_t>& columns = matrix.getColumnIndices();
+  const std::vector<double>& values = matrix.getValues();
+  const size_t blockArea = blockSize * blockSize;
+
+  // ブロック列 -> このブロック行の中での位置 (使い終わったら戻す)
+  std::vector<size_t> slot(result.blockCols_, SIZE_MAX);
+  std::vector<size_t> used;
+  for (size_t br = 0; br < result.blockRows_; ++br) {
+    used.clear();
+    for (size_t r = br * blockSize; r < (br + 1) * blockSize; ++r) {
+      for (size_t k = offsets[r]; k < offsets[r + 1]; ++k) {
+        const size_t bc = columns[k] / blockSize;
+        if (slot[bc] == SIZE_MAX) {
+          slot[bc] = 0;
+          used.push_back(bc);
+        }
+      }
+    }
+    std::sort(used.begin(), used.end());
+    const size_t base = result.blockColumns_.size();
+    for (size_t i = 0; i < used.size(); ++i) {
+      slot[used[i]] = base + i;
+      result.blockColumns_.push_back(used[i]);
+    }
+    result.values_.resize(result.blockColumns_.size() * blockArea, 0.0);
+    for (size_t r = br * blockSize; r < (br + 1) * blockSize; ++r) {
+      for (size_t k = offsets[r]; k < offsets[r + 1]; ++k) {
+        const size_t bc = columns[k] / blockSize;
+        const size_t local = (r % blockSize) * blockSize + columns[k] % blockSize;
+        result.values_[slot[bc] * blockArea + local] = values[k];
+      }
+    }
+    for (size_t bc : used) {
+      slot[bc] = SIZE_MAX;
+    }
+    result.rowOffsets_[br + 1] = result.blockColumns_.size();
+  }
+  return result;
+}
+
+void BlockSparseMatrix::multiply(const std::vector<double>& x, std::vector<double>& y) const {
+  if (x.size() != cols()) {
+    throw std::invalid_argument("Vector size does not match the matrix");
+  }
+  y.resize(rows());
+  multiplyBlockRows(x.data(), y.data(), 0, blockRows_);
+}
+
+void BlockSparseMatrix::multiply(const std::vector<double>& x, std::vector<double>& y, JobSystem& jobs) const {
+  if (x.size() != cols()) {
+    throw std::invalid_argument("Vector size does not match the matrix");
+  }
+  y.resize(rows());
+  const size_t grain = std::max<size_t>(1, SPMV_GRAIN / blockSize_);
+  jobs.parallelFor(0, blockRows_, grain, [&](size_t begin, size_t end) {
+    multiplyBlockRows(x.data(), y.data(), begin, end);
+  });
+}
+
+void BlockSparseMatrix::multiplyBlockRows(const double* x, double* y, size_t begin, size_t end) const {
+  const size_t b = blockSize_;
+  const size_t blockArea = b * b;
+  for (size_t br = begin; br < end; ++br) {
+    double* out = y + br * b;
+    std::fill(out, out + b, 0.0);
+    for (size_t k = rowOffsets_[br]; k < rowOffsets_[br + 1]; ++k) {
+      const double* block = &values_[k * blockArea];
+      const double* in = x + blockColumns_[k] * b;
+      for (size_t r = 0; r < b; ++r) {
+        double sum = 0;
+        for (size_t c = 0; c < b; ++c) {
+          sum += block[r * b + c] * in[c];
+        }
+        out[r] += sum;
+      }
+    }
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <cstddef>
+#include <vector>
+#include "Core/job_system.h"
+
+// 疎行列を組み立てるときの1要素 (同じ位置の要素は足し合わされる)
+struct Triplet {
+  size_t row;
+  size_t col;
+  double value;
+};
+
+// CSR (Compressed Sparse Row) 形式の疎行列
+// 行iの要素は columnIndices[rowOffsets[i]] から columnIndices[rowOffsets[i+1]-1] まで、列の昇順に並ぶ
+class SparseMatrix {
+public:
+  SparseMatrix();
+  SparseMatrix(size_t rows, size_t cols);
+
+  // 三つ組から作る (順不同、重複は足し合わせる、0の要素も構造として残す)
+  static SparseMatrix fromTriplets(size_t rows, size_t cols, const std::vector<Triplet>& triplets);
+
+  size_t rows() const noexcept { return rows_; }
+  size_t cols() const noexcept { return cols_; }
+  size_t nonZeros() const noexcept { return values_.size(); }
+
+  const std::vector<size_t>& getRowOffsets() const noexcept { return rowOffsets_; }
+  const std::vector<size_t>& getColumnIndices() const noexcept { return columnIndices_; }
+  const std::vector<double>& getValues() const noexcept { return values_; }
+  // 構造は変えずに値だけ書き換える
+  std::vector<double>& getValues() noexcept { return values_; }
+
+  // (row, col)の値 (構造に無ければ0)
+  double coeff(size_t row, size_t col) const;
+  // 対角成分
+  std::vector<double> diagonal() const;
+
+  // y = A x (yは必要ならリサイズする)
+  void multiply(const std::vector<double>& x, std::vector<double>& y) const;
+  // 行ごとに分けて並列に計算する (各行の和は逐次版と同じ順に取る)
+  void multiply(const std::vector<double>& x, std::vector<double>& y, JobSystem& jobs) const;
+
+private:
+  void multiplyRows(const double* x, double* y, size_t begin, size_t end) const;
+
+  size_t rows_;
+  size_t cols_;
+  std::vector<size_t> rowOffsets_;
+  std::vector<size_t> columnIndices_;
+  std::vector<double> values_;
+};
+
+// BSR (Block Sparse Row) 形式の疎行列
+// blockSize x blockSize の密ブロックを単位に持つので、xyzをまとめて解く行列などで添字の読み込みが減る
+class BlockSparseMatrix {
+public:
+  BlockSparseMatrix();
+
+  // CSRからブロックにまとめる (行数・列数はblockSizeの倍数であること)
+  // 要素が1つでもあるブロックは密に持つ
+  static BlockSparseMatrix fromCsr(const SparseMatrix& matrix, size_t blockSize);
+
+  size_t rows() const noexcept { return blockRows_ * blockSize_; }
+  size_t cols() const noexcept { return blockCols_ * blockSize_; }
+  size_t getBlockSize() const noexcept { return blockSize_; }
+  size_t blockCount() const noexcept { return blockColumns_.size(); }
+
+  const std::vector<size_t>& getRowOffsets() const noexcept { return rowOffsets_; }
+  const std::vector<size_t>& getBlockColumns() const noexcept { return blockColumns_; }
+  // ブロックごとに行優先で blockSize * blockSize 個ずつ並ぶ
+  const std::vector<double>& getValues() const noexcept { return values_; }
+
+  // y = A x
+  void multiply(const std::vector<double>& x, std::vector<double>& y) const;
+  void multiply(const std::vector<double>& x, std::vector<double>& y, JobSystem& jobs) const;
+
+private:
+  void multiplyBlockRows(const double* x, double* y, size_t begin, size_t end) const;
+
+  size_t blockSize_;
+  size_t blockRows_;
+  size_t blockCols_;
+  std::vector<size_t> rowOffsets_;
+  std::vector<size_t> blockColumns_;
+  std::vector<double> values_;
+};
+
+#endif // SPARSE_MATRIX_H
@@ -0,0 +1,361 @@
+#include "spatial_hash_grid.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// 一括クエリの1チャンクのクエリ数
+const size_t QUERY_GRAIN = 256;
+
+// セル座標の上限 (リングの計算がint64で溢れず、int32にも収まる)
+const int32_t CELL_LIMIT = 1 << 30;
+
+// NaNは下端へ寄せる (挿入では弾くので、NaNのクエリが意味のない結果を返すだけ)
+inline int32_t clampCell(float cell) {
+  if (cell >= static_cast<float>(CELL_LIMIT)) {
+    return CELL_LIMIT;
+  }
+  if (cell > -static_cast<float>(CELL_LIMIT)) {
+    return static_cast<int32_t>(cell);
+  }
+  return -CELL_LIMIT;
+}
+
+inline void requireFinite(const Vector3& point) {
+  if (!std::isfinite(point.x) || !std::isfinite(point.y) || !std::isfinite(point.z)) {
+    throw std::invalid_argument("Grid point must be finite");
+  }
+}
+
+inline float distanceSquared(const Vector3& a, const Vector3& b) {
+  const float dx = a.x - b.x;
+  const float dy = a.y - b.y;
+  const float dz = a.z - b.z;
+  return dx * dx + dy * dy + dz * dz;
+}
+
+inline bool closer(const Neighbor& a, const Neighbor& b) {
+  return a.distanceSquared < b.distanceSquared;
+}
+
+} // namespace
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+    : cellSize_(cellSize), inverseCellSize_(1.0f / cellSize), count_(0),
+      minCell_{0, 0, 0}, maxCell_{-1, -1, -1} {
+  if (!(cellSize > 0)) {
+    throw std::invalid_argument("Cell size must be positive");
+  }
+}
+
+SpatialHashGrid::CellCoord SpatialHashGrid::cellOf(const Vector3& point) const {
+  return CellCoord{clampCell(std::floor(point.x * inverseCellSize_)),
+                   clampCell(std::floor(point.y * inverseCellSize_)),
+                   clampCell(std::floor(point.z * inverseCellSize_))};
+}
+
+// 各軸21ビットに詰める (±2^20セルを超えると別のセルと同じキーになるが、距離は毎回測るので結果は変わらない)
+uint64_t SpatialHashGrid::cellKey(const CellCoord& cell) {
+  const uint64_t mask = (1u << 21) - 1;
+  return ((static_cast<uint64_t>(cell.x) & mask) << 42) |
+         ((static_cast<uint64_t>(cell.y) & mask) << 21) |
+         (static_cast<uint64_t>(cell.z) & mask);
+}
+
+size_t SpatialHashGrid::insert(const Vector3& point) {
+  requireFinite(point);
+  size_t handle;
+  if (!freeHandles_.empty()) {
+    handle = freeHandles_.back();
+    freeHandles_.pop_back();
+    points_[handle] = point;
+    alive_[handle] = true;
+  } else {
+    handle = points_.size();
+    points_.push_back(point);
+    cellCoords_.push_back(CellCoord{0, 0, 0});
+    slots_.push_back(0);
+    alive_.push_back(true);
+  }
+  addToCell(handle);
+  ++count_;
+  updateBounds();
+  return handle;
+}
+
+void SpatialHashGrid::remove(size_t handle) {
+  if (handle >= points_.size() || !alive_[handle]) {
+    throw std::out_of_range("Invalid grid handle");
+  }
+  removeFromCell(handle);
+  alive_[handle] = false;
+  freeHandles_.push_back(handle);
+  --count_;
+  updateBounds();
+}
+
+void SpatialHashGrid::move(size_t handle, const Vector3& point) {
+  if (handle >= points_.size() || !alive_[handle]) {
+    throw std::out_of_range("Invalid grid handle");
+  }
+  requireFinite(point);
+  points_[handle] = point;
+  // 同じセルの中で動いただけなら何もしない
+  const CellCoord cell = cellOf(point);
+  const CellCoord& old = cellCoords_[handle];
+  if (cell.x != old.x || cell.y != old.y || cell.z != old.z) {
+    removeFromCell(handle);
+    addToCell(handle);
+    updateBounds();
+  }
+}
+
+void SpatialHashGrid::rebuild(const Vector3* points, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    requireFinite(points[i]);
+  }
+  clear();
+  points_.assign(points, points + count);
+  cellCoords_.resize(count);
+  slots_.resize(count);
+  alive_.assign(count, true);
+  cells_.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    addToCell(i);
+  }
+  count_ = count;
+  updateBounds();
+}
+
+void SpatialHashGrid::clear() {
+  cells_.clear();
+  points_.clear();
+  cellCoords_.clear();
+  slots_.clear();
+  alive_.clear();
+  freeHandles_.clear();
+  count_ = 0;
+  for (std::map<int32_t, size_t>& counts : axisCounts_) {
+    counts.clear();
+  }
+  minCell_ = CellCoord{0, 0, 0};
+  maxCell_ = CellCoord{-1, -1, -1};
+}
+
+void SpatialHashGrid::addToCell(size_t handle) {
+  const CellCoord cell = cellOf(points_[handle]);
+  ++axisCounts_[0][cell.x];
+  ++axisCounts_[1][cell.y];
+  ++axisCounts_[2][cell.z];
+  std::vector<size_t>& bucket = cells_[cellKey(cell)];
+  cellCoords_[handle] = cell;
+  slots_[handle] = bucket.size();
+  bucket.push_back(handle);
+}
+
+void SpatialHashGrid::removeFromCell(size_t handle) {
+  const CellCoord& cell = cellCoords_[handle];
+  const int32_t coords[3] = {cell.x, cell.y, cell.z};
+  for (int axis = 0; axis < 3; ++axis) {
+    auto count = axisCounts_[axis].find(coords[axis]);
+    if (--count->second == 0) {
+      axisCounts_[axis].erase(count);
+    }
+  }
+  auto it = cells_.find(cellKey(cell));
+  std::vector<size_t>& bucket = it->second;
+  // 末尾の点を空いた位置へ移す
+  const size_t slot = slots_[handle];
+  bucket[slot] = bucket.back();
+  slots_[bucket[slot]] = slot;
+  bucket.pop_back();
+  if (bucket.empty()) {
+    cells_.erase(it);
+  }
+}
+
+void SpatialHashGrid::updateBounds() {
+  if (count_ == 0) {
+    minCell_ = CellCoord{0, 0, 0};
+    maxCell_ = CellCoord{-1, -1, -1};
+    return;
+  }
+  minCell_ = CellCoord{axisCounts_[0].begin()->first, axisCounts_[1].begin()->first, axisCounts_[2].begin()->first};
+  maxCell_ = CellCoord{axisCounts_[0].rbegin()->first, axisCounts_[1].rbegin()->first,
+                       axisCounts_[2].rbegin()->first};
+}
+
+double SpatialHashGrid::clippedVolume(const CellCoord& lo, const CellCoord& hi) const {
+  const double x = std::min(hi.x, maxCell_.x) - std::max(lo.x, minCell_.x) + 1.0;
+  const double y = std::min(hi.y, maxCell_.y) - std::max(lo.y, minCell_.y) + 1.0;
+  const double z = std::min(hi.z, maxCell_.z) - std::max(lo.z, minCell_.z) + 1.0;
+  return x > 0 && y > 0 && z > 0 ? x * y * z : 0.0;
+}
+
+template <typename Visit>
+void SpatialHashGrid::visitRing(const CellCoord& center, int64_t ring, const Visit& visit) const {
+  const int64_t x0 = std::max<int64_t>(center.x - ring, minCell_.x);
+  const int64_t x1 = std::min<int64_t>(center.x + ring, maxCell_.x);
+  const int64_t y0 = std::max<int64_t>(center.y - ring, minCell_.y);
+  const int64_t y1 = std::min<int64_t>(center.y + ring, maxCell_.y);
+  const int64_t z0 = std::max<int64_t>(center.z - ring, minCell_.z);
+  const int64_t z1 = std::min<int64_t>(center.z + ring, maxCell_.z);
+  for (int64_t x = x0; x <= x1; ++x) {
+    for (int64_t y = y0; y <= y1; ++y) {
+      // x, yが表面に無ければ、zは両端だけが表面
+      const bool onSurface = x == center.x - ring || x == center.x + ring ||
+                             y == center.y - ring || y == center.y + ring;
+      const int64_t step = onSurface || ring == 0 ? 1 : 2 * ring;
+      // 範囲で切ったときは、表面の最初のzから始める
+      int64_t z = center.z - ring;
+      if (z < z0) {
+        z += (z0 - z + step - 1) / step * step;
+      }
+      for (; z <= z1; z += step) {
+        auto it = cells_.find(cellKey(CellCoord{static_cast<int32_t>(x), static_cast<int32_t>(y),
+                                                static_cast<int32_t>(z)}));
+        if (it == cells_.end()) {
+          continue;
+        }
+        for (size_t handle : it->second) {
+          visit(handle);
+        }
+      }
+    }
+  }
+}
+
+void SpatialHashGrid::knn(const Vector3& query, size_t k, std::vector<Neighbor>& out) const {
+  out.clear();
+  if (k == 0 || count_ == 0) {
+    return;
+  }
+  const auto consider = [&](size_t handle) {
+    const float d = distanceSquared(points_[handle], query);
+    if (out.size() < k) {
+      out.push_back(Neighbor{handle, d});
+      std::push_heap(out.begin(), out.end(), closer);
+    } else if (d < out.front().distanceSquared) {
+      std::pop_heap(out.begin(), out.end(), closer);
+      out.back() = Neighbor{handle, d};
+      std::push_heap(out.begin(), out.end(), closer);
+    }
+  };
+  const CellCoord center = cellOf(query);
+  const int64_t cx = center.x, cy = center.y, cz = center.z;
+  // 点のある範囲に届く最初のリングと、これより外には点が無いリング
+  const int64_t firstRing = std::max({minCell_.x - cx, cx - maxCell_.x, minCell_.y - cy, cy - maxCell_.y,
+                                      minCell_.z - cz, cz - maxCell_.z, int64_t(0)});
+  const int64_t lastRing = std::max({cx - minCell_.x, maxCell_.x - cx, cy - minCell_.y, maxCell_.y - cy,
+                                     cz - minCell_.z, maxCell_.z - cz, int64_t(0)});
+  for (int64_t ring = firstRing; ring <= lastRing; ++ring) {
+    // 調べるセルが点の数を超えるなら、すべての点を見た方が安い
+    const int32_t r = static_cast<int32_t>(std::min<int64_t>(ring, CELL_LIMIT));
+    const CellCoord lo{static_cast<int32_t>(std::max<int64_t>(cx - r, -CELL_LIMIT)),
+                       static_cast<int32_t>(std::max<int64_t>(cy - r, -CELL_LIMIT)),
+                       static_cast<int32_t>(std::max<int64_t>(cz - r, -CELL_LIMIT))};
+    const CellCoord hi{static_cast<int32_t>(std::min<int64_t>(cx + r, CELL_LIMIT)),
+                       static_cast<int32_t>(std::min<int64_t>(cy + r, CELL_LIMIT)),
+                       static_cast<int32_t>(std::min<int64_t>(cz + r, CELL_LIMIT))};
+    if (clippedVolume(lo, hi) > static_cast<double>(count_)) {
+      out.clear();
+      for (size_t handle = 0; handle < points_.size(); ++handle) {
+        if (alive_[handle]) {
+          consider(handle);
+        }
+      }
+      break;
+    }
+    visitRing(center, ring, consider);
+    // まだ見ていないセルの点は、少なくともring * cellSizeだけ離れている
+    const float reach = ring * cellSize_;
+    if (out.size() == k && out.front().distanceSquared <= reach * reach) {
+      break;
+    }
+  }
+  std::sort_heap(out.begin(), out.end(), closer);
+}
+
+void SpatialHashGrid::radiusSearch(const Vector3& query, float radius, std::vector<Neighbor>& out) const {
+  out.clear();
+  if (count_ == 0) {
+    return;
+  }
+  const float radiusSquared = radius * radius;
+  const CellCoord lo = cellOf(Vector3(query.x - radius, query.y - radius, query.z - radius));
+  const CellCoord hi = cellOf(Vector3(query.x + radius, query.y + radius, query.z + radius));
+  // 調べるセルが点の数を超えるなら、すべての点を見た方が安い
+  if (clippedVolume(lo, hi) > static_cast<double>(count_)) {
+    for (size_t handle = 0; handle < points_.size(); ++handle) {
+      if (!alive_[handle]) {
+        continue;
+      }
+      const float d = distanceSquared(points_[handle], query);
+      if (d <= radiusSquared) {
+        out.push_back(Neighbor{handle, d});
+      }
+    }
+    return;
+  }
+  // 点のある範囲の外のセルは調べない
+  const int32_t x0 = std::max(lo.x, minCell_.x), x1 = std::min(hi.x, maxCell_.x);
+  const int32_t y0 = std::max(lo.y, minCell_.y), y1 = std::min(hi.y, maxCell_.y);
+  const int32_t z0 = std::max(lo.z, minCell_.z), z1 = std::min(hi.z, maxCell_.z);
+  for (int32_t x = x0; x <= x1; ++x) {
+    for (int32_t y = y0; y <= y1; ++y) {
+      for (int32_t z = z0; z <= z1; ++z) {
+        auto it = cells_.find(cellKey(CellCoord{x, y, z}));
+        if (it == cells_.end()) {
+          continue;
+        }
+        for (size_t handle : it->second) {
+          const float d = distanceSquared(points_[handle], query);
+          if (d <= radiusSquared) {
+            out.push_back(Neighbor{handle, d});
+          }
+        }
+      }
+    }
+  }
+}
+
+void SpatialHashGrid::knnBatch(const Vector3* queries, size_t count, size_t k, std::vector<Neighbor>& out,
+                               JobSystem& jobs) const {
+  out.assign(count * k, Neighbor{SIZE_MAX, 0.0f});
+  jobs.parallelFor(0, count, QUERY_GRAIN, [&](size_t begin, size_t end) {
+    std::vector<Neighbor> result;
+    for (size_t q = begin; q < end; ++q) {
+      knn(queries[q], k, result);
+      std::copy(result.begin(), result.end(), out.begin() + q * k);
+    }
+  });
+}
+
+void SpatialHashGrid::radiusBatch(const Vector3* queries, size_t count, float radius, NeighborLists& out,
+                                  JobSystem& jobs) const {
+  // KdTree::radiusBatchと同じく、チャンクごとに集めてからつなぐ
+  const size_t chunkCount = (count + QUERY_GRAIN - 1) / QUERY_GRAIN;
+  std::vector<std::vector<Neighbor>> chunks(chunkCount);
+  out.offsets.assign(count + 1, 0);
+  jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+    std::vector<Neighbor> result;
+    for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+      const size_t end = std::min(count, (c + 1) * QUERY_GRAIN);
+      for (size_t q = c * QUERY_GRAIN; q < end; ++q) {
+        radiusSearch(queries[q], radius, result);
+        chunks[c].insert(chunks[c].end(), result.begin(), result.end());
+        out.offsets[q + 1] = result.size();
+      }
+    }
+  });
+  for (size_t q = 0; q < count; ++q) {
+    out.offsets[q + 1] += out.offsets[q];
+  }
+  out.neighbors.resize(out.offsets[count]);
+  jobs.parallelFor(0, chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd) {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+      std::copy(chunks[c].begin(), chunks[c].end(), out.neighbors.begin() + out.offsets[c * QUERY_GRAIN]);
+    }
+  });
+}
@@ -0,0 +1,81 @@
+#ifndef SPATIAL_HASH_GRID_H
+#define SPATIAL_HASH_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "vector_space.h"
+#include "kd_tree.h"
+#include "Core/job_system.h"
+
+// 一様な格子をハッシュで持つ空間索引
+// 点の追加・削除・移動がO(1)なので、毎フレーム動く点の近傍探索に使う (動かない点群ならKdTreeの方が速い)。
+// 点は追加したときに返すハンドルで区別する。削除したハンドルは後の追加で使い回される。
+// 検索は読み取りだけなので複数のスレッドから同時に行ってよいが、更新と同時に行ってはいけない。
+class SpatialHashGrid {
+public:
+  // cellSizeは検索半径と同じくらいにすると、半径検索で調べるセルが3x3x3に収まる
+  explicit SpatialHashGrid(float cellSize);
+
+  float getCellSize() const noexcept { return cellSize_; }
+  size_t size() const noexcept { return count_; }
+
+  // 点を追加してハンドルを返す (座標がNaN・無限大ならstd::invalid_argument)
+  size_t insert(const Vector3& point);
+  void remove(size_t handle);
+  void move(size_t handle, const Vector3& point);
+  const Vector3& getPoint(size_t handle) const { return points_[handle]; }
+  // すべて消して、points[i]をハンドルiとして入れ直す
+  void rebuild(const Vector3* points, size_t count);
+  void clear();
+
+  // 結果のindexはハンドル
+  // 近い順にk個 (点がk個より少なければあるだけ)
+  void knn(const Vector3& query, size_t k, std::vector<Neighbor>& out) const;
+  // 距離radius以内のすべての点 (順不同)
+  void radiusSearch(const Vector3& query, float radius, std::vector<Neighbor>& out) const;
+  // KdTreeの一括クエリと同じ形で返す
+  void knnBatch(const Vector3* queries, size_t count, size_t k, std::vector<Neighbor>& out,
+                JobSystem& jobs = JobSystem::instance()) const;
+  void radiusBatch(const Vector3* queries, size_t count, float radius, NeighborLists& out,
+                   JobSystem& jobs = JobSystem::instance()) const;
+
+private:
+  struct CellCoord {
+    int32_t x, y, z;
+  };
+
+  // 座標は±CELL_LIMITセルに丸める (それより遠い点も同じ端のセルに入るだけで、距離は正しく測る)
+  CellCoord cellOf(const Vector3& point) const;
+  static uint64_t cellKey(const CellCoord& cell);
+  void addToCell(size_t handle);
+  void removeFromCell(size_t handle);
+  // axisCounts_からminCell_, maxCell_を求め直す
+  void updateBounds();
+  // cellを中心とする一辺2*ring+1の立方体の表面にあるセルのうち、点のある範囲の中のセルの点を調べる
+  template <typename Visit>
+  void visitRing(const CellCoord& center, int64_t ring, const Visit& visit) const;
+  // 点のある範囲と[lo, hi]の共通部分のセル数
+  double clippedVolume(const CellCoord& lo, const CellCoord& hi) const;
+
+  float cellSize_;
+  float inverseCellSize_;
+  // セルごとの点のハンドル
+  std::unordered_map<uint64_t, std::vector<size_t>> cells_;
+  // ハンドルごとの位置・セル・セルの中での位置
+  std::vector<Vector3> points_;
+  std::vector<CellCoord> cellCoords_;
+  std::vector<size_t> slots_;
+  std::vector<bool> alive_;
+  std::vector<size_t> freeHandles_;
+  size_t count_;
+  // 軸ごとの、セル座標ごとの点の数 (削除・移動でも範囲を縮められるように持つ)
+  std::map<int32_t, size_t> axisCounts_[3];
+  // 点のあるセルの範囲 (knnと半径検索はこの外を調べない)
+  CellCoord minCell_;
+  CellCoord maxCell_;
+};
+
+#endif // SPATIAL_HASH_GRID_H
@@ -0,0 +1,273 @@
+#include "svd3.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// 一括版で1度に計算する行列の数 (AVXの8レーン分。SSEなら2回に分かれる)
+const size_t LANES = 8;
+// 並列に計算する1チャンクの行列数
+const size_t SVD_GRAIN = 1024;
+// ヤコビ法の掃引回数 (2次収束するので、単精度ならこれで列の内積は丸め誤差まで小さくなる)
+const int JACOBI_SWEEPS = 5;
+// 0で割らないように分母に足す値
+const float TINY = std::numeric_limits<float>::min();
+// 2つ目の特異値を0とみなす、1つ目との2乗の比
+const float RANK_TOLERANCE = 1e-12f;
+// 列の内積を0とみなす、フロベニウスノルムの2乗との比
+// 収束した後の内積は小さくなり続け、2乗が非正規化数になると極端に遅くなるので打ち切る
+const float OFF_DIAGONAL_TOLERANCE = 1e-14f;
+
+// Lレーン分の3x3行列をSoAで持つ (m[行][列][レーン])
+template <size_t L>
+struct SvdLanes {
+  float a[3][3][L];
+  float u[3][3][L];
+  float sigma[3][L];
+  float v[3][3][L];
+};
+
+// aの列pと列qが直交するように、右から回転Jを掛ける: a <- a J、v <- v J (片側ヤコビ法)
+// 列の内積から、a^T aの(p, q)成分を0にする回転を求めることになる
+template <size_t L, int P, int Q>
+inline void jacobiRotate(float a[3][3][L], float v[3][3][L], const float limit[L]) {
+  for (size_t l = 0; l < L; ++l) {
+    const float app = a[0][P][l] * a[0][P][l] + a[1][P][l] * a[1][P][l] + a[2][P][l] * a[2][P][l];
+    const float aqq = a[0][Q][l] * a[0][Q][l] + a[1][Q][l] * a[1][Q][l] + a[2][Q][l] * a[2][Q][l];
+    const float dot = a[0][P][l] * a[0][Q][l] + a[1][P][l] * a[1][Q][l] + a[2][P][l] * a[2][Q][l];
+    const float apq = std::fabs(dot) > limit[l] ? dot : 0.0f;
+    // t = tanθ (|θ| <= π/4 の側)。apqが0ならt = 0
+    const float diff = aqq - app;
+    const float t = std::copysign(2.0f, diff) * apq /
+                    (std::fabs(diff) + std::sqrt(diff * diff + 4.0f * apq * apq) + TINY);
+    const float c = 1.0f / std::sqrt(1.0f + t * t);
+    const float sn = t * c;
+
+    for (int i = 0; i < 3; ++i) {
+      const float aip = a[i][P][l];
+      const float aiq = a[i][Q][l];
+      a[i][P][l] = c * aip - sn * aiq;
+      a[i][Q][l] = sn * aip + c * aiq;
+      const float vip = v[i][P][l];
+      const float viq = v[i][Q][l];
+      v[i][P][l] = c * vip - sn * viq;
+      v[i][Q][l] = sn * vip + c * viq;
+    }
+  }
+}
+
+// 列iと列jの大きさを比べ、jの方が大きければ入れ替える (vの行列式を保つために片方の符号を反転する)
+// 選択は0か1の重みを掛けて足す形にする (比較で値を選ぶとループに分岐が残ってベクトル化されない)
+template <size_t L, int I, int J>
+inline void sortColumns(float b[3][3][L], float v[3][3][L], float norms[3][L]) {
+  for (size_t l = 0; l < L; ++l) {
+    const float w = norms[I][l] < norms[J][l] ? 1.0f : 0.0f;
+    const float keep = 1.0f - w;
+    const float ni = norms[I][l];
+    norms[I][l] = w * norms[J][l] + keep * ni;
+    norms[J][l] = w * ni + keep * norms[J][l];
+    for (int k = 0; k < 3; ++k) {
+      const float bi = b[k][I][l];
+      const float vi = v[k][I][l];
+      b[k][I][l] = w * b[k][J][l] + keep * bi;
+      b[k][J][l] = keep * b[k][J][l] - w * bi;
+      v[k][I][l] = w * v[k][J][l] + keep * vi;
+      v[k][J][l] = keep * v[k][J][l] - w * vi;
+    }
+  }
+}
+
+// 全レーンのSVDを同じ命令列で計算する (レーンごとのループはベクトル化される)
+template <size_t L>
+void svdLanes(SvdLanes<L>& lanes) {
+  // 最大の成分で割ってから計算する (内積のオーバーフローと非正規化数を避ける。sigmaは最後に戻す)
+  float a[3][3][L];
+  float scale[L];
+  for (size_t l = 0; l < L; ++l) {
+    float m = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        m = std::max(m, std::fabs(lanes.a[i][j][l]));
+      }
+    }
+    scale[l] = m;
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      for (size_t l = 0; l < L; ++l) {
+        a[i][j][l] = lanes.a[i][j][l] / (scale[l] + TINY);
+      }
+    }
+  }
+
+  // v = I
+  float (&v)[3][3][L] = lanes.v;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      for (size_t l = 0; l < L; ++l) {
+        v[i][j][l] = i == j ? 1.0f : 0.0f;
+      }
+    }
+  }
+  // 列の大きさの2乗の和 (フロベニウスノルムの2乗) は回転で変わらない
+  float limit[L];
+  for (size_t l = 0; l < L; ++l) {
+    float sum = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        sum += a[i][j][l] * a[i][j][l];
+      }
+    }
+    limit[l] = OFF_DIAGONAL_TOLERANCE * sum;
+  }
+
+  for (int sweep = 0; sweep < JACOBI_SWEEPS; ++sweep) {
+    jacobiRotate<L, 0, 1>(a, v, limit);
+    jacobiRotate<L, 0, 2>(a, v, limit);
+    jacobiRotate<L, 1, 2>(a, v, limit);
+  }
+
+  // aにはa vが入っていて、直交した列の大きさが特異値
+  float (&b)[3][3][L] = a;
+  float norms[3][L];
+  for (int j = 0; j < 3; ++j) {
+    for (size_t l = 0; l < L; ++l) {
+      norms[j][l] = b[0][j][l] * b[0][j][l] + b[1][j][l] * b[1][j][l] + b[2][j][l] * b[2][j][l];
+    }
+  }
+  sortColumns<L, 0, 1>(b, v, norms);
+  sortColumns<L, 0, 2>(b, v, norms);
+  sortColumns<L, 1, 2>(b, v, norms);
+
+  // bの列を直交化してuを作る。3列目は外積にしてuを回転行列にし、符号はsigma.zに残す
+  float (&u)[3][3][L] = lanes.u;
+  for (size_t l = 0; l < L; ++l) {
+    // 1列目 (bが0ならx軸)
+    const float n1 = b[0][0][l] * b[0][0][l] + b[1][0][l] * b[1][0][l] + b[2][0][l] * b[2][0][l];
+    const float inv1 = 1.0f / std::sqrt(n1 + TINY);
+    const float zero1 = n1 <= TINY ? 1.0f : 0.0f;
+    const float u1x = zero1 + (1.0f - zero1) * b[0][0][l] * inv1;
+    const float u1y = (1.0f - zero1) * b[1][0][l] * inv1;
+    const float u1z = (1.0f - zero1) * b[2][0][l] * inv1;
+
+    // 2列目 (1列目の成分を除いたものが0なら、1列目に直交する適当な向き)
+    // 丸め誤差で直交性が崩れないように射影を2回引く
+    const float d = u1x * b[0][1][l] + u1y * b[1][1][l] + u1z * b[2][1][l];
+    float rx = b[0][1][l] - d * u1x;
+    float ry = b[1][1][l] - d * u1y;
+    float rz = b[2][1][l] - d * u1z;
+    const float e = u1x * rx + u1y * ry + u1z * rz;
+    rx -= e * u1x;
+    ry -= e * u1y;
+    rz -= e * u1z;
+    const float n2 = rx * rx + ry * ry + rz * rz;
+    const float inv2 = 1.0f / std::sqrt(n2 + TINY);
+    // 1列目に比べて丸め誤差程度しか残らなければ、2つ目の特異値は0とみなす
+    const float zero2 = n2 <= RANK_TOLERANCE * n1 + TINY ? 1.0f : 0.0f;
+    // Duffらの正規直交基底の1本目 (u1に直交する単位ベクトル)
+    const float sign = std::copysign(1.0f, u1z);
+    const float pa = -1.0f / (sign + u1z);
+    const float pb = u1x * u1y * pa;
+    const float u2x = zero2 * (1.0f + sign * u1x * u1x * pa) + (1.0f - zero2) * rx * inv2;
+    const float u2y = zero2 * sign * pb + (1.0f - zero2) * ry * inv2;
+    const float u2z = -zero2 * sign * u1x + (1.0f - zero2) * rz * inv2;
+
+    const float u3x = u1y * u2z - u1z * u2y;
+    const float u3y = u1z * u2x - u1x * u2z;
+    const float u3z = u1x * u2y - u1y * u2x;
+
+    u[0][0][l] = u1x; u[1][0][l] = u1y; u[2][0][l] = u1z;
+    u[0][1][l] = u2x; u[1][1][l] = u2y; u[2][1][l] = u2z;
+    u[0][2][l] = u3x; u[1][2][l] = u3y; u[2][2][l] = u3z;
+    lanes.sigma[0][l] = (u1x * b[0][0][l] + u1y * b[1][0][l] + u1z * b[2][0][l]) * scale[l];
+    lanes.sigma[1][l] = (u2x * b[0][1][l] + u2y * b[1][1][l] + u2z * b[2][1][l]) * scale[l];
+    lanes.sigma[2][l] = (u3x * b[0][2][l] + u3y * b[1][2][l] + u3z * b[2][2][l]) * scale[l];
+  }
+}
+
+template <size_t L>
+void loadLane(SvdLanes<L>& lanes, size_t l, const Matrix3& a) {
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      lanes.a[i][j][l] = a.m[i][j];
+    }
+  }
+}
+
+template <size_t L>
+Svd3 storeLane(const SvdLanes<L>& lanes, size_t l) {
+  Svd3 result;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      result.u.m[i][j] = lanes.u[i][j][l];
+      result.v.m[i][j] = lanes.v[i][j][l];
+    }
+  }
+  result.sigma = Vector3(lanes.sigma[0][l], lanes.sigma[1][l], lanes.sigma[2][l]);
+  return result;
+}
+
+// [begin, end)をLANES個ずつ計算してfn(i, svd)に渡す (端数のレーンは単位行列で埋める)
+template <typename Store>
+void svdRange(const Matrix3* matrices, size_t begin, size_t end, const Store& store) {
+  SvdLanes<LANES> lanes;
+  for (size_t base = begin; base < end; base += LANES) {
+    const size_t n = std::min(LANES, end - base);
+    for (size_t l = 0; l < LANES; ++l) {
+      loadLane(lanes, l, l < n ? matrices[base + l] : Matrix3());
+    }
+    svdLanes(lanes);
+    for (size_t l = 0; l < n; ++l) {
+      store(base + l, storeLane(lanes, l));
+    }
+  }
+}
+
+// rotation = u v^T、stretch = v diag(sigma) v^T
+void polarFromSvd(const Svd3& svd, Matrix3* rotation, Matrix3* stretch) {
+  const float sigma[3] = {svd.sigma.x, svd.sigma.y, svd.sigma.z};
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      float r = 0.0f;
+      float s = 0.0f;
+      for (int k = 0; k < 3; ++k) {
+        r += svd.u.m[i][k] * svd.v.m[j][k];
+        s += svd.v.m[i][k] * sigma[k] * svd.v.m[j][k];
+      }
+      rotation->m[i][j] = r;
+      if (stretch) {
+        stretch->m[i][j] = s;
+      }
+    }
+  }
+}
+
+} // namespace
+
+Svd3 svd3(const Matrix3& a) {
+  // 1つだけなら1レーンで計算する
+  SvdLanes<1> lanes;
+  loadLane(lanes, 0, a);
+  svdLanes(lanes);
+  return storeLane(lanes, 0);
+}
+
+void svd3Batch(const Matrix3* matrices, size_t count, Svd3* out, JobSystem& jobs) {
+  jobs.parallelFor(0, count, SVD_GRAIN, [&](size_t begin, size_t end) {
+    svdRange(matrices, begin, end, [out](size_t i, const Svd3& svd) { out[i] = svd; });
+  });
+}
+
+void polarDecomposition(const Matrix3& a, Matrix3& rotation, Matrix3& stretch) {
+  polarFromSvd(svd3(a), &rotation, &stretch);
+}
+
+void polarDecompositionBatch(const Matrix3* matrices, size_t count, Matrix3* rotations, Matrix3* stretches,
+                             JobSystem& jobs) {
+  jobs.parallelFor(0, count, SVD_GRAIN, [&](size_t begin, size_t end) {
+    svdRange(matrices, begin, end, [rotations, stretches](size_t i, const Svd3& svd) {
+      polarFromSvd(svd, &rotations[i], stretches ? &stretches[i] : nullptr);
+    });
+  });
+}
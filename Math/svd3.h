@@ -0,0 +1,32 @@
+#ifndef SVD3_H
+#define SVD3_H
+
+#include <cstddef>
+#include "vector_space.h"
+#include "Core/job_system.h"
+
+// 3x3行列の特異値分解 a = u * diag(sigma) * v^T
+// uとvは回転行列 (行列式+1) で、sigmaは sigma.x >= sigma.y >= |sigma.z| の順。
+// 回転に限るために、aの行列式が負ならsigma.zを負にする (符号付きSVD)。
+// 剛体の位置合わせや変形の回転成分は鏡映を含まないので、この形の方がそのまま使える。
+struct Svd3 {
+  Matrix3 u;
+  Vector3 sigma;
+  Matrix3 v;
+};
+
+// aの列を片側ヤコビ法で互いに直交させて (a v) vを求め、a vの列を大きさ順に並べてから正規化してuを求める。
+// a^T aを作らないので、小さい特異値の精度が落ちにくい。
+// 分岐の無い固定回数の反復なので、一括版では複数の行列をSIMDのレーンに並べて同時に計算する。
+Svd3 svd3(const Matrix3& a);
+// countが大きいときはjobsで分割して並列に計算する
+void svd3Batch(const Matrix3* matrices, size_t count, Svd3* out, JobSystem& jobs = JobSystem::instance());
+
+// 極分解 a = rotation * stretch (rotation = u v^T、stretch = v diag(sigma) v^T)
+// rotationは常に回転行列。aの行列式が負ならstretchは正定値にならない
+void polarDecomposition(const Matrix3& a, Matrix3& rotation, Matrix3& stretch);
+// stretchesはnullptrでもよい
+void polarDecompositionBatch(const Matrix3* matrices, size_t count, Matrix3* rotations, Matrix3* stretches,
+                             JobSystem& jobs = JobSystem::instance());
+
+#endif // SVD3_H
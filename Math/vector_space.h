@@ -12,6 +12,10 @@ public:
   // コンストラクタ
   Vector3();
   Vector3(float x, float y, float z);
+  //コピーコンストラクタ
+  Vector3(const Vector3& other) = default;
+  //コピー代入演算子
+  Vector3& operator=(const Vector3& other) = default;
   //ムーブコンストラクタ
   Vector3(Vector3&& other) noexcept;
   //ムーブ代入演算子
@@ -43,6 +47,10 @@ public:
   // コンストラクタ
   Vector4();
   Vector4(float x, float y, float z, float w);
+  //コピーコンストラクタ
+  Vector4(const Vector4& other) = default;
+  //コピー代入演算子
+  Vector4& operator=(const Vector4& other) = default;
   //ムーブコンストラクタ
   Vector4(Vector4&& other) noexcept;
   //ムーブ代入演算子
@@ -69,9 +77,6 @@ public:
   // デストラクタを仮想関数にして、継承クラスでのオーバーライドを可能にする
   virtual ~Matrix() = default;
 
-  // 行列の転置
-  virtual Matrix transpose() const;
-
   // 行列とベクトルの積
   virtual Vector3 multiply(const Vector3& vector) const = 0;
   virtual Vector4 multiply(const Vector4& vector) const = 0;
@@ -94,7 +99,7 @@ public:
   Matrix3 operator*(float scalar) const;
 
   // 行列の転置
-  Matrix3* transpose() const override;
+  Matrix3 transpose() const;
 
   // 行列とベクトルの積
   Vector3 multiply(const Vector3& vector) const override;
@@ -119,7 +124,7 @@ public:
   Matrix4 operator*(float scalar) const;
 
   // 行列の転置
-  Matrix4* transpose() const override;
+  Matrix4 transpose() const;
 
   // 行列とベクトルの積
   Vector3 multiply(const Vector3& vector) const override;
@@ -0,0 +1,95 @@
+#include "DrawList.h"
+#include "Profiler.h"
+#include <cmath>
+
+namespace {
+
+// 1チャンクのオブジェクト数
+const size_t PREPARE_GRAIN = 64;
+
+// クリップ空間の6平面 (MVPの行から取り出す) とバウンディングスフィアの判定
+bool sphereInFrustum(const Matrix4& mvp, const float center[3], float radius) {
+    const float* w = mvp.m[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const float* r = mvp.m[axis];
+        for (float sign : {1.0f, -1.0f}) {
+            const float a = w[0] + sign * r[0];
+            const float b = w[1] + sign * r[1];
+            const float c = w[2] + sign * r[2];
+            const float d = w[3] + sign * r[3];
+            const float length = std::sqrt(a * a + b * b + c * c);
+            if (a * center[0] + b * center[1] + c * center[2] + d < -radius * length) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 行優先のMatrix4をglLoadMatrixf用の列優先に並べ替える
+void toColumnMajor(const Matrix4& matrix, GLfloat out[16]) {
+    for (int row = 0; row < 4; ++row) {
+        for (int column = 0; column < 4; ++column) {
+            out[column * 4 + row] = matrix.m[row][column];
+        }
+    }
+}
+
+} // namespace
+
+void DrawList::prepare(const std::vector<DrawObject>& objects, const Matrix4& view, const Matrix4& projection,
+                       float viewportHeight, float pixelError, JobSystem& jobs) {
+    GEO_PROFILE_SCOPE("DrawList::prepare");
+    const size_t count = objects.size();
+    const Matrix4 viewProjection = projection * view;
+    toColumnMajor(projection, projection_);
+    slots_.resize(count);
+    visible_.assign(count, 0);
+
+    // オブジェクトごとの処理は互いに独立なので、自分のスロットにだけ書く
+    jobs.parallelFor(0, count, PREPARE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const DrawObject& object = objects[i];
+            if (!object.mesh || object.mesh->getLevelCount() == 0) {
+                continue;
+            }
+            const Matrix4 mvp = viewProjection * object.model;
+            const LodChain& chain = object.mesh->getChain();
+            if (!sphereInFrustum(mvp, chain.center, chain.radius)) {
+                continue;
+            }
+            PreparedDraw& draw = slots_[i];
+            draw.level = selectLod(chain, mvp, viewportHeight, pixelError);
+            draw.polygon = &object.mesh->getLevel(draw.level);
+            draw.objectIndex = i;
+            toColumnMajor(view * object.model, draw.modelView);
+            visible_[i] = 1;
+        }
+    });
+
+    // 見えるものを元の順序のまま詰める
+    draws_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (visible_[i]) {
+            draws_.push_back(slots_[i]);
+        }
+    }
+    culled_ = count - draws_.size();
+}
+
+void DrawList::submit() const {
+    GEO_PROFILE_SCOPE("DrawList::submit");
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadMatrixf(projection_);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    for (const PreparedDraw& draw : draws_) {
+        glLoadMatrixf(draw.modelView);
+        draw.polygon->draw();
+    }
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
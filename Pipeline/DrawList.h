@@ -0,0 +1,52 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <vector>
+#include <GL/glew.h>
+#include "Math/vector_space.h"
+#include "Core/job_system.h"
+#include "MeshSimplifier.h"
+
+// 描画したいオブジェクト
+struct DrawObject {
+    const LodMesh* mesh = nullptr;
+    Matrix4 model;
+};
+
+// 準備済みの描画 (GLへ発行するだけの状態)
+struct PreparedDraw {
+    const Polygon3D* polygon;
+    // オブジェクト空間から視点空間への行列 (列優先、glLoadMatrixfにそのまま渡せる)
+    GLfloat modelView[16];
+    size_t objectIndex;
+    size_t level;
+};
+
+// オブジェクトごとの描画準備 (視錐台カリング、MVPの計算、LOD選択) を並列に行い、
+// GLへの発行だけを描画スレッドで順に行う。作業領域はフレームをまたいで使い回す。
+class DrawList {
+public:
+    // カリングとLOD選択はprojection * view * modelで行う
+    void prepare(const std::vector<DrawObject>& objects, const Matrix4& view, const Matrix4& projection,
+                 float viewportHeight, float pixelError = 1.0f,
+                 JobSystem& jobs = JobSystem::instance());
+
+    // 準備した描画をobjectsの順に発行する (GLコンテキストのスレッドで呼ぶ)
+    // 固定機能パイプラインの投影行列にprojectionを、モデルビュー行列にview * modelを読み込む
+    // (法線と光源の計算が視点空間で行われるように、投影を分けておく)
+    void submit() const;
+
+    const std::vector<PreparedDraw>& getDraws() const noexcept { return draws_; }
+    // 直前のprepareで視錐台の外と判定された数
+    size_t getCulledCount() const noexcept { return culled_; }
+
+private:
+    std::vector<PreparedDraw> slots_;
+    std::vector<unsigned char> visible_;
+    std::vector<PreparedDraw> draws_;
+    // 直前のprepareの投影行列 (列優先)
+    GLfloat projection_[16] = {};
+    size_t culled_ = 0;
+};
+
+#endif // DRAW_LIST_H
@@ -0,0 +1,71 @@
+#include "FramePipeline.h"
+#include "Profiler.h"
+#include "Core/frame_arena.h"
+#include <utility>
+
+FramePipeline::FramePipeline(UpdateFunction update, RenderFunction render, JobSystem& jobs)
+    : update_(std::move(update)), render_(std::move(render)), jobs_(jobs),
+      front_(0), primed_(false), overlap_(true) {}
+
+FramePipeline::~FramePipeline() {
+    if (pending_.isValid()) {
+        // 描画中に例外が出た場合だけここに来る。更新側の例外は捨てる
+        try {
+            jobs_.wait(pending_);
+        } catch (...) {
+        }
+    }
+}
+
+void FramePipeline::update(const FrameState& previous, FrameState& next) {
+    GEO_PROFILE_SCOPE("FramePipeline::update");
+    // 更新を実行したスレッドのアリーナだけを、更新が終わったら元の位置へ戻す
+    ArenaScope scratch;
+    next.meshUploads.clear();
+    update_(previous, next);
+}
+
+void FramePipeline::runFrame() {
+    if (!primed_) {
+        // 最初のフレームは描画するものが無いので、更新だけ先に済ませる
+        FrameState initial;
+        states_[front_].frameIndex = 0;
+        update(initial, states_[front_]);
+        primed_ = true;
+    }
+
+    // 差し替えは更新ジョブを投げる前に適用する (更新側が同時に差し替え先を読むことはない)。
+    // LODのチェーンはコピーせずにLodMeshへムーブする
+    {
+        GEO_PROFILE_SCOPE("FramePipeline::upload");
+        for (MeshUpload& upload : states_[front_].meshUploads) {
+            upload.target->setChain(std::move(upload.chain));
+        }
+        states_[front_].meshUploads.clear();
+    }
+
+    const FrameState& current = states_[front_];
+    FrameState& next = states_[1 - front_];
+    next.frameIndex = current.frameIndex + 1;
+
+    // 次のフレームの更新を投げてから、今のフレームを描画する
+    if (overlap_) {
+        pending_ = jobs_.schedule([this, &current, &next] { update(current, next); });
+    }
+
+    {
+        GEO_PROFILE_SCOPE("FramePipeline::render");
+        ArenaScope scratch;
+        render_(current);
+    }
+
+    if (overlap_) {
+        // 更新が終わっていなければ、待つ間ほかのジョブを手伝う
+        JobHandle pending = std::move(pending_);
+        jobs_.wait(pending);
+    } else {
+        update(current, next);
+    }
+    front_ = 1 - front_;
+    GEO_PROFILE_FRAME_END();
+}
@@ -0,0 +1,77 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <GL/glew.h>
+#include "Math/vector_space.h"
+#include "Core/job_system.h"
+#include "DrawList.h"
+
+// 描画しているLodMeshの差し替え
+// 重いLODの構築 (buildLodChain) はGLを触れない更新側で済ませ、描画スレッドはアップロードだけを行う
+struct MeshUpload {
+    LodMesh* target = nullptr;
+    LodChain chain;
+};
+
+// 1フレーム分の、更新が書いて描画が読む状態
+struct FrameState {
+    uint64_t frameIndex = 0;
+    double time = 0.0;
+    Matrix4 view;
+    Matrix4 projection;
+    float viewportHeight = 1.0f;
+    std::vector<DrawObject> objects;
+    std::vector<MeshUpload> meshUploads;
+};
+
+// 更新と描画をずらして重ねるフレームパイプライン
+// 状態を2つ持ち、フレームNを描画している間にフレームN+1の更新を別スレッドで行う。
+// 描画は常に書き終わった側だけを読むので、書きかけのデータを読むことはない
+// (そのかわり表示は更新より1フレーム遅れる)。
+class FramePipeline {
+public:
+    // previousは直前のフレームの状態 (描画側も同時に読むので書き換えてはいけない)
+    // previous.meshUploadsは更新を始める前に適用済みで、常に空に見える
+    // (適用は更新ジョブを投げる前に終わるので、更新側が差し替え先のLodMeshを読んでも競合しない。
+    //  ただし描画と同時に走るので、LodMeshを書き換えるのはmeshUploadsを通してだけにすること)
+    // nextは前々回の内容が残っているので、すべて書き直すこと (vectorの容量は使い回される)
+    // next.frameIndexは呼ぶ前に設定済み、meshUploadsは空にしてある
+    using UpdateFunction = std::function<void(const FrameState& previous, FrameState& next)>;
+    // GLコンテキストのスレッドで呼ばれる (meshUploadsは呼ぶ前に適用済みで、空になっている)
+    using RenderFunction = std::function<void(const FrameState& state)>;
+
+    FramePipeline(UpdateFunction update, RenderFunction render, JobSystem& jobs = JobSystem::instance());
+    // 実行中の更新を待ってから破棄する
+    ~FramePipeline();
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // 1フレーム進める (GLコンテキストのスレッドから呼ぶ)
+    // 更新と描画はそれぞれ実行したスレッドのアリーナをArenaScopeで巻き戻すので、アリーナのメモリをFrameStateに入れないこと
+    // (ほかのスレッドやパイプラインのアリーナには触れない。更新や描画から投げたジョブは、自分でArenaScopeを使うこと)
+    void runFrame();
+
+    // falseにすると更新と描画を順番に行う (比較・デバッグ用)
+    void setOverlapEnabled(bool enabled) noexcept { overlap_ = enabled; }
+    bool isOverlapEnabled() const noexcept { return overlap_; }
+
+    // 次に描画される状態
+    const FrameState& getFrontState() const noexcept { return states_[front_]; }
+
+private:
+    void update(const FrameState& previous, FrameState& next);
+
+    UpdateFunction update_;
+    RenderFunction render_;
+    JobSystem& jobs_;
+    FrameState states_[2];
+    size_t front_;
+    bool primed_;
+    bool overlap_;
+    JobHandle pending_;
+};
+
+#endif // FRAME_PIPELINE_H
@@ -0,0 +1,229 @@
+#include "MeshAttributes.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    // 並列に処理する1チャンクの三角形数・頂点数
+    const size_t ATTRIBUTE_GRAIN = 4096;
+    // パス1でSoAに集める三角形の数
+    const size_t FACE_BLOCK = 256;
+    const float PI = 3.14159265358979f;
+
+    // acosの近似 (Abramowitz & Stegun 4.4.45、誤差は7e-5ラジアン以下)
+    // 重みに使うだけなので精度は十分。負の側はcopysignで折り返し、分岐を作らない
+    inline float approximateAcos(float x) {
+        // 丸めで|x|がわずかに1を超えても平方根がNaNにならないように絶対値を取る
+        const float a = std::fabs(x);
+        const float r = std::sqrt(std::fabs(1.0f - a)) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f - 0.0187293f * a)));
+        return 0.5f * PI - std::copysign(0.5f * PI - r, x);
+    }
+
+    // 0で割らないようにごく小さい値を足した逆数平方根 (lengthSquaredが0なら掛ける側も0なので結果は0になる)
+    // 比較で選ぶとループに分岐が残ってベクトル化されないので、足し算にしている
+    inline float safeInverseLength(float lengthSquared) {
+        return 1.0f / std::sqrt(lengthSquared + std::numeric_limits<float>::min());
+    }
+
+    // 2つの辺の間の角 (どちらかの長さが0ならπ/2になるが、そのとき面法線も0なので重みは効かない)
+    inline float angleBetween(float ax, float ay, float az, float bx, float by, float bz) {
+        const float lengthsSquared = (ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz);
+        const float c = (ax * bx + ay * by + az * bz) * safeInverseLength(lengthsSquared);
+        return approximateAcos(c);
+    }
+}
+
+MeshAttributes::MeshAttributes(const GLuint* indices, size_t indexCount, size_t vertexCount) {
+    setTopology(indices, indexCount, vertexCount);
+}
+
+MeshAttributes::MeshAttributes(const IndexedMesh& mesh) {
+    setTopology(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+}
+
+void MeshAttributes::setTopology(const GLuint* indices, size_t indexCount, size_t vertexCount) {
+    if (indexCount % 3 != 0) {
+        throw std::invalid_argument("Index count is not a multiple of 3");
+    }
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indices[i] >= vertexCount) {
+            throw std::out_of_range("Vertex index out of range");
+        }
+    }
+    indices_.assign(indices, indices + indexCount);
+
+    // 頂点ごとの角の数を数えて接頭和を取り、角を詰める (頂点の中では三角形の順)
+    cornerOffsets_.assign(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        ++cornerOffsets_[indices[i] + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        cornerOffsets_[v + 1] += cornerOffsets_[v];
+    }
+    corners_.resize(indexCount);
+    std::vector<GLuint> cursor(cornerOffsets_.begin(), cornerOffsets_.end() - 1);
+    for (size_t i = 0; i < indexCount; ++i) {
+        corners_[cursor[indices[i]]++] = static_cast<GLuint>(i);
+    }
+
+    const size_t triangles = indexCount / 3;
+    faceX_.resize(triangles);
+    faceY_.resize(triangles);
+    faceZ_.resize(triangles);
+    cornerAngles_.resize(indexCount);
+}
+
+template <typename CornerPosition>
+void MeshAttributes::computeFaces(const CornerPosition& cornerPosition, NormalWeighting weighting,
+                                  JobSystem& jobs) {
+    const bool angle = weighting == NormalWeighting::Angle;
+    jobs.parallelFor(0, triangleCount(), ATTRIBUTE_GRAIN, [&](size_t begin, size_t end) {
+        // 2辺 (p1 - p0, p2 - p0) をSoAに集める
+        float ax[FACE_BLOCK], ay[FACE_BLOCK], az[FACE_BLOCK];
+        float bx[FACE_BLOCK], by[FACE_BLOCK], bz[FACE_BLOCK];
+        for (size_t blockBegin = begin; blockBegin < end; blockBegin += FACE_BLOCK) {
+            const size_t n = std::min(FACE_BLOCK, end - blockBegin);
+            for (size_t i = 0; i < n; ++i) {
+                const size_t corner = (blockBegin + i) * 3;
+                const GLfloat* p0 = cornerPosition(corner);
+                const GLfloat* p1 = cornerPosition(corner + 1);
+                const GLfloat* p2 = cornerPosition(corner + 2);
+                ax[i] = p1[0] - p0[0];
+                ay[i] = p1[1] - p0[1];
+                az[i] = p1[2] - p0[2];
+                bx[i] = p2[0] - p0[0];
+                by[i] = p2[1] - p0[1];
+                bz[i] = p2[2] - p0[2];
+            }
+
+            // 外積 (長さは面積の2倍)
+            float* fx = &faceX_[blockBegin];
+            float* fy = &faceY_[blockBegin];
+            float* fz = &faceZ_[blockBegin];
+            for (size_t i = 0; i < n; ++i) {
+                fx[i] = ay[i] * bz[i] - az[i] * by[i];
+                fy[i] = az[i] * bx[i] - ax[i] * bz[i];
+                fz[i] = ax[i] * by[i] - ay[i] * bx[i];
+            }
+            if (!angle) {
+                continue;
+            }
+
+            // 角度の重みでは面法線を単位ベクトルにして、内角を角ごとに持つ
+            for (size_t i = 0; i < n; ++i) {
+                const float inverse = safeInverseLength(fx[i] * fx[i] + fy[i] * fy[i] + fz[i] * fz[i]);
+                fx[i] *= inverse;
+                fy[i] *= inverse;
+                fz[i] *= inverse;
+            }
+            float* angles = &cornerAngles_[blockBegin * 3];
+            for (size_t i = 0; i < n; ++i) {
+                // p1での角はp0 - p1 = -aとp2 - p1 = b - aの間。3つ目は和がπになることから求める
+                const float a0 = angleBetween(ax[i], ay[i], az[i], bx[i], by[i], bz[i]);
+                const float a1 = angleBetween(-ax[i], -ay[i], -az[i],
+                                              bx[i] - ax[i], by[i] - ay[i], bz[i] - az[i]);
+                angles[i * 3] = a0;
+                angles[i * 3 + 1] = a1;
+                angles[i * 3 + 2] = std::max(0.0f, PI - a0 - a1);
+            }
+        }
+    });
+}
+
+void MeshAttributes::gatherNormals(GLfloat* normals, NormalWeighting weighting, JobSystem& jobs) const {
+    const bool angle = weighting == NormalWeighting::Angle;
+    jobs.parallelFor(0, vertexCount(), ATTRIBUTE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            float x = 0.0f;
+            float y = 0.0f;
+            float z = 0.0f;
+            for (GLuint k = cornerOffsets_[v]; k < cornerOffsets_[v + 1]; ++k) {
+                const GLuint corner = corners_[k];
+                const GLuint triangle = corner / 3;
+                const float w = angle ? cornerAngles_[corner] : 1.0f;
+                x += faceX_[triangle] * w;
+                y += faceY_[triangle] * w;
+                z += faceZ_[triangle] * w;
+            }
+            const float inverse = safeInverseLength(x * x + y * y + z * z);
+            normals[v * 3] = x * inverse;
+            normals[v * 3 + 1] = y * inverse;
+            normals[v * 3 + 2] = z * inverse;
+        }
+    });
+}
+
+void MeshAttributes::computeNormals(const GLfloat* positions, GLfloat* normals, NormalWeighting weighting,
+                                    JobSystem& jobs) {
+    GEO_PROFILE_SCOPE("MeshAttributes::computeNormals");
+    const GLuint* indices = indices_.data();
+    computeFaces([positions, indices](size_t corner) { return positions + indices[corner] * 3; },
+                 weighting, jobs);
+    gatherNormals(normals, weighting, jobs);
+}
+
+void MeshAttributes::computeNormals(const IndexedMesh& mesh, std::vector<GLfloat>& normals,
+                                    NormalWeighting weighting, JobSystem& jobs) {
+    if (mesh.vertexCount() != vertexCount()) {
+        throw std::invalid_argument("Mesh vertex count does not match topology");
+    }
+    normals.resize(mesh.positions.size());
+    computeNormals(mesh.positions.data(), normals.data(), weighting, jobs);
+}
+
+void MeshAttributes::computeTriangleListNormals(const GLfloat* vertices, GLfloat* normals,
+                                                NormalWeighting weighting, JobSystem& jobs) {
+    GEO_PROFILE_SCOPE("MeshAttributes::computeTriangleListNormals");
+    // 三角形リストでは角iの位置がそのまま並んでいる
+    computeFaces([vertices](size_t corner) { return vertices + corner * 3; }, weighting, jobs);
+    vertexNormals_.resize(vertexCount() * 3);
+    gatherNormals(vertexNormals_.data(), weighting, jobs);
+    jobs.parallelFor(0, indices_.size(), ATTRIBUTE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const GLfloat* n = &vertexNormals_[indices_[i] * 3];
+            normals[i * 3] = n[0];
+            normals[i * 3 + 1] = n[1];
+            normals[i * 3 + 2] = n[2];
+        }
+    });
+}
+
+void computeTangentFrames(const GLfloat* normals, GLfloat* tangents, size_t count, JobSystem& jobs) {
+    jobs.parallelFor(0, count, ATTRIBUTE_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const float nx = normals[i * 3];
+            const float ny = normals[i * 3 + 1];
+            const float nz = normals[i * 3 + 2];
+            // Duff et al., "Building an Orthonormal Basis, Revisited" (2017)
+            const float sign = std::copysign(1.0f, nz);
+            const float a = -1.0f / (sign + nz);
+            const float b = nx * ny * a;
+            tangents[i * 4] = 1.0f + sign * nx * nx * a;
+            tangents[i * 4 + 1] = sign * b;
+            tangents[i * 4 + 2] = -sign * nx;
+            // 従法線 (b, sign + ny * ny * a, -ny) はcross(normal, tangent)と一致する
+            tangents[i * 4 + 3] = 1.0f;
+        }
+    });
+}
+
+void generateNormals(Polygon3D& polygon, NormalWeighting weighting, JobSystem& jobs) {
+    MeshAttributes attributes;
+    generateNormals(polygon, attributes, weighting, jobs);
+}
+
+void generateNormals(Polygon3D& polygon, MeshAttributes& attributes, NormalWeighting weighting, JobSystem& jobs) {
+    const std::vector<GLfloat>& vertices = polygon.getVertices();
+    if (vertices.empty() && polygon.getVertexCount() > 0) {
+        throw std::logic_error("Polygon3D created from a MeshView has no CPU copy to generate normals from");
+    }
+    // 位置でまとめ直すのは三角形数が変わったときだけ (変形では同じ位置の角は一緒に動く)
+    if (attributes.triangleCount() != vertices.size() / 9) {
+        attributes = MeshAttributes(weldVertices(vertices, std::vector<GLfloat>()));
+    }
+    std::vector<GLfloat> normals(vertices.size());
+    attributes.computeTriangleListNormals(vertices.data(), normals.data(), weighting, jobs);
+    polygon.setNormals(normals);
+}
@@ -0,0 +1,84 @@
+#ifndef MESH_ATTRIBUTES_H
+#define MESH_ATTRIBUTES_H
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+#include "Core/job_system.h"
+#include "MeshTopology.h"
+#include "Polygon3D.h"
+
+// 頂点法線を作るときの、接する三角形の重み
+enum class NormalWeighting {
+    Area,  // 三角形の面積 (外積をそのまま足す)
+    Angle, // 頂点での内角 (細長い三角形の影響を受けにくい)
+};
+
+// 頂点ごとの滑らかな法線を求める
+// トポロジ (インデックス) から頂点→角 (三角形の頂点) の隣接をCSRで作っておき、
+//   1. 三角形ごとに面法線と各角の重みを求める (三角形ごとに独立)
+//   2. 頂点ごとに接する角の値を集めて足し、正規化する (頂点ごとに独立)
+// の2パスで計算する。どちらも自分の出力にしか書かないので、アトミック操作なしでjobsで並列化できる。
+// パス1は位置を小さなブロックへSoAで集めてから外積を計算するので、コンパイラがベクトル化できる。
+// 位置だけが変わる変形メッシュは、同じMeshAttributesで毎フレームcomputeNormalsを呼べばよい。
+class MeshAttributes {
+public:
+    MeshAttributes() = default;
+    // indicesは3つで1三角形、vertexCountは頂点数
+    MeshAttributes(const GLuint* indices, size_t indexCount, size_t vertexCount);
+    explicit MeshAttributes(const IndexedMesh& mesh);
+
+    // トポロジを差し替えて隣接を作り直す
+    // indexCountが3の倍数でなければstd::invalid_argument、範囲外のインデックスはstd::out_of_rangeを投げる
+    void setTopology(const GLuint* indices, size_t indexCount, size_t vertexCount);
+
+    size_t vertexCount() const noexcept { return cornerOffsets_.empty() ? 0 : cornerOffsets_.size() - 1; }
+    size_t triangleCount() const noexcept { return indices_.size() / 3; }
+
+    // positions (xyz × 頂点数) から頂点法線 (xyz × 頂点数) を求める
+    // 接する三角形が無い (またはすべて縮退した) 頂点の法線は0になる
+    void computeNormals(const GLfloat* positions, GLfloat* normals,
+                        NormalWeighting weighting = NormalWeighting::Angle,
+                        JobSystem& jobs = JobSystem::instance());
+    void computeNormals(const IndexedMesh& mesh, std::vector<GLfloat>& normals,
+                        NormalWeighting weighting = NormalWeighting::Angle,
+                        JobSystem& jobs = JobSystem::instance());
+
+    // Polygon3Dと同じ三角形リスト (角ごとのxyz、角iはインデックスiの頂点) から、角ごとの法線を求める
+    // weldVerticesの結果で作ったMeshAttributesなら、位置の同じ角は同じ法線になる
+    void computeTriangleListNormals(const GLfloat* vertices, GLfloat* normals,
+                                    NormalWeighting weighting = NormalWeighting::Angle,
+                                    JobSystem& jobs = JobSystem::instance());
+
+private:
+    template <typename CornerPosition>
+    void computeFaces(const CornerPosition& cornerPosition, NormalWeighting weighting, JobSystem& jobs);
+    void gatherNormals(GLfloat* normals, NormalWeighting weighting, JobSystem& jobs) const;
+
+    std::vector<GLuint> indices_;
+    // 頂点vに接する角は corners_[cornerOffsets_[v]] から corners_[cornerOffsets_[v+1]-1] まで (三角形*3 + 角)
+    std::vector<GLuint> cornerOffsets_;
+    std::vector<GLuint> corners_;
+    // パス1の結果: 三角形ごとの面法線 (Areaなら外積、Angleなら単位ベクトル) と角ごとの内角
+    std::vector<float> faceX_, faceY_, faceZ_;
+    std::vector<float> cornerAngles_;
+    // 三角形リスト用の頂点法線の作業領域
+    std::vector<GLfloat> vertexNormals_;
+};
+
+// 単位法線ごとに接線フレームを作る (tangentsはxyzw × count、従法線は w * cross(normal, tangent))
+// UVが無いので、法線だけから決まる正規直交基底 (Duffらの分岐なしの方法) を使う。
+// 法線が連続なら接線も連続 (法線が-zちょうどの点だけ向きが切り替わる)。
+void computeTangentFrames(const GLfloat* normals, GLfloat* tangents, size_t count,
+                          JobSystem& jobs = JobSystem::instance());
+
+// Polygon3Dの三角形リストから滑らかな法線を作り、法線ストリームとして設定する
+// (位置の同じ角をまとめて法線を共有させる。CPU側のデータを持たない場合はstd::logic_errorを投げる)
+void generateNormals(Polygon3D& polygon, NormalWeighting weighting = NormalWeighting::Angle,
+                     JobSystem& jobs = JobSystem::instance());
+// 毎フレーム変形するメッシュ向け。角をまとめた隣接をattributesに取っておき、三角形数が変わらない限り使い回す
+// (同じ数の別の三角形リストに差し替えたときは、attributesにMeshAttributes()を代入してから呼ぶ)
+void generateNormals(Polygon3D& polygon, MeshAttributes& attributes, NormalWeighting weighting = NormalWeighting::Angle,
+                     JobSystem& jobs = JobSystem::instance());
+
+#endif // MESH_ATTRIBUTES_H
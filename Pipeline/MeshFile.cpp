@@ -0,0 +1,365 @@
+#include "MeshFile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(MeshFileHeader) == 24, "MeshFileHeader layout changed");
+static_assert(sizeof(MeshSectionEntry) == 24, "MeshSectionEntry layout changed");
+
+namespace {
+    uint64_t alignUp(uint64_t value) {
+        return (value + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+    }
+}
+
+MeshFile::MeshFile(const std::string& path)
+    : data_(nullptr), size_(0),
+#ifdef _WIN32
+      fileHandle_(nullptr), mappingHandle_(nullptr),
+#else
+      fd_(-1),
+#endif
+      version_(0), positions_(nullptr), positionCount_(0), colors_(nullptr), colorCount_(0),
+      indices_(nullptr), indexCount_(0), hasBounds_(false) {
+    map(path);
+    try {
+        parse();
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+MeshFile::MeshFile(MeshFile&& other) noexcept
+    : data_(other.data_), size_(other.size_),
+#ifdef _WIN32
+      fileHandle_(other.fileHandle_), mappingHandle_(other.mappingHandle_),
+#else
+      fd_(other.fd_),
+#endif
+      version_(other.version_), positions_(other.positions_), positionCount_(other.positionCount_),
+      colors_(other.colors_), colorCount_(other.colorCount_),
+      indices_(other.indices_), indexCount_(other.indexCount_),
+      hasBounds_(other.hasBounds_), bounds_(other.bounds_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+#ifdef _WIN32
+    other.fileHandle_ = nullptr;
+    other.mappingHandle_ = nullptr;
+#else
+    other.fd_ = -1;
+#endif
+}
+
+MeshFile& MeshFile::operator=(MeshFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data_ = other.data_;
+        size_ = other.size_;
+#ifdef _WIN32
+        fileHandle_ = other.fileHandle_;
+        mappingHandle_ = other.mappingHandle_;
+        other.fileHandle_ = nullptr;
+        other.mappingHandle_ = nullptr;
+#else
+        fd_ = other.fd_;
+        other.fd_ = -1;
+#endif
+        version_ = other.version_;
+        positions_ = other.positions_;
+        positionCount_ = other.positionCount_;
+        colors_ = other.colors_;
+        colorCount_ = other.colorCount_;
+        indices_ = other.indices_;
+        indexCount_ = other.indexCount_;
+        hasBounds_ = other.hasBounds_;
+        bounds_ = other.bounds_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+MeshFile::~MeshFile() {
+    unmap();
+}
+
+MeshView MeshFile::view() const noexcept {
+    MeshView view;
+    view.vertices = positions_;
+    view.vertexCount = positionCount_;
+    view.colors = colors_;
+    view.colorCount = colorCount_;
+    view.indices = indices_;
+    view.indexCount = indexCount_;
+    view.bounds = hasBounds_ ? &bounds_ : nullptr;
+    return view;
+}
+
+uint32_t MeshFile::getVersion() const noexcept {
+    return version_;
+}
+
+bool MeshFile::hasBounds() const noexcept {
+    return hasBounds_;
+}
+
+const QuantizationBounds& MeshFile::getBounds() const noexcept {
+    return bounds_;
+}
+
+void MeshFile::map(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open mesh file: " + path);
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to stat mesh file: " + path);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map mesh file: " + path);
+    }
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map mesh file: " + path);
+    }
+    fileHandle_ = file;
+    mappingHandle_ = mapping;
+    data_ = static_cast<const unsigned char*>(data);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open mesh file: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat mesh file: " + path);
+    }
+    void* data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Failed to map mesh file: " + path);
+    }
+    // アップロードは先頭から順に読むので先読みを促す
+    ::madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    ::madvise(data, static_cast<size_t>(st.st_size), MADV_WILLNEED);
+    fd_ = fd;
+    data_ = static_cast<const unsigned char*>(data);
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+}
+
+void MeshFile::unmap() noexcept {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mappingHandle_ != nullptr) {
+        CloseHandle(mappingHandle_);
+        mappingHandle_ = nullptr;
+    }
+    if (fileHandle_ != nullptr) {
+        CloseHandle(fileHandle_);
+        fileHandle_ = nullptr;
+    }
+#else
+    if (data_ != nullptr) {
+        ::munmap(const_cast<unsigned char*>(data_), size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+// ヘッダとセクションテーブルを検証し、各セクションへのポインタを設定する
+void MeshFile::parse() {
+    if (size_ < sizeof(MeshFileHeader)) {
+        throw std::runtime_error("Mesh file is truncated");
+    }
+    MeshFileHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (header.magic != MESH_FILE_MAGIC) {
+        throw std::runtime_error("Not a mesh file");
+    }
+    if (header.version == 0 || header.version > MESH_FILE_VERSION) {
+        throw std::runtime_error("Unsupported mesh file version");
+    }
+    if (header.fileSize != size_) {
+        throw std::runtime_error("Mesh file size does not match its header");
+    }
+    uint64_t tableEnd = sizeof(MeshFileHeader) + uint64_t(header.sectionCount) * sizeof(MeshSectionEntry);
+    if (tableEnd > size_) {
+        throw std::runtime_error("Mesh file section table is truncated");
+    }
+    version_ = header.version;
+
+    for (uint32_t i = 0; i < header.sectionCount; ++i) {
+        MeshSectionEntry entry;
+        std::memcpy(&entry, data_ + sizeof(MeshFileHeader) + i * sizeof(MeshSectionEntry), sizeof(entry));
+        if (entry.offset % MESH_FILE_ALIGNMENT != 0 || entry.offset < tableEnd || entry.offset > size_) {
+            throw std::runtime_error("Mesh file section is misaligned or out of range");
+        }
+        if (entry.elementSize == 0 || entry.count > (size_ - entry.offset) / entry.elementSize) {
+            throw std::runtime_error("Mesh file section is out of range");
+        }
+        const unsigned char* section = data_ + entry.offset;
+
+        switch (static_cast<MeshSectionType>(entry.type)) {
+        case MeshSectionType::Positions:
+            if (entry.elementSize != sizeof(GLfloat) || entry.count % 3 != 0) {
+                throw std::runtime_error("Invalid position section");
+            }
+            positions_ = reinterpret_cast<const GLfloat*>(section);
+            positionCount_ = static_cast<size_t>(entry.count);
+            break;
+        case MeshSectionType::Colors:
+            if (entry.elementSize != sizeof(GLfloat) || entry.count % 3 != 0) {
+                throw std::runtime_error("Invalid color section");
+            }
+            colors_ = reinterpret_cast<const GLfloat*>(section);
+            colorCount_ = static_cast<size_t>(entry.count);
+            break;
+        case MeshSectionType::Indices:
+            if (entry.elementSize != sizeof(GLuint)) {
+                throw std::runtime_error("Invalid index section");
+            }
+            indices_ = reinterpret_cast<const GLuint*>(section);
+            indexCount_ = static_cast<size_t>(entry.count);
+            break;
+        case MeshSectionType::Bounds: {
+            if (entry.elementSize != sizeof(GLfloat) || entry.count != 6) {
+                throw std::runtime_error("Invalid bounds section");
+            }
+            GLfloat minMax[6];
+            std::memcpy(minMax, section, sizeof(minMax));
+            for (int k = 0; k < 3; ++k) {
+                bounds_.center[k] = 0.5f * (minMax[k] + minMax[k + 3]);
+                float half = 0.5f * (minMax[k + 3] - minMax[k]);
+                bounds_.halfExtent[k] = half > 1e-20f ? half : 1.0f;
+            }
+            hasBounds_ = true;
+            break;
+        }
+        default:
+            // 未知のセクションは後方互換のため読み飛ばす
+            break;
+        }
+    }
+    if (positions_ == nullptr) {
+        throw std::runtime_error("Mesh file has no position section");
+    }
+    if (colors_ != nullptr && colorCount_ != positionCount_) {
+        throw std::runtime_error("Mesh file color count does not match its position count");
+    }
+    if (indices_ != nullptr) {
+        size_t vertexCount = positionCount_ / 3;
+        for (size_t i = 0; i < indexCount_; ++i) {
+            if (indices_[i] >= vertexCount) {
+                throw std::runtime_error("Mesh file index is out of range");
+            }
+        }
+    }
+}
+
+void writeMeshFile(const std::string& path, const MeshView& mesh) {
+    if (mesh.vertices == nullptr || mesh.vertexCount % 3 != 0) {
+        throw std::invalid_argument("Invalid mesh data");
+    }
+    // 色は省略できるが、書くなら頂点ごとにそろえる
+    if (mesh.colors != nullptr && mesh.colorCount > 0 && mesh.colorCount != mesh.vertexCount) {
+        throw std::invalid_argument("Mesh color count does not match its vertex count");
+    }
+
+    struct PendingSection {
+        MeshSectionEntry entry;
+        const void* data;
+    };
+    std::vector<PendingSection> sections;
+
+    // バウンディングボックスは読み込み側で再計算しなくて済むように常に書き出す
+    GLfloat minMax[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    if (mesh.vertexCount >= 3) {
+        for (int k = 0; k < 3; ++k) {
+            minMax[k] = minMax[k + 3] = mesh.vertices[k];
+        }
+        for (size_t i = 3; i < mesh.vertexCount; i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                minMax[k] = std::min(minMax[k], mesh.vertices[i + k]);
+                minMax[k + 3] = std::max(minMax[k + 3], mesh.vertices[i + k]);
+            }
+        }
+    }
+
+    sections.push_back({{uint32_t(MeshSectionType::Positions), sizeof(GLfloat), 0, mesh.vertexCount}, mesh.vertices});
+    if (mesh.colors != nullptr && mesh.colorCount > 0) {
+        sections.push_back({{uint32_t(MeshSectionType::Colors), sizeof(GLfloat), 0, mesh.colorCount}, mesh.colors});
+    }
+    if (mesh.indices != nullptr && mesh.indexCount > 0) {
+        sections.push_back({{uint32_t(MeshSectionType::Indices), sizeof(GLuint), 0, mesh.indexCount}, mesh.indices});
+    }
+    sections.push_back({{uint32_t(MeshSectionType::Bounds), sizeof(GLfloat), 0, 6}, minMax});
+
+    uint64_t offset = alignUp(sizeof(MeshFileHeader) + sections.size() * sizeof(MeshSectionEntry));
+    for (PendingSection& section : sections) {
+        section.entry.offset = offset;
+        offset = alignUp(offset + section.entry.count * section.entry.elementSize);
+    }
+
+    MeshFileHeader header;
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.sectionCount = static_cast<uint32_t>(sections.size());
+    header.reserved = 0;
+    header.fileSize = offset;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Failed to create mesh file: " + path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const PendingSection& section : sections) {
+        out.write(reinterpret_cast<const char*>(&section.entry), sizeof(section.entry));
+    }
+    static const char padding[MESH_FILE_ALIGNMENT] = {};
+    uint64_t written = sizeof(MeshFileHeader) + sections.size() * sizeof(MeshSectionEntry);
+    for (const PendingSection& section : sections) {
+        out.write(padding, static_cast<std::streamsize>(section.entry.offset - written));
+        uint64_t bytes = section.entry.count * section.entry.elementSize;
+        out.write(static_cast<const char*>(section.data), static_cast<std::streamsize>(bytes));
+        written = section.entry.offset + bytes;
+    }
+    out.write(padding, static_cast<std::streamsize>(header.fileSize - written));
+    if (!out) {
+        throw std::runtime_error("Failed to write mesh file: " + path);
+    }
+}
+
+Polygon3D loadMeshFile(const std::string& path, const VertexFormat& format) {
+    MeshFile file(path);
+    return Polygon3D(file.view(), format);
+}
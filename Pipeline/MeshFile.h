@@ -0,0 +1,87 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+#include "Polygon3D.h"
+
+// バイナリメッシュ形式
+// [ヘッダ][セクションテーブル][セクション...] の順に並び、各セクションは
+// MESH_FILE_ALIGNMENTバイト境界に整列している。リトルエンディアン固定。
+constexpr uint32_t MESH_FILE_MAGIC = 0x48534d47; // "GMSH"
+constexpr uint32_t MESH_FILE_VERSION = 1;
+constexpr uint64_t MESH_FILE_ALIGNMENT = 64;
+
+enum class MeshSectionType : uint32_t {
+    Positions = 1, // GLfloat xyz
+    Colors = 2,    // GLfloat rgb
+    Indices = 3,   // GLuint
+    Bounds = 4     // GLfloat min[3], max[3]
+};
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t reserved;
+    uint64_t fileSize;
+};
+
+struct MeshSectionEntry {
+    uint32_t type;        // MeshSectionType
+    uint32_t elementSize; // 要素1つのバイト数
+    uint64_t offset;      // ファイル先頭からのオフセット
+    uint64_t count;       // 要素数
+};
+
+// メッシュファイルを読み取り専用でメモリマップする
+// view()が返すポインタはこのオブジェクトが生きている間だけ有効
+class MeshFile {
+public:
+    // 失敗した場合はstd::runtime_errorを投げる
+    explicit MeshFile(const std::string& path);
+    MeshFile(MeshFile&& other) noexcept;            // ムーブコンストラクタ
+    MeshFile& operator=(MeshFile&& other) noexcept; // ムーブ代入演算子
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+    ~MeshFile();
+
+    // マッピング上のデータを指すビュー (コピーしない)
+    MeshView view() const noexcept;
+
+    uint32_t getVersion() const noexcept;
+    bool hasBounds() const noexcept;
+    const QuantizationBounds& getBounds() const noexcept;
+
+private:
+    const unsigned char* data_;
+    size_t size_;
+#ifdef _WIN32
+    void* fileHandle_;
+    void* mappingHandle_;
+#else
+    int fd_;
+#endif
+    uint32_t version_;
+    const GLfloat* positions_;
+    size_t positionCount_;
+    const GLfloat* colors_;
+    size_t colorCount_;
+    const GLuint* indices_;
+    size_t indexCount_;
+    bool hasBounds_;
+    QuantizationBounds bounds_;
+
+    void map(const std::string& path);
+    void unmap() noexcept;
+    void parse();
+};
+
+// メッシュをファイルへ書き出す (失敗した場合はstd::runtime_errorを投げる)
+void writeMeshFile(const std::string& path, const MeshView& mesh);
+
+// ファイルをマップし、マッピングから直接アップロードしたPolygon3Dを返す
+Polygon3D loadMeshFile(const std::string& path, const VertexFormat& format = VertexFormat());
+
+#endif // MESH_FILE_H
@@ -0,0 +1,119 @@
+#include "MeshLaplacian.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    // 1三角形あたりの三つ組の数 (3辺 x (非対角2 + 対角2))
+    const size_t TRIPLETS_PER_TRIANGLE = 12;
+
+    void readPosition(const IndexedMesh& mesh, GLuint index, double out[3]) {
+        for (int k = 0; k < 3; ++k) {
+            out[k] = mesh.positions[index * 3 + k];
+        }
+    }
+
+    // 頂点aの角の余接 (辺abと辺acのなす角)
+    double cotangent(const double a[3], const double b[3], const double c[3]) {
+        const double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        const double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        const double dotUV = u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+        const double cross[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        const double crossNorm = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+        // 潰れた三角形は重みを持たせない
+        return crossNorm > 0 ? dotUV / crossNorm : 0.0;
+    }
+
+    // scale * Lの三つ組をtripletsに書く (三角形tの分はt * TRIPLETS_PER_TRIANGLEから)
+    void laplacianTriplets(const IndexedMesh& mesh, double scale, std::vector<Triplet>& triplets, JobSystem& jobs) {
+        const size_t triangleCount = mesh.triangleCount();
+        triplets.resize(triangleCount * TRIPLETS_PER_TRIANGLE);
+        jobs.parallelFor(0, triangleCount, 1024, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; ++t) {
+                const GLuint* corner = &mesh.indices[t * 3];
+                double p[3][3];
+                for (int c = 0; c < 3; ++c) {
+                    readPosition(mesh, corner[c], p[c]);
+                }
+                Triplet* out = &triplets[t * TRIPLETS_PER_TRIANGLE];
+                for (int c = 0; c < 3; ++c) {
+                    // 角cの向かいの辺(i, j)に重みを足す
+                    const int i = (c + 1) % 3;
+                    const int j = (c + 2) % 3;
+                    const double w = 0.5 * scale * cotangent(p[c], p[i], p[j]);
+                    *out++ = Triplet{corner[i], corner[j], -w};
+                    *out++ = Triplet{corner[j], corner[i], -w};
+                    *out++ = Triplet{corner[i], corner[i], w};
+                    *out++ = Triplet{corner[j], corner[j], w};
+                }
+            }
+        });
+    }
+}
+
+SparseMatrix cotangentLaplacian(const IndexedMesh& mesh, JobSystem& jobs) {
+    std::vector<Triplet> triplets;
+    laplacianTriplets(mesh, 1.0, triplets, jobs);
+    return SparseMatrix::fromTriplets(mesh.vertexCount(), mesh.vertexCount(), triplets);
+}
+
+SparseMatrix cotangentLaplacian(const Polygon3D& polygon, IndexedMesh& welded, JobSystem& jobs) {
+    if (polygon.getVertices().empty() && polygon.getVertexCount() > 0) {
+        throw std::logic_error("Polygon3D created from a MeshView has no CPU copy to build a Laplacian from");
+    }
+    // 色の継ぎ目で切れないように、位置だけでまとめる (色は平均される)
+    welded = weldVertices(polygon.getVertices(), polygon.getColors(), WeldMode::Position);
+    return cotangentLaplacian(welded, jobs);
+}
+
+std::vector<double> vertexAreas(const IndexedMesh& mesh) {
+    std::vector<double> areas(mesh.vertexCount(), 0.0);
+    for (size_t t = 0; t < mesh.triangleCount(); ++t) {
+        const GLuint* corner = &mesh.indices[t * 3];
+        double p[3][3];
+        for (int c = 0; c < 3; ++c) {
+            readPosition(mesh, corner[c], p[c]);
+        }
+        const double u[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+        const double v[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+        const double cross[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        const double area = 0.5 * std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+        for (int c = 0; c < 3; ++c) {
+            areas[corner[c]] += area / 3.0;
+        }
+    }
+    return areas;
+}
+
+ConjugateGradientResult smoothMesh(IndexedMesh& mesh, double timeStep, const ConjugateGradientOptions& options) {
+    const size_t n = mesh.vertexCount();
+    JobSystem& jobs = options.jobs ? *options.jobs : JobSystem::instance();
+
+    // A = M + timeStep * L (どの頂点にも対角を置くので、三角形に使われない頂点はそのまま残る)
+    const std::vector<double> areas = vertexAreas(mesh);
+    std::vector<Triplet> triplets;
+    laplacianTriplets(mesh, timeStep, triplets, jobs);
+    for (size_t i = 0; i < n; ++i) {
+        triplets.push_back(Triplet{i, i, areas[i] > 0 ? areas[i] : 1.0});
+    }
+    const SparseMatrix a = SparseMatrix::fromTriplets(n, n, triplets);
+
+    ConjugateGradientResult worst;
+    worst.converged = true;
+    std::vector<double> b(n), x(n);
+    for (int k = 0; k < 3; ++k) {
+        for (size_t i = 0; i < n; ++i) {
+            x[i] = mesh.positions[i * 3 + k];
+            b[i] = (areas[i] > 0 ? areas[i] : 1.0) * x[i];
+        }
+        const ConjugateGradientResult result = conjugateGradient(a, b, x, options);
+        for (size_t i = 0; i < n; ++i) {
+            mesh.positions[i * 3 + k] = static_cast<GLfloat>(x[i]);
+        }
+        if (result.iterations >= worst.iterations) {
+            worst.iterations = result.iterations;
+            worst.relativeResidual = result.relativeResidual;
+        }
+        worst.converged = worst.converged && result.converged;
+    }
+    return worst;
+}
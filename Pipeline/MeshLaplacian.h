@@ -0,0 +1,28 @@
+#ifndef MESH_LAPLACIAN_H
+#define MESH_LAPLACIAN_H
+
+#include <vector>
+#include "Math/sparse_matrix.h"
+#include "Math/conjugate_gradient.h"
+#include "Core/job_system.h"
+#include "MeshTopology.h"
+#include "Polygon3D.h"
+
+// 余接重みのラプラシアン (半正定値の向き)
+// L_ij = -(cot α_ij + cot β_ij) / 2 (辺ijの対角にある2つの角)、L_ii = -Σ_j L_ij
+// 三角形ごとの重みはjobsで並列に求め、最後にCSRへまとめる
+SparseMatrix cotangentLaplacian(const IndexedMesh& mesh, JobSystem& jobs = JobSystem::instance());
+// Polygon3Dの三角形リストから作る (weldVerticesで位置だけが同じ頂点もまとめ、その結果をweldedに返す)
+// CPU側のデータを持たない (MeshViewから作った) 場合はstd::logic_errorを投げる
+SparseMatrix cotangentLaplacian(const Polygon3D& polygon, IndexedMesh& welded,
+                                JobSystem& jobs = JobSystem::instance());
+
+// 頂点ごとの面積 (接する三角形の面積を1/3ずつ配る、集中質量行列の対角)
+std::vector<double> vertexAreas(const IndexedMesh& mesh);
+
+// 陰的ラプラシアン平滑化: (M + timeStep * L) x' = M x を座標ごとに解き、mesh.positionsを置き換える
+// 戻り値は3回の求解のうち最も反復の多かったもの
+ConjugateGradientResult smoothMesh(IndexedMesh& mesh, double timeStep,
+                                   const ConjugateGradientOptions& options = ConjugateGradientOptions());
+
+#endif // MESH_LAPLACIAN_H
@@ -0,0 +1,640 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// 位置(3) + 重み付きの色(3)
+constexpr int DIM = 6;
+constexpr int PACKED = DIM * (DIM + 1) / 2;
+
+inline int packedIndex(int i, int j) {
+    if (i > j) {
+        std::swap(i, j);
+    }
+    return i * DIM - i * (i - 1) / 2 + (j - i);
+}
+
+// Q(v) = vᵀAv + 2bᵀv + c (Aは対称なので上三角だけ持つ)
+struct Quadric {
+    double a[PACKED] = {};
+    double b[DIM] = {};
+    double c = 0.0;
+    // 面積の合計 (誤差を距離に換算するために使う)
+    double weight = 0.0;
+
+    void add(const Quadric& other, double scale = 1.0) {
+        for (int i = 0; i < PACKED; ++i) a[i] += other.a[i] * scale;
+        for (int i = 0; i < DIM; ++i) b[i] += other.b[i] * scale;
+        c += other.c * scale;
+        weight += other.weight * scale;
+    }
+
+    double evaluate(const double v[DIM]) const {
+        double result = c;
+        for (int i = 0; i < DIM; ++i) {
+            double row = 0.0;
+            for (int j = 0; j < DIM; ++j) {
+                row += a[packedIndex(i, j)] * v[j];
+            }
+            result += v[i] * row + 2.0 * b[i] * v[i];
+        }
+        return result;
+    }
+
+    // A x = -b を部分ピボット付きのガウスの消去法で解く
+    bool optimize(double out[DIM]) const {
+        double m[DIM][DIM + 1];
+        for (int i = 0; i < DIM; ++i) {
+            for (int j = 0; j < DIM; ++j) {
+                m[i][j] = a[packedIndex(i, j)];
+            }
+            m[i][DIM] = -b[i];
+        }
+        for (int col = 0; col < DIM; ++col) {
+            int pivot = col;
+            for (int row = col + 1; row < DIM; ++row) {
+                if (std::fabs(m[row][col]) > std::fabs(m[pivot][col])) {
+                    pivot = row;
+                }
+            }
+            if (std::fabs(m[pivot][col]) < 1e-12) {
+                return false;
+            }
+            if (pivot != col) {
+                for (int j = 0; j <= DIM; ++j) {
+                    std::swap(m[pivot][j], m[col][j]);
+                }
+            }
+            for (int row = col + 1; row < DIM; ++row) {
+                double f = m[row][col] / m[col][col];
+                for (int j = col; j <= DIM; ++j) {
+                    m[row][j] -= f * m[col][j];
+                }
+            }
+        }
+        for (int i = DIM - 1; i >= 0; --i) {
+            double sum = m[i][DIM];
+            for (int j = i + 1; j < DIM; ++j) {
+                sum -= m[i][j] * out[j];
+            }
+            out[i] = sum / m[i][i];
+        }
+        return true;
+    }
+};
+
+inline double dot6(const double* x, const double* y) {
+    double sum = 0.0;
+    for (int i = 0; i < DIM; ++i) sum += x[i] * y[i];
+    return sum;
+}
+
+// 6次元空間の三角形に対する二次誤差 (Garland & Heckbert 1998)
+Quadric triangleQuadric(const double* p, const double* q, const double* r, double area) {
+    Quadric quadric;
+    double e1[DIM], e2[DIM];
+    for (int i = 0; i < DIM; ++i) {
+        e1[i] = q[i] - p[i];
+        e2[i] = r[i] - p[i];
+    }
+    double len1 = std::sqrt(dot6(e1, e1));
+    if (len1 < 1e-20) {
+        return quadric;
+    }
+    for (int i = 0; i < DIM; ++i) e1[i] /= len1;
+    double proj = dot6(e1, e2);
+    for (int i = 0; i < DIM; ++i) e2[i] -= proj * e1[i];
+    double len2 = std::sqrt(dot6(e2, e2));
+    if (len2 < 1e-20) {
+        return quadric;
+    }
+    for (int i = 0; i < DIM; ++i) e2[i] /= len2;
+
+    double pe1 = dot6(p, e1);
+    double pe2 = dot6(p, e2);
+    for (int i = 0; i < DIM; ++i) {
+        for (int j = i; j < DIM; ++j) {
+            double identity = i == j ? 1.0 : 0.0;
+            quadric.a[packedIndex(i, j)] = area * (identity - e1[i] * e1[j] - e2[i] * e2[j]);
+        }
+        quadric.b[i] = area * (pe1 * e1[i] + pe2 * e2[i] - p[i]);
+    }
+    quadric.c = area * (dot6(p, p) - pe1 * pe1 - pe2 * pe2);
+    quadric.weight = area;
+    return quadric;
+}
+
+// 位置だけに効く平面の二次誤差 (nは単位法線、平面は n·x + d = 0)
+Quadric planeQuadric(const double n[3], double d, double scale) {
+    Quadric quadric;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = i; j < 3; ++j) {
+            quadric.a[packedIndex(i, j)] = scale * n[i] * n[j];
+        }
+        quadric.b[i] = scale * d * n[i];
+    }
+    quadric.c = scale * d * d;
+    return quadric;
+}
+
+inline void cross3(const double* a, const double* b, double* out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+inline void faceNormal(const double* p, const double* q, const double* r, double* out) {
+    double e1[3] = {q[0] - p[0], q[1] - p[1], q[2] - p[2]};
+    double e2[3] = {r[0] - p[0], r[1] - p[1], r[2] - p[2]};
+    cross3(e1, e2, out);
+}
+
+struct Candidate {
+    double cost;
+    uint32_t v0, v1;
+    uint32_t version0, version1;
+    double target[DIM];
+    // 位置だけの平面の二次誤差から求めた距離
+    double error;
+
+    bool operator>(const Candidate& other) const { return cost > other.cost; }
+};
+
+class EdgeCollapser {
+public:
+    EdgeCollapser(const IndexedMesh& mesh, const SimplifyOptions& options)
+        : options_(options), hasColors_(!mesh.colors.empty()),
+          colorWeight_(options.colorWeight > 0.0f ? options.colorWeight : 0.0),
+          // 重みが0なら色は二次誤差に入れず、別に持って辺に沿って補間する
+          geometryOnly_(hasColors_ && colorWeight_ == 0.0),
+          vertexCount_(mesh.vertexCount()), faces_(mesh.indices),
+          data_(vertexCount_ * DIM, 0.0), quadrics_(vertexCount_), planes_(vertexCount_), version_(vertexCount_, 0),
+          removed_(vertexCount_, false), faceAlive_(faces_.size() / 3, true), vertexFaces_(vertexCount_),
+          // 色の継ぎ目の頂点は両側で別々に動くと形に隙間ができるので、動かさない
+          locked_(findSeamVertices(mesh)) {
+        // 位置も色も同じ重複頂点は継ぎ目ではないので、最初の頂点にまとめて動かせるようにする
+        const std::vector<GLuint> canonical = findDuplicateVertices(mesh);
+        for (GLuint& v : faces_) {
+            v = canonical[v];
+        }
+        for (size_t v = 0; v < vertexCount_; ++v) {
+            for (int k = 0; k < 3; ++k) {
+                data_[v * DIM + k] = mesh.positions[v * 3 + k];
+                data_[v * DIM + 3 + k] = hasColors_ ? mesh.colors[v * 3 + k] * colorWeight_ : 0.0;
+            }
+        }
+        if (geometryOnly_) {
+            colors_.assign(mesh.colors.begin(), mesh.colors.end());
+        }
+        // 同じ頂点を2回参照する縮退した面は最初から除外する
+        liveFaces_ = 0;
+        for (size_t f = 0; f < faces_.size() / 3; ++f) {
+            const GLuint* tri = &faces_[f * 3];
+            faceAlive_[f] = tri[0] != tri[1] && tri[1] != tri[2] && tri[2] != tri[0];
+            liveFaces_ += faceAlive_[f] ? 1 : 0;
+        }
+        buildQuadrics();
+        for (size_t f = 0; f < faces_.size() / 3; ++f) {
+            if (!faceAlive_[f]) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                uint32_t a = faces_[f * 3 + k];
+                uint32_t b = faces_[f * 3 + (k + 1) % 3];
+                // 各辺を1回だけ候補に入れる (境界辺は片側しか現れないので両方向を許す)
+                if (a < b || edgeCount_[edgeKey(a, b)] == 1) {
+                    pushCandidate(a, b);
+                }
+            }
+        }
+    }
+
+    void collapseUntil(size_t targetFaces) {
+        while (liveFaces_ > targetFaces && !heap_.empty()) {
+            Candidate candidate = heap_.top();
+            heap_.pop();
+            if (removed_[candidate.v0] || removed_[candidate.v1] ||
+                version_[candidate.v0] != candidate.version0 || version_[candidate.v1] != candidate.version1) {
+                continue;
+            }
+            if (flipsFaces(candidate.v0, candidate.v1, candidate.target) ||
+                flipsFaces(candidate.v1, candidate.v0, candidate.target)) {
+                continue;
+            }
+            collapse(candidate);
+        }
+    }
+
+    IndexedMesh result(float& outError) const {
+        IndexedMesh mesh;
+        std::vector<uint32_t> remap(vertexCount_, UINT32_MAX);
+        for (size_t f = 0; f < faceAlive_.size(); ++f) {
+            if (!faceAlive_[f]) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                uint32_t v = faces_[f * 3 + k];
+                if (remap[v] == UINT32_MAX) {
+                    remap[v] = static_cast<uint32_t>(mesh.vertexCount());
+                    for (int i = 0; i < 3; ++i) {
+                        mesh.positions.push_back(static_cast<GLfloat>(data_[v * DIM + i]));
+                    }
+                    if (hasColors_) {
+                        for (int i = 0; i < 3; ++i) {
+                            double color = geometryOnly_ ? colors_[v * 3 + i] : data_[v * DIM + 3 + i] / colorWeight_;
+                            mesh.colors.push_back(static_cast<GLfloat>(std::min(1.0, std::max(0.0, color))));
+                        }
+                    }
+                }
+                mesh.indices.push_back(remap[v]);
+            }
+        }
+        outError = static_cast<float>(maxError_);
+        return mesh;
+    }
+
+private:
+    const SimplifyOptions& options_;
+    bool hasColors_;
+    double colorWeight_;
+    bool geometryOnly_;
+    size_t vertexCount_;
+    std::vector<GLuint> faces_;
+    std::vector<double> data_;
+    // geometryOnly_のときの頂点の色
+    std::vector<double> colors_;
+    std::vector<Quadric> quadrics_;
+    // 縮約の順序は色も含めたquadrics_で決め、誤差の上限は位置だけのこちらで測る
+    std::vector<Quadric> planes_;
+    std::vector<uint32_t> version_;
+    std::vector<bool> removed_;
+    std::vector<bool> faceAlive_;
+    std::vector<std::vector<uint32_t>> vertexFaces_;
+    std::vector<bool> locked_;
+    std::unordered_map<uint64_t, int> edgeCount_;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> heap_;
+    size_t liveFaces_ = 0;
+    double maxError_ = 0.0;
+
+    static uint64_t edgeKey(uint32_t a, uint32_t b) {
+        if (a > b) {
+            std::swap(a, b);
+        }
+        return (uint64_t(a) << 32) | b;
+    }
+
+    const double* vertex(uint32_t v) const { return &data_[size_t(v) * DIM]; }
+
+    void buildQuadrics() {
+        for (size_t f = 0; f < faces_.size() / 3; ++f) {
+            if (!faceAlive_[f]) {
+                continue;
+            }
+            const uint32_t* tri = &faces_[f * 3];
+            double n[3];
+            faceNormal(vertex(tri[0]), vertex(tri[1]), vertex(tri[2]), n);
+            double area = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            Quadric q = triangleQuadric(vertex(tri[0]), vertex(tri[1]), vertex(tri[2]), area);
+            Quadric plane;
+            if (area > 0.0) {
+                const double unit[3] = {n[0] / (2.0 * area), n[1] / (2.0 * area), n[2] / (2.0 * area)};
+                const double* p = vertex(tri[0]);
+                plane = planeQuadric(unit, -(unit[0] * p[0] + unit[1] * p[1] + unit[2] * p[2]), area);
+                plane.weight = area;
+            }
+            for (int k = 0; k < 3; ++k) {
+                quadrics_[tri[k]].add(q);
+                planes_[tri[k]].add(plane);
+                vertexFaces_[tri[k]].push_back(static_cast<uint32_t>(f));
+                ++edgeCount_[edgeKey(tri[k], tri[(k + 1) % 3])];
+            }
+        }
+
+        // 境界辺には面に垂直な平面を加えて、輪郭が縮まないようにする
+        for (size_t f = 0; f < faces_.size() / 3; ++f) {
+            if (!faceAlive_[f]) {
+                continue;
+            }
+            const uint32_t* tri = &faces_[f * 3];
+            double n[3];
+            faceNormal(vertex(tri[0]), vertex(tri[1]), vertex(tri[2]), n);
+            for (int k = 0; k < 3; ++k) {
+                uint32_t a = tri[k];
+                uint32_t b = tri[(k + 1) % 3];
+                if (edgeCount_[edgeKey(a, b)] != 1) {
+                    continue;
+                }
+                const double* pa = vertex(a);
+                const double* pb = vertex(b);
+                double edge[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+                double side[3];
+                cross3(edge, n, side);
+                double len = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+                if (len < 1e-20) {
+                    continue;
+                }
+                for (int i = 0; i < 3; ++i) side[i] /= len;
+                double d = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+                double edgeLengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+                Quadric q = planeQuadric(side, d, options_.boundaryWeight * edgeLengthSquared);
+                quadrics_[a].add(q);
+                quadrics_[b].add(q);
+                // 輪郭の後退も誤差に含める (重みは付けずに面と同じ単位で)
+                Quadric plane = planeQuadric(side, d, edgeLengthSquared);
+                planes_[a].add(plane);
+                planes_[b].add(plane);
+            }
+        }
+    }
+
+    void pushCandidate(uint32_t v0, uint32_t v1) {
+        // 固定した頂点は消さない (両端とも固定なら縮約しない、片方なら固定した側へ寄せる)
+        if (locked_[v0] && locked_[v1]) {
+            return;
+        }
+        if (locked_[v1]) {
+            std::swap(v0, v1);
+        }
+        Quadric q = quadrics_[v0];
+        q.add(quadrics_[v1]);
+
+        Candidate candidate;
+        candidate.v0 = v0;
+        candidate.v1 = v1;
+        candidate.version0 = version_[v0];
+        candidate.version1 = version_[v1];
+
+        if (locked_[v0]) {
+            std::copy(vertex(v0), vertex(v0) + DIM, candidate.target);
+            candidate.cost = q.evaluate(candidate.target);
+        } else if (q.optimize(candidate.target)) {
+            candidate.cost = q.evaluate(candidate.target);
+        } else {
+            // 特異なときは端点と中点から選ぶ
+            double midpoint[DIM];
+            for (int i = 0; i < DIM; ++i) {
+                midpoint[i] = 0.5 * (vertex(v0)[i] + vertex(v1)[i]);
+            }
+            const double* choices[3] = {vertex(v0), vertex(v1), midpoint};
+            candidate.cost = INFINITY;
+            for (const double* choice : choices) {
+                double cost = q.evaluate(choice);
+                if (cost < candidate.cost) {
+                    candidate.cost = cost;
+                    std::copy(choice, choice + DIM, candidate.target);
+                }
+            }
+        }
+        candidate.cost = std::max(0.0, candidate.cost);
+        // 重み(面積)あたりの二乗距離に直す
+        if (q.weight > 0.0) {
+            candidate.cost /= q.weight;
+        }
+        // 色の項を含まない、元の面からの距離
+        Quadric planes = planes_[v0];
+        planes.add(planes_[v1]);
+        candidate.error = planes.weight > 0.0 ? std::sqrt(std::max(0.0, planes.evaluate(candidate.target)) / planes.weight)
+                                              : 0.0;
+        heap_.push(candidate);
+    }
+
+    // vを移動したとき、other を含まない周囲の面が裏返るかどうか
+    bool flipsFaces(uint32_t v, uint32_t other, const double* target) const {
+        for (uint32_t f : vertexFaces_[v]) {
+            if (!faceAlive_[f]) {
+                continue;
+            }
+            const uint32_t* tri = &faces_[size_t(f) * 3];
+            if (tri[0] == other || tri[1] == other || tri[2] == other) {
+                continue;
+            }
+            const double* p[3];
+            const double* moved[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = vertex(tri[k]);
+                moved[k] = tri[k] == v ? target : p[k];
+            }
+            double before[3], after[3];
+            faceNormal(p[0], p[1], p[2], before);
+            faceNormal(moved[0], moved[1], moved[2], after);
+            double lenBefore = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+            double lenAfter = std::sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+            if (lenAfter < 1e-30) {
+                return true;
+            }
+            if (lenBefore < 1e-30) {
+                continue;
+            }
+            double cosine = (before[0] * after[0] + before[1] * after[1] + before[2] * after[2]) / (lenBefore * lenAfter);
+            if (cosine < options_.maxNormalDeviation) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 目標の位置を辺v0-v1へ射影した点で、両端の色を補間してv0の色にする
+    void interpolateColor(uint32_t v0, uint32_t v1, const double* target) {
+        const double* p0 = vertex(v0);
+        const double* p1 = vertex(v1);
+        double edge[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        double lengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+        double t = 0.0;
+        if (lengthSquared > 0.0) {
+            t = (edge[0] * (target[0] - p0[0]) + edge[1] * (target[1] - p0[1]) + edge[2] * (target[2] - p0[2])) /
+                lengthSquared;
+            t = std::min(1.0, std::max(0.0, t));
+        }
+        for (int i = 0; i < 3; ++i) {
+            colors_[v0 * 3 + i] += t * (colors_[v1 * 3 + i] - colors_[v0 * 3 + i]);
+        }
+    }
+
+    // v1をv0へ縮約する
+    void collapse(const Candidate& candidate) {
+        uint32_t v0 = candidate.v0;
+        uint32_t v1 = candidate.v1;
+        if (geometryOnly_) {
+            interpolateColor(v0, v1, candidate.target);
+        }
+        std::copy(candidate.target, candidate.target + DIM, &data_[size_t(v0) * DIM]);
+        quadrics_[v0].add(quadrics_[v1]);
+        planes_[v0].add(planes_[v1]);
+        removed_[v1] = true;
+        maxError_ = std::max(maxError_, candidate.error);
+
+        for (uint32_t f : vertexFaces_[v1]) {
+            if (!faceAlive_[f]) {
+                continue;
+            }
+            uint32_t* tri = &faces_[size_t(f) * 3];
+            if (tri[0] == v0 || tri[1] == v0 || tri[2] == v0) {
+                faceAlive_[f] = false;
+                --liveFaces_;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                if (tri[k] == v1) {
+                    tri[k] = v0;
+                }
+            }
+            vertexFaces_[v0].push_back(f);
+        }
+        std::vector<uint32_t>().swap(vertexFaces_[v1]);
+        ++version_[v0];
+
+        // 死んだ面を取り除きつつ隣接頂点を集め、辺の候補を作り直す
+        std::vector<uint32_t>& faces = vertexFaces_[v0];
+        faces.erase(std::remove_if(faces.begin(), faces.end(), [this](uint32_t f) { return !faceAlive_[f]; }), faces.end());
+        std::vector<uint32_t> neighbors;
+        for (uint32_t f : faces) {
+            for (int k = 0; k < 3; ++k) {
+                uint32_t u = faces_[size_t(f) * 3 + k];
+                if (u != v0) {
+                    neighbors.push_back(u);
+                }
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        for (uint32_t u : neighbors) {
+            pushCandidate(v0, u);
+        }
+    }
+};
+
+} // namespace
+
+IndexedMesh simplifyMesh(const IndexedMesh& mesh, size_t targetTriangles, float& outError,
+                         const SimplifyOptions& options) {
+    if (mesh.indices.size() % 3 != 0) {
+        throw std::invalid_argument("Index data is not a triangle list");
+    }
+    if (!mesh.colors.empty() && mesh.colors.size() != mesh.positions.size()) {
+        throw std::invalid_argument("Color data does not match vertex data");
+    }
+    EdgeCollapser collapser(mesh, options);
+    collapser.collapseUntil(targetTriangles);
+    return collapser.result(outError);
+}
+
+LodChain buildLodChain(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors,
+                       size_t levelCount, float reduction, const SimplifyOptions& options) {
+    LodChain chain;
+    // 位置と色が一致する頂点だけをまとめるので、levels[0]は元の三角形リストと同じ見た目になる
+    IndexedMesh base = weldVertices(vertices, colors, WeldMode::PositionAndColor);
+
+    // バウンディングボックスの中心を球の中心にする
+    float minV[3] = {0.0f, 0.0f, 0.0f};
+    float maxV[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t v = 0; v < base.vertexCount(); ++v) {
+        for (int k = 0; k < 3; ++k) {
+            float p = base.positions[v * 3 + k];
+            minV[k] = v == 0 ? p : std::min(minV[k], p);
+            maxV[k] = v == 0 ? p : std::max(maxV[k], p);
+        }
+    }
+    float radiusSquared = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+        chain.center[k] = 0.5f * (minV[k] + maxV[k]);
+    }
+    for (size_t v = 0; v < base.vertexCount(); ++v) {
+        float d2 = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+            float d = base.positions[v * 3 + k] - chain.center[k];
+            d2 += d * d;
+        }
+        radiusSquared = std::max(radiusSquared, d2);
+    }
+    chain.radius = std::sqrt(radiusSquared);
+
+    chain.levels.push_back({std::move(base), 0.0f});
+    while (chain.levels.size() < levelCount) {
+        const LodLevel& previous = chain.levels.back();
+        size_t previousTriangles = previous.mesh.triangleCount();
+        size_t target = static_cast<size_t>(static_cast<float>(previousTriangles) * reduction);
+        if (target < 4) {
+            break;
+        }
+        float error = 0.0f;
+        IndexedMesh simplified = simplifyMesh(previous.mesh, target, error, options);
+        // ほとんど減らせなくなったら打ち切る
+        if (simplified.triangleCount() * 20 >= previousTriangles * 19) {
+            break;
+        }
+        float accumulated = previous.error + error;
+        chain.levels.push_back({std::move(simplified), accumulated});
+    }
+    return chain;
+}
+
+size_t selectLod(const LodChain& chain, const Matrix4& modelViewProjection, float viewportHeight, float pixelError) {
+    if (chain.levels.size() <= 1) {
+        return 0;
+    }
+    Vector4 clip = modelViewProjection.multiply(Vector4(chain.center[0], chain.center[1], chain.center[2], 1.0f));
+    // 球がカメラの近くにかかっているときは最も詳細なLODを使う
+    if (clip.w <= chain.radius) {
+        return 0;
+    }
+    // クリップ空間のyの行の長さが、距離1での画面の縦方向の拡大率になる
+    const float* row = modelViewProjection.m[1];
+    float scale = std::sqrt(row[0] * row[0] + row[1] * row[1] + row[2] * row[2]);
+    float pixelsPerUnit = scale / clip.w * viewportHeight * 0.5f;
+
+    for (size_t level = chain.levels.size() - 1; level > 0; --level) {
+        if (chain.levels[level].error * pixelsPerUnit <= pixelError) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+LodMesh::LodMesh(const LodChain& chain, const VertexFormat& format) : chain_(chain), format_(format) {
+    uploadLevels();
+}
+
+void LodMesh::setChain(LodChain&& chain) {
+    chain_ = std::move(chain);
+    uploadLevels();
+}
+
+void LodMesh::uploadLevels() {
+    levels_.clear();
+    levels_.reserve(chain_.levels.size());
+    for (LodLevel& level : chain_.levels) {
+        MeshView view;
+        view.vertices = level.mesh.positions.data();
+        view.vertexCount = level.mesh.positions.size();
+        view.colors = level.mesh.colors.data();
+        view.colorCount = level.mesh.colors.size();
+        view.indices = level.mesh.indices.data();
+        view.indexCount = level.mesh.indices.size();
+        levels_.emplace_back(view, format_);
+        // 選択には誤差とバウンディングスフィアしか使わないので、CPU側の形状は解放する
+        level.mesh = IndexedMesh();
+    }
+}
+
+size_t LodMesh::draw(const Matrix4& modelViewProjection, float viewportHeight, float pixelError) const {
+    size_t level = selectLod(chain_, modelViewProjection, viewportHeight, pixelError);
+    levels_[level].draw();
+    return level;
+}
+
+size_t LodMesh::getLevelCount() const noexcept {
+    return levels_.size();
+}
+
+const Polygon3D& LodMesh::getLevel(size_t level) const {
+    return levels_.at(level);
+}
+
+const LodChain& LodMesh::getChain() const noexcept {
+    return chain_;
+}
@@ -0,0 +1,77 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include <GL/glew.h>
+#include "Math/vector_space.h"
+#include "MeshTopology.h"
+#include "Polygon3D.h"
+
+struct SimplifyOptions {
+    // 色の差をどれだけ距離として扱うか (0なら形状だけで判断し、色は縮約した辺に沿って補間する)
+    float colorWeight = 0.1f;
+    // 境界の辺を保つための重み
+    float boundaryWeight = 10.0f;
+    // 面の法線がこれ以上回転する縮約は行わない (cos)
+    float maxNormalDeviation = 0.2f;
+};
+
+// 二次誤差尺度 (位置と色の6次元) による辺縮約でtargetTriangles以下まで簡略化する
+// 同じ位置に色の違う頂点がある継ぎ目 (findSeamVertices) は動かさないので、継ぎ目に隙間はできない。
+// 位置も色も同じ重複頂点は1つにまとめて縮約する。面ごとに色の違うフラットな形 (サンプルの立方体など) は
+// すべての角が継ぎ目になるので、縮約できずに元のまま返る。
+// outErrorには行った縮約の最大誤差 (元の面からの距離。色の項は含めない) を返す
+IndexedMesh simplifyMesh(const IndexedMesh& mesh, size_t targetTriangles, float& outError,
+                         const SimplifyOptions& options = SimplifyOptions());
+
+struct LodLevel {
+    IndexedMesh mesh;
+    // 元のメッシュからの幾何誤差の上限 (オブジェクト空間の距離)
+    float error;
+};
+
+struct LodChain {
+    // levels[0]が最も詳細
+    std::vector<LodLevel> levels;
+    // バウンディングスフィア (オブジェクト空間)
+    float center[3];
+    float radius;
+};
+
+// 三角形リストから、三角形数をreductionずつ減らしたLODを最大levelCount段作る
+// levels[0]は元の三角形リストを位置と色の両方が一致する頂点でまとめたもの (形状も色も元のまま)
+LodChain buildLodChain(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors,
+                       size_t levelCount, float reduction = 0.5f,
+                       const SimplifyOptions& options = SimplifyOptions());
+
+// 画面上の誤差がpixelError以下に収まる最も粗いLODを選ぶ
+// modelViewProjectionはオブジェクト空間からクリップ空間への行列、viewportHeightはピクセル数
+size_t selectLod(const LodChain& chain, const Matrix4& modelViewProjection, float viewportHeight,
+                 float pixelError = 1.0f);
+
+// LODごとのPolygon3Dを保持し、描画時に1つを選ぶ
+class LodMesh {
+public:
+    explicit LodMesh(const LodChain& chain, const VertexFormat& format = VertexFormat());
+
+    // LODを作り直したチェーンに差し替え、全レベルを再アップロードする (GLコンテキストのスレッドで呼ぶ)
+    void setChain(LodChain&& chain);
+
+    // 選んだLODの番号を返す
+    size_t draw(const Matrix4& modelViewProjection, float viewportHeight, float pixelError = 1.0f) const;
+
+    size_t getLevelCount() const noexcept;
+    const Polygon3D& getLevel(size_t level) const;
+    // 各LODの誤差とバウンディングスフィア (形状は解放済み)
+    const LodChain& getChain() const noexcept;
+
+private:
+    // chain_の各レベルをアップロードし、CPU側の形状を解放する
+    void uploadLevels();
+
+    LodChain chain_;
+    VertexFormat format_;
+    std::vector<Polygon3D> levels_;
+};
+
+#endif // MESH_SIMPLIFIER_H
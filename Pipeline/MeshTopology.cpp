@@ -0,0 +1,129 @@
+#include "MeshTopology.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    // 位置 (と色) のビット列。位置だけで比べるときは色を0にしておく
+    struct VertexKey {
+        uint32_t bits[6];
+        bool operator==(const VertexKey& other) const {
+            return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+        }
+    };
+
+    struct VertexKeyHash {
+        size_t operator()(const VertexKey& key) const {
+            uint64_t h = 0;
+            for (int k = 0; k < 6; ++k) {
+                h ^= (h >> 29) + key.bits[k] * 0x9e3779b97f4a7c15ull;
+                h *= 0xbf58476d1ce4e5b9ull;
+            }
+            return static_cast<size_t>(h ^ (h >> 32));
+        }
+    };
+
+    VertexKey makeKey(const GLfloat* p, const GLfloat* color) {
+        VertexKey key = {};
+        for (int k = 0; k < 3; ++k) {
+            // -0と+0を同じ頂点として扱う
+            float v = p[k] == 0.0f ? 0.0f : p[k];
+            std::memcpy(&key.bits[k], &v, sizeof(float));
+            if (color != nullptr) {
+                float c = color[k] == 0.0f ? 0.0f : color[k];
+                std::memcpy(&key.bits[3 + k], &c, sizeof(float));
+            }
+        }
+        return key;
+    }
+}
+
+IndexedMesh weldVertices(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors, WeldMode mode) {
+    if (vertices.size() % 9 != 0) {
+        throw std::invalid_argument("Vertex data is not a triangle list");
+    }
+    const bool hasColors = colors.size() == vertices.size();
+    const size_t cornerCount = vertices.size() / 3;
+
+    IndexedMesh mesh;
+    mesh.indices.reserve(cornerCount);
+    std::vector<GLuint> colorSamples;
+    std::unordered_map<VertexKey, GLuint, VertexKeyHash> lookup;
+    lookup.reserve(cornerCount);
+
+    for (size_t i = 0; i < cornerCount; ++i) {
+        const GLfloat* p = &vertices[i * 3];
+        const GLfloat* color = hasColors && mode == WeldMode::PositionAndColor ? &colors[i * 3] : nullptr;
+        auto inserted = lookup.emplace(makeKey(p, color), static_cast<GLuint>(mesh.vertexCount()));
+        GLuint index = inserted.first->second;
+        if (inserted.second) {
+            mesh.positions.insert(mesh.positions.end(), p, p + 3);
+            if (hasColors) {
+                mesh.colors.insert(mesh.colors.end(), &colors[i * 3], &colors[i * 3] + 3);
+                colorSamples.push_back(1);
+            }
+        } else if (hasColors) {
+            for (int k = 0; k < 3; ++k) {
+                mesh.colors[index * 3 + k] += colors[i * 3 + k];
+            }
+            ++colorSamples[index];
+        }
+        mesh.indices.push_back(index);
+    }
+
+    for (size_t v = 0; v < colorSamples.size(); ++v) {
+        float inv = 1.0f / static_cast<float>(colorSamples[v]);
+        for (int k = 0; k < 3; ++k) {
+            mesh.colors[v * 3 + k] *= inv;
+        }
+    }
+    return mesh;
+}
+
+std::vector<GLuint> findDuplicateVertices(const IndexedMesh& mesh) {
+    const size_t vertexCount = mesh.vertexCount();
+    const bool hasColors = mesh.colors.size() == mesh.positions.size();
+    std::vector<GLuint> canonical(vertexCount);
+    std::unordered_map<VertexKey, GLuint, VertexKeyHash> first;
+    first.reserve(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const GLfloat* color = hasColors ? &mesh.colors[v * 3] : nullptr;
+        canonical[v] = first.emplace(makeKey(&mesh.positions[v * 3], color), static_cast<GLuint>(v)).first->second;
+    }
+    return canonical;
+}
+
+std::vector<bool> findSeamVertices(const IndexedMesh& mesh) {
+    const size_t vertexCount = mesh.vertexCount();
+    const std::vector<GLuint> canonical = findDuplicateVertices(mesh);
+    std::vector<bool> seams(vertexCount, false);
+    // 位置ごとに最初に現れた頂点を覚えておき、色の違う頂点が来たら両方に印を付ける
+    // (色も同じ頂点は最初の頂点と同じ頂点として扱うので、印は要らない)
+    std::unordered_map<VertexKey, GLuint, VertexKeyHash> first;
+    first.reserve(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        auto inserted = first.emplace(makeKey(&mesh.positions[v * 3], nullptr), static_cast<GLuint>(v));
+        if (!inserted.second && canonical[v] != canonical[inserted.first->second]) {
+            seams[v] = true;
+            seams[inserted.first->second] = true;
+        }
+    }
+    return seams;
+}
+
+void unweldVertices(const IndexedMesh& mesh, std::vector<GLfloat>& vertices, std::vector<GLfloat>& colors) {
+    vertices.resize(mesh.indices.size() * 3);
+    colors.resize(mesh.colors.empty() ? 0 : mesh.indices.size() * 3);
+    for (size_t i = 0; i < mesh.indices.size(); ++i) {
+        size_t v = static_cast<size_t>(mesh.indices[i]) * 3;
+        for (int k = 0; k < 3; ++k) {
+            vertices[i * 3 + k] = mesh.positions[v + k];
+        }
+        if (!mesh.colors.empty()) {
+            for (int k = 0; k < 3; ++k) {
+                colors[i * 3 + k] = mesh.colors[v + k];
+            }
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef MESH_TOPOLOGY_H
+#define MESH_TOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+// インデックス付きメッシュ (位置が同じ頂点を共有する)
+struct IndexedMesh {
+    std::vector<GLfloat> positions; // xyz
+    std::vector<GLfloat> colors;    // rgb (positionsと同じ長さ、または空)
+    std::vector<GLuint> indices;    // 3つで1三角形
+
+    size_t vertexCount() const noexcept { return positions.size() / 3; }
+    size_t triangleCount() const noexcept { return indices.size() / 3; }
+};
+
+// 頂点をまとめる条件
+enum class WeldMode {
+    Position,         // 位置が一致すればまとめ、色は平均する (形状の連結性を優先する)
+    PositionAndColor, // 位置と色の両方が一致するものだけまとめる (色の継ぎ目を残し、元の見た目と変わらない)
+};
+
+// Polygon3Dの三角形リストから、条件が完全に一致する頂点を1つにまとめる
+IndexedMesh weldVertices(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors,
+                         WeldMode mode = WeldMode::Position);
+
+// 頂点ごとに、位置と色がビット単位で同じ頂点のうち最初のものの番号を返す (重複の無い頂点は自分自身)
+std::vector<GLuint> findDuplicateVertices(const IndexedMesh& mesh);
+
+// 同じ位置に色の違う頂点がある頂点 (PositionAndColorでまとめたときの色の継ぎ目) に印を付ける
+// 位置も色も同じ重複頂点だけなら継ぎ目ではない (findDuplicateVerticesで1つにまとめられる)
+std::vector<bool> findSeamVertices(const IndexedMesh& mesh);
+
+// インデックス付きメッシュをPolygon3D用の三角形リストに戻す
+void unweldVertices(const IndexedMesh& mesh, std::vector<GLfloat>& vertices, std::vector<GLfloat>& colors);
+
+#endif // MESH_TOPOLOGY_H
@@ -0,0 +1,939 @@
+#include "ModelImporter.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// 分割数 (0ならjobsの同時実行数)
+unsigned resolveThreadCount(const ImportOptions& options, const JobSystem& jobs) {
+    size_t count = options.threadCount != 0 ? options.threadCount : jobs.getConcurrency();
+    return static_cast<unsigned>(std::max<size_t>(1, count));
+}
+
+// fn(i)を i = 0..count-1 についてjobsで並列に実行する。最初に投げられた例外を呼び出し側で再送出する
+template <class Fn>
+void parallelFor(JobSystem& jobs, size_t count, Fn&& fn) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+    jobs.parallelFor(0, count, 1, [&fn](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            fn(i);
+        }
+    });
+}
+
+// ファイルを固定サイズのバッファに読み込み、消費した分だけ先へ進める
+class BlockReader {
+public:
+    BlockReader(const std::string& path, size_t blockSize)
+        : in_(path, std::ios::binary), buffer_(std::max<size_t>(blockSize, 4096)), begin_(0), end_(0), eof_(false) {
+        if (!in_) {
+            throw std::runtime_error("Failed to open model file: " + path);
+        }
+    }
+
+    const char* data() const noexcept { return buffer_.data() + begin_; }
+    size_t available() const noexcept { return end_ - begin_; }
+    size_t capacity() const noexcept { return buffer_.size(); }
+    bool inputExhausted() const noexcept { return eof_; }
+    void consume(size_t bytes) noexcept { begin_ += bytes; }
+
+    // 少なくともminBytesが読める状態にする (EOFで足りなければfalse)
+    bool fill(size_t minBytes) {
+        if (available() >= minBytes) {
+            return true;
+        }
+        if (begin_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + begin_, available());
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        if (buffer_.size() < minBytes) {
+            buffer_.resize(minBytes);
+        }
+        while (end_ < buffer_.size() && !eof_) {
+            std::streamsize requested = static_cast<std::streamsize>(buffer_.size() - end_);
+            in_.read(buffer_.data() + end_, requested);
+            std::streamsize got = in_.gcount();
+            end_ += static_cast<size_t>(got);
+            if (got < requested) {
+                eof_ = true;
+            }
+        }
+        return available() >= minBytes;
+    }
+
+private:
+    std::ifstream in_;
+    std::vector<char> buffer_;
+    size_t begin_;
+    size_t end_;
+    bool eof_;
+};
+
+// 完全な行だけを含む範囲の長さを返す (0ならデータ終端)。1行がバッファより長ければバッファを広げる
+size_t takeLines(BlockReader& reader) {
+    size_t want = reader.capacity();
+    for (;;) {
+        reader.fill(want);
+        size_t size = reader.available();
+        if (size == 0) {
+            return 0;
+        }
+        if (reader.inputExhausted()) {
+            return size;
+        }
+        const char* data = reader.data();
+        for (size_t i = size; i > 0; --i) {
+            if (data[i - 1] == '\n') {
+                return i;
+            }
+        }
+        want = size * 2;
+    }
+}
+
+struct TextRange {
+    const char* begin;
+    const char* end;
+};
+
+// [begin, end)を行境界でおおよそparts等分する
+std::vector<TextRange> splitLines(const char* begin, const char* end, size_t parts) {
+    std::vector<TextRange> ranges;
+    size_t size = static_cast<size_t>(end - begin);
+    // 小さすぎるチャンクは分割のコストに見合わない
+    parts = std::max<size_t>(1, std::min(parts, size / (size_t(64) << 10) + 1));
+    const char* p = begin;
+    for (size_t i = 1; i <= parts && p < end; ++i) {
+        const char* cut = i == parts ? end : begin + size * i / parts;
+        if (cut < p) {
+            cut = p;
+        }
+        if (cut < end) {
+            const char* nl = static_cast<const char*>(std::memchr(cut, '\n', static_cast<size_t>(end - cut)));
+            cut = nl ? nl + 1 : end;
+        }
+        ranges.push_back({p, cut});
+        p = cut;
+    }
+    return ranges;
+}
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* lineEnd(const char* p, const char* end) {
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    return nl ? nl : end;
+}
+
+// 空白を読み飛ばして数値を1つ読む。読めなければnullptr
+template <class T>
+inline const char* parseNumber(const char* p, const char* end, T& out) {
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    std::from_chars_result result = std::from_chars(p, end, out);
+    if (result.ec != std::errc()) {
+        return nullptr;
+    }
+    return result.ptr;
+}
+
+// 解決済みの三角形インデックスから三角形リストを組み立て、一定量ごとにシンクへ渡す
+class BatchEmitter {
+public:
+    BatchEmitter(const MeshBatchSink& sink, const ImportOptions& options, unsigned threadCount, JobSystem& jobs)
+        : sink_(sink), options_(options), threadCount_(threadCount), jobs_(jobs) {}
+
+    void emit(const int64_t* indices, size_t indexCount, const GLfloat* positions, const GLfloat* colors) {
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+        size_t offset = batch_.vertices.size();
+        batch_.vertices.resize(offset + triangleCount * 9);
+        batch_.colors.resize(offset + triangleCount * 9);
+        GLfloat* outVertices = batch_.vertices.data() + offset;
+        GLfloat* outColors = batch_.colors.data() + offset;
+        const GLfloat* defaultColor = options_.defaultColor;
+
+        size_t parts = std::min<size_t>(threadCount_, triangleCount / 4096 + 1);
+        parallelFor(jobs_, parts, [&](size_t part) {
+            size_t first = triangleCount * part / parts;
+            size_t last = triangleCount * (part + 1) / parts;
+            for (size_t i = first * 3; i < last * 3; ++i) {
+                size_t v = static_cast<size_t>(indices[i]) * 3;
+                const GLfloat* color = colors ? colors + v : defaultColor;
+                for (int k = 0; k < 3; ++k) {
+                    outVertices[i * 3 + k] = positions[v + k];
+                    outColors[i * 3 + k] = color[k];
+                }
+            }
+        });
+
+        if (batch_.vertices.size() / 9 >= options_.batchTriangles) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (!batch_.vertices.empty()) {
+            sink_(batch_);
+            batch_.vertices.clear();
+            batch_.colors.clear();
+        }
+    }
+
+private:
+    const MeshBatchSink& sink_;
+    const ImportOptions& options_;
+    unsigned threadCount_;
+    JobSystem& jobs_;
+    MeshBatch batch_;
+};
+
+// ---- OBJ ----
+
+// 負の値はチャンク先頭からの相対インデックス (値 + RELATIVE_BIAS が相対位置)
+constexpr int64_t RELATIVE_BIAS = int64_t(1) << 62;
+
+struct ObjChunk {
+    std::vector<GLfloat> positions;
+    // 色付き頂点が現れたときだけpositionsと同じ長さになる
+    std::vector<GLfloat> colors;
+    // 三角形化済みの面インデックス
+    std::vector<int64_t> faces;
+    // facesのうち、ブロックを読み終えた時点でまだ無い頂点を参照する三角形
+    std::vector<int64_t> deferred;
+};
+
+void parseObjChunk(TextRange range, const GLfloat defaultColor[3], ObjChunk& chunk) {
+    const char* p = range.begin;
+    const char* end = range.end;
+    while (p < end) {
+        const char* eol = lineEnd(p, end);
+        const char* q = skipBlanks(p, eol);
+
+        if (q + 1 < eol && q[0] == 'v' && isBlank(q[1])) {
+            GLfloat xyz[3];
+            q += 1;
+            for (int k = 0; k < 3; ++k) {
+                q = parseNumber(q, eol, xyz[k]);
+                if (q == nullptr) {
+                    throw std::runtime_error("Invalid OBJ vertex");
+                }
+            }
+            // "v x y z r g b" 形式の頂点色 (拡張)
+            GLfloat rgb[3];
+            const char* c = q;
+            bool hasColor = true;
+            for (int k = 0; k < 3 && hasColor; ++k) {
+                c = parseNumber(c, eol, rgb[k]);
+                hasColor = c != nullptr;
+            }
+            if (hasColor && chunk.colors.empty()) {
+                for (size_t i = 0; i < chunk.positions.size() / 3; ++i) {
+                    chunk.colors.insert(chunk.colors.end(), defaultColor, defaultColor + 3);
+                }
+            }
+            if (hasColor) {
+                chunk.colors.insert(chunk.colors.end(), rgb, rgb + 3);
+            } else if (!chunk.colors.empty()) {
+                chunk.colors.insert(chunk.colors.end(), defaultColor, defaultColor + 3);
+            }
+            chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+        } else if (q + 1 < eol && q[0] == 'f' && isBlank(q[1])) {
+            int64_t localCount = static_cast<int64_t>(chunk.positions.size() / 3);
+            int64_t first = 0;
+            int64_t previous = 0;
+            int corner = 0;
+            q += 1;
+            for (;;) {
+                q = skipBlanks(q, eol);
+                if (q >= eol || *q == '#') {
+                    break;
+                }
+                int64_t index;
+                std::from_chars_result result = std::from_chars(q, eol, index);
+                if (result.ec != std::errc() || index == 0) {
+                    throw std::runtime_error("Invalid OBJ face");
+                }
+                // テクスチャ座標と法線のインデックス (v/vt/vn) は読み飛ばす
+                q = result.ptr;
+                while (q < eol && !isBlank(*q)) {
+                    ++q;
+                }
+                int64_t encoded = index > 0 ? index - 1 : localCount + index - RELATIVE_BIAS;
+                if (corner == 0) {
+                    first = encoded;
+                } else if (corner >= 2) {
+                    // 多角形は扇形に三角形化する
+                    chunk.faces.push_back(first);
+                    chunk.faces.push_back(previous);
+                    chunk.faces.push_back(encoded);
+                }
+                previous = encoded;
+                ++corner;
+            }
+        }
+        p = eol == end ? end : eol + 1;
+    }
+}
+
+// ---- PLY ----
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+struct PlyProperty {
+    std::string name;
+    PlyType type;
+    bool isList;
+    PlyType countType;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+};
+
+struct PlyHeader {
+    PlyFormat format;
+    std::vector<PlyElement> elements;
+};
+
+size_t plyTypeSize(PlyType type) {
+    switch (type) {
+    case PlyType::Int8:
+    case PlyType::UInt8:   return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:  return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32: return 4;
+    default:               return 8;
+    }
+}
+
+PlyType parsePlyType(const std::string& name) {
+    if (name == "char" || name == "int8") return PlyType::Int8;
+    if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+    if (name == "short" || name == "int16") return PlyType::Int16;
+    if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+    if (name == "int" || name == "int32") return PlyType::Int32;
+    if (name == "uint" || name == "uint32") return PlyType::UInt32;
+    if (name == "float" || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    throw std::runtime_error("Unknown PLY property type: " + name);
+}
+
+// 色の正規化係数 (整数型は最大値で割る)
+double plyColorScale(PlyType type) {
+    switch (type) {
+    case PlyType::UInt8:  return 1.0 / 255.0;
+    case PlyType::UInt16: return 1.0 / 65535.0;
+    default:              return 1.0;
+    }
+}
+
+double readPlyValue(const char* p, PlyType type, bool bigEndian) {
+    unsigned char bytes[8];
+    size_t size = plyTypeSize(type);
+    std::memcpy(bytes, p, size);
+    if (bigEndian) {
+        std::reverse(bytes, bytes + size);
+    }
+    switch (type) {
+    case PlyType::Int8:    { int8_t v;   std::memcpy(&v, bytes, 1); return v; }
+    case PlyType::UInt8:   { uint8_t v;  std::memcpy(&v, bytes, 1); return v; }
+    case PlyType::Int16:   { int16_t v;  std::memcpy(&v, bytes, 2); return v; }
+    case PlyType::UInt16:  { uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+    case PlyType::Int32:   { int32_t v;  std::memcpy(&v, bytes, 4); return v; }
+    case PlyType::UInt32:  { uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+    case PlyType::Float32: { float v;    std::memcpy(&v, bytes, 4); return v; }
+    default:               { double v;   std::memcpy(&v, bytes, 8); return v; }
+    }
+}
+
+PlyHeader readPlyHeader(BlockReader& reader) {
+    static const char terminator[] = "end_header";
+    size_t headerSize = 0;
+    for (size_t want = 4096;; want *= 2) {
+        bool complete = reader.fill(want);
+        const char* data = reader.data();
+        size_t size = reader.available();
+        const char* found = std::search(data, data + size, terminator, terminator + sizeof(terminator) - 1);
+        if (found != data + size) {
+            const char* nl = static_cast<const char*>(std::memchr(found, '\n', static_cast<size_t>(data + size - found)));
+            if (nl != nullptr) {
+                headerSize = static_cast<size_t>(nl + 1 - data);
+                break;
+            }
+        }
+        if (!complete || want > (size_t(1) << 24)) {
+            throw std::runtime_error("PLY header is not terminated");
+        }
+    }
+
+    std::istringstream stream(std::string(reader.data(), headerSize));
+    reader.consume(headerSize);
+
+    PlyHeader header;
+    std::string line;
+    std::getline(stream, line);
+    if (line.compare(0, 3, "ply") != 0) {
+        throw std::runtime_error("Not a PLY file");
+    }
+    bool hasFormat = false;
+    while (std::getline(stream, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            if (format == "ascii") header.format = PlyFormat::Ascii;
+            else if (format == "binary_little_endian") header.format = PlyFormat::BinaryLittleEndian;
+            else if (format == "binary_big_endian") header.format = PlyFormat::BinaryBigEndian;
+            else throw std::runtime_error("Unknown PLY format: " + format);
+            hasFormat = true;
+        } else if (keyword == "element") {
+            PlyElement element;
+            words >> element.name >> element.count;
+            if (!words) {
+                throw std::runtime_error("Invalid PLY element");
+            }
+            header.elements.push_back(element);
+        } else if (keyword == "property") {
+            if (header.elements.empty()) {
+                throw std::runtime_error("PLY property outside of an element");
+            }
+            PlyProperty property;
+            std::string type;
+            words >> type;
+            property.isList = type == "list";
+            if (property.isList) {
+                std::string countType, itemType;
+                words >> countType >> itemType;
+                property.countType = parsePlyType(countType);
+                property.type = parsePlyType(itemType);
+            } else {
+                property.type = parsePlyType(type);
+                property.countType = PlyType::UInt8;
+            }
+            words >> property.name;
+            header.elements.back().properties.push_back(property);
+        } else if (keyword == "end_header") {
+            break;
+        }
+        // comment, obj_info などは無視する
+    }
+    if (!hasFormat) {
+        throw std::runtime_error("PLY header has no format line");
+    }
+    return header;
+}
+
+// 頂点と面の要素で使うプロパティの位置
+struct PlyLayout {
+    size_t vertexElement = SIZE_MAX;
+    size_t faceElement = SIZE_MAX;
+    int position[3] = {-1, -1, -1};
+    int color[3] = {-1, -1, -1};
+    double colorScale[3] = {1.0, 1.0, 1.0};
+    int faceIndices = -1;
+    bool hasColors() const { return color[0] >= 0 && color[1] >= 0 && color[2] >= 0; }
+};
+
+PlyLayout analyzePlyHeader(const PlyHeader& header) {
+    PlyLayout layout;
+    for (size_t e = 0; e < header.elements.size(); ++e) {
+        const PlyElement& element = header.elements[e];
+        if (element.name == "vertex") {
+            layout.vertexElement = e;
+            for (size_t i = 0; i < element.properties.size(); ++i) {
+                const PlyProperty& property = element.properties[i];
+                if (property.isList) {
+                    continue;
+                }
+                static const char* positionNames[3] = {"x", "y", "z"};
+                static const char* colorNames[3] = {"red", "green", "blue"};
+                for (int k = 0; k < 3; ++k) {
+                    if (property.name == positionNames[k]) {
+                        layout.position[k] = static_cast<int>(i);
+                    } else if (property.name == colorNames[k]) {
+                        layout.color[k] = static_cast<int>(i);
+                        layout.colorScale[k] = plyColorScale(property.type);
+                    }
+                }
+            }
+        } else if (element.name == "face") {
+            layout.faceElement = e;
+            for (size_t i = 0; i < element.properties.size(); ++i) {
+                const PlyProperty& property = element.properties[i];
+                if (property.isList && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+                    layout.faceIndices = static_cast<int>(i);
+                }
+            }
+        }
+    }
+    if (layout.vertexElement == SIZE_MAX || layout.position[0] < 0 || layout.position[1] < 0 || layout.position[2] < 0) {
+        throw std::runtime_error("PLY file has no vertex positions");
+    }
+    if (layout.faceElement != SIZE_MAX) {
+        if (layout.faceIndices < 0) {
+            throw std::runtime_error("PLY face element has no vertex index list");
+        }
+        if (layout.faceElement < layout.vertexElement) {
+            throw std::runtime_error("PLY faces before vertices are not supported");
+        }
+    }
+    return layout;
+}
+
+// 扇形に三角形化してfacesへ追加する
+inline void appendPolygon(const int64_t* corners, size_t count, std::vector<int64_t>& faces) {
+    for (size_t i = 2; i < count; ++i) {
+        faces.push_back(corners[0]);
+        faces.push_back(corners[i - 1]);
+        faces.push_back(corners[i]);
+    }
+}
+
+size_t countNonBlankLines(TextRange range) {
+    size_t count = 0;
+    const char* p = range.begin;
+    while (p < range.end) {
+        const char* eol = lineEnd(p, range.end);
+        if (skipBlanks(p, eol) < eol) {
+            ++count;
+        }
+        p = eol == range.end ? range.end : eol + 1;
+    }
+    return count;
+}
+
+// ASCII本体のチャンクを解析する。firstLineは本体の先頭から数えた非空行の番号
+void parsePlyAsciiChunk(TextRange range, size_t firstLine, const PlyHeader& header, const PlyLayout& layout,
+                        const std::vector<size_t>& elementStart, GLfloat* positions, GLfloat* colors,
+                        std::vector<int64_t>& faces) {
+    size_t line = firstLine;
+    size_t element = 0;
+    std::vector<double> values;
+    std::vector<int64_t> corners;
+    const char* p = range.begin;
+    while (p < range.end) {
+        const char* eol = lineEnd(p, range.end);
+        const char* q = skipBlanks(p, eol);
+        p = eol == range.end ? range.end : eol + 1;
+        if (q >= eol) {
+            continue;
+        }
+        size_t current = line++;
+        while (element < header.elements.size() && current >= elementStart[element + 1]) {
+            ++element;
+        }
+        if (element >= header.elements.size()) {
+            // 宣言された要素より後ろの行は無視する
+            return;
+        }
+        if (element != layout.vertexElement && element != layout.faceElement) {
+            continue;
+        }
+
+        const PlyElement& desc = header.elements[element];
+        values.assign(desc.properties.size(), 0.0);
+        for (size_t i = 0; i < desc.properties.size(); ++i) {
+            const PlyProperty& property = desc.properties[i];
+            if (!property.isList) {
+                q = parseNumber(q, eol, values[i]);
+                if (q == nullptr) {
+                    throw std::runtime_error("Invalid PLY " + desc.name + " line");
+                }
+                continue;
+            }
+            size_t count;
+            q = parseNumber(q, eol, count);
+            if (q == nullptr) {
+                throw std::runtime_error("Invalid PLY list");
+            }
+            bool isFaceList = element == layout.faceElement && static_cast<int>(i) == layout.faceIndices;
+            corners.clear();
+            for (size_t k = 0; k < count; ++k) {
+                int64_t index;
+                q = parseNumber(q, eol, index);
+                if (q == nullptr) {
+                    throw std::runtime_error("Invalid PLY list");
+                }
+                if (isFaceList) {
+                    corners.push_back(index);
+                }
+            }
+            if (isFaceList) {
+                appendPolygon(corners.data(), corners.size(), faces);
+            }
+        }
+
+        if (element == layout.vertexElement) {
+            size_t v = (current - elementStart[element]) * 3;
+            for (int k = 0; k < 3; ++k) {
+                positions[v + k] = static_cast<GLfloat>(values[layout.position[k]]);
+            }
+            if (colors != nullptr) {
+                for (int k = 0; k < 3; ++k) {
+                    colors[v + k] = static_cast<GLfloat>(values[layout.color[k]] * layout.colorScale[k]);
+                }
+            }
+        }
+    }
+}
+
+void checkFaceIndices(std::vector<int64_t>& faces, size_t vertexCount) {
+    for (int64_t index : faces) {
+        if (index < 0 || static_cast<size_t>(index) >= vertexCount) {
+            throw std::runtime_error("PLY face index is out of range");
+        }
+    }
+}
+
+void importPlyAscii(BlockReader& reader, const PlyHeader& header, const PlyLayout& layout,
+                    std::vector<GLfloat>& positions, std::vector<GLfloat>& colors,
+                    BatchEmitter& emitter, unsigned threadCount, JobSystem& jobs) {
+    std::vector<size_t> elementStart(header.elements.size() + 1, 0);
+    for (size_t e = 0; e < header.elements.size(); ++e) {
+        elementStart[e + 1] = elementStart[e] + header.elements[e].count;
+    }
+    size_t vertexCount = header.elements[layout.vertexElement].count;
+    GLfloat* colorData = colors.empty() ? nullptr : colors.data();
+
+    size_t linesSeen = 0;
+    while (size_t length = takeLines(reader)) {
+        std::vector<TextRange> chunks = splitLines(reader.data(), reader.data() + length, threadCount);
+
+        // 1回目: 各チャンクの行数を数えて、チャンク先頭の行番号を決める
+        std::vector<size_t> lineCounts(chunks.size());
+        parallelFor(jobs, chunks.size(), [&](size_t c) {
+            lineCounts[c] = countNonBlankLines(chunks[c]);
+        });
+        std::vector<size_t> firstLine(chunks.size());
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            firstLine[c] = linesSeen;
+            linesSeen += lineCounts[c];
+        }
+
+        // 2回目: 頂点は行番号の位置へ直接書き込み、面はチャンクごとに集める
+        std::vector<std::vector<int64_t>> faces(chunks.size());
+        parallelFor(jobs, chunks.size(), [&](size_t c) {
+            parsePlyAsciiChunk(chunks[c], firstLine[c], header, layout, elementStart,
+                               positions.data(), colorData, faces[c]);
+            checkFaceIndices(faces[c], vertexCount);
+        });
+        reader.consume(length);
+
+        for (const std::vector<int64_t>& chunkFaces : faces) {
+            emitter.emit(chunkFaces.data(), chunkFaces.size(), positions.data(), colorData);
+        }
+    }
+    size_t needed = layout.faceElement != SIZE_MAX ? elementStart[layout.faceElement + 1] : elementStart[layout.vertexElement + 1];
+    if (linesSeen < needed) {
+        throw std::runtime_error("PLY file is truncated");
+    }
+}
+
+void importPlyBinary(BlockReader& reader, const PlyHeader& header, const PlyLayout& layout, const ImportOptions& options,
+                     std::vector<GLfloat>& positions, std::vector<GLfloat>& colors,
+                     BatchEmitter& emitter, unsigned threadCount, JobSystem& jobs) {
+    const bool bigEndian = header.format == PlyFormat::BinaryBigEndian;
+    size_t vertexCount = header.elements[layout.vertexElement].count;
+    GLfloat* colorData = colors.empty() ? nullptr : colors.data();
+
+    for (size_t e = 0; e < header.elements.size(); ++e) {
+        const PlyElement& element = header.elements[e];
+        bool fixedSize = std::none_of(element.properties.begin(), element.properties.end(),
+                                      [](const PlyProperty& property) { return property.isList; });
+
+        if (fixedSize) {
+            std::vector<size_t> offsets;
+            size_t stride = 0;
+            for (const PlyProperty& property : element.properties) {
+                offsets.push_back(stride);
+                stride += plyTypeSize(property.type);
+            }
+            const bool isVertex = e == layout.vertexElement;
+            size_t done = 0;
+            while (done < element.count && stride > 0) {
+                size_t want = std::max(stride, std::min((element.count - done) * stride, options.blockSize));
+                if (!reader.fill(stride)) {
+                    throw std::runtime_error("PLY file is truncated");
+                }
+                reader.fill(want);
+                size_t records = std::min(element.count - done, reader.available() / stride);
+                if (isVertex) {
+                    // 固定長なのでレコード単位で分割して並列にデコードする
+                    const char* base = reader.data();
+                    size_t parts = std::min<size_t>(threadCount, records / 16384 + 1);
+                    parallelFor(jobs, parts, [&](size_t part) {
+                        size_t first = records * part / parts;
+                        size_t last = records * (part + 1) / parts;
+                        for (size_t r = first; r < last; ++r) {
+                            const char* record = base + r * stride;
+                            size_t v = (done + r) * 3;
+                            for (int k = 0; k < 3; ++k) {
+                                const PlyProperty& property = element.properties[layout.position[k]];
+                                positions[v + k] = static_cast<GLfloat>(
+                                    readPlyValue(record + offsets[layout.position[k]], property.type, bigEndian));
+                            }
+                            if (colorData != nullptr) {
+                                for (int k = 0; k < 3; ++k) {
+                                    const PlyProperty& property = element.properties[layout.color[k]];
+                                    colorData[v + k] = static_cast<GLfloat>(
+                                        readPlyValue(record + offsets[layout.color[k]], property.type, bigEndian) * layout.colorScale[k]);
+                                }
+                            }
+                        }
+                    });
+                }
+                reader.consume(records * stride);
+                done += records;
+            }
+            continue;
+        }
+
+        // 可変長 (リストを含む) 要素はレコード境界が事前にわからないので逐次デコードする
+        const bool isFace = e == layout.faceElement;
+        const bool isVertex = e == layout.vertexElement;
+        std::vector<double> values(element.properties.size(), 0.0);
+        std::vector<int64_t> faces;
+        std::vector<int64_t> corners;
+        for (size_t r = 0; r < element.count; ++r) {
+            for (size_t i = 0; i < element.properties.size(); ++i) {
+                const PlyProperty& property = element.properties[i];
+                if (!property.isList) {
+                    size_t size = plyTypeSize(property.type);
+                    if (!reader.fill(size)) {
+                        throw std::runtime_error("PLY file is truncated");
+                    }
+                    values[i] = readPlyValue(reader.data(), property.type, bigEndian);
+                    reader.consume(size);
+                    continue;
+                }
+                size_t countSize = plyTypeSize(property.countType);
+                if (!reader.fill(countSize)) {
+                    throw std::runtime_error("PLY file is truncated");
+                }
+                double countValue = readPlyValue(reader.data(), property.countType, bigEndian);
+                if (countValue < 0) {
+                    throw std::runtime_error("Invalid PLY list");
+                }
+                size_t count = static_cast<size_t>(countValue);
+                reader.consume(countSize);
+                size_t itemSize = plyTypeSize(property.type);
+                if (!reader.fill(count * itemSize)) {
+                    throw std::runtime_error("PLY file is truncated");
+                }
+                if (isFace && static_cast<int>(i) == layout.faceIndices) {
+                    corners.resize(count);
+                    for (size_t k = 0; k < count; ++k) {
+                        double index = readPlyValue(reader.data() + k * itemSize, property.type, bigEndian);
+                        if (index < 0 || index >= static_cast<double>(vertexCount)) {
+                            throw std::runtime_error("PLY face index is out of range");
+                        }
+                        corners[k] = static_cast<int64_t>(index);
+                    }
+                    appendPolygon(corners.data(), corners.size(), faces);
+                }
+                reader.consume(count * itemSize);
+            }
+            // 頂点のスカラープロパティはASCIIと同じように取り出す (リストは読み飛ばす)
+            if (isVertex) {
+                size_t v = r * 3;
+                for (int k = 0; k < 3; ++k) {
+                    positions[v + k] = static_cast<GLfloat>(values[layout.position[k]]);
+                }
+                if (colorData != nullptr) {
+                    for (int k = 0; k < 3; ++k) {
+                        colorData[v + k] = static_cast<GLfloat>(values[layout.color[k]] * layout.colorScale[k]);
+                    }
+                }
+            }
+            if (faces.size() / 3 >= options.batchTriangles) {
+                emitter.emit(faces.data(), faces.size(), positions.data(), colorData);
+                faces.clear();
+            }
+        }
+        emitter.emit(faces.data(), faces.size(), positions.data(), colorData);
+    }
+}
+
+std::string lowerExtension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return std::string();
+    }
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+} // namespace
+
+void importObj(const std::string& path, const MeshBatchSink& sink, const ImportOptions& options, JobSystem& jobs) {
+    const unsigned threadCount = resolveThreadCount(options, jobs);
+    BlockReader reader(path, options.blockSize);
+    BatchEmitter emitter(sink, options, threadCount, jobs);
+
+    // 面から参照されるのでファイル全体の頂点を保持する
+    std::vector<GLfloat> positions;
+    std::vector<GLfloat> colors;
+    bool hasColors = false;
+    // まだ読んでいない頂点を参照する三角形 (後のブロックで定義される頂点への前方参照)
+    std::vector<int64_t> deferred;
+
+    while (size_t length = takeLines(reader)) {
+        std::vector<TextRange> ranges = splitLines(reader.data(), reader.data() + length, threadCount);
+        std::vector<ObjChunk> chunks(ranges.size());
+        parallelFor(jobs, ranges.size(), [&](size_t c) {
+            parseObjChunk(ranges[c], options.defaultColor, chunks[c]);
+        });
+        reader.consume(length);
+
+        // チャンクの頂点をファイル順に連結する
+        std::vector<int64_t> chunkBase(chunks.size());
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            ObjChunk& chunk = chunks[c];
+            chunkBase[c] = static_cast<int64_t>(positions.size() / 3);
+            if (!chunk.colors.empty() && !hasColors) {
+                for (size_t i = 0; i < positions.size() / 3; ++i) {
+                    colors.insert(colors.end(), options.defaultColor, options.defaultColor + 3);
+                }
+                hasColors = true;
+            }
+            if (hasColors) {
+                if (chunk.colors.empty()) {
+                    for (size_t i = 0; i < chunk.positions.size() / 3; ++i) {
+                        colors.insert(colors.end(), options.defaultColor, options.defaultColor + 3);
+                    }
+                } else {
+                    colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+                }
+            }
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            std::vector<GLfloat>().swap(chunk.positions);
+            std::vector<GLfloat>().swap(chunk.colors);
+        }
+
+        // 相対インデックスを絶対インデックスに直して範囲を検査する。
+        // まだ読んでいない頂点を参照する三角形は、ファイルを読み終えるまで取っておく
+        const int64_t vertexCount = static_cast<int64_t>(positions.size() / 3);
+        parallelFor(jobs, chunks.size(), [&](size_t c) {
+            std::vector<int64_t>& faces = chunks[c].faces;
+            size_t kept = 0;
+            for (size_t i = 0; i < faces.size(); i += 3) {
+                bool ready = true;
+                for (size_t k = i; k < i + 3; ++k) {
+                    if (faces[k] < 0) {
+                        faces[k] = chunkBase[c] + faces[k] + RELATIVE_BIAS;
+                    }
+                    if (faces[k] < 0) {
+                        throw std::runtime_error("OBJ face index is out of range");
+                    }
+                    ready = ready && faces[k] < vertexCount;
+                }
+                if (ready) {
+                    std::copy(faces.begin() + i, faces.begin() + i + 3, faces.begin() + kept);
+                    kept += 3;
+                } else {
+                    chunks[c].deferred.insert(chunks[c].deferred.end(), faces.begin() + i, faces.begin() + i + 3);
+                }
+            }
+            faces.resize(kept);
+        });
+
+        const GLfloat* colorData = hasColors ? colors.data() : nullptr;
+        for (const ObjChunk& chunk : chunks) {
+            emitter.emit(chunk.faces.data(), chunk.faces.size(), positions.data(), colorData);
+            deferred.insert(deferred.end(), chunk.deferred.begin(), chunk.deferred.end());
+        }
+    }
+
+    // 前方参照の三角形は全頂点がそろってから解決する (出力では最後に並ぶ)
+    const int64_t vertexCount = static_cast<int64_t>(positions.size() / 3);
+    for (int64_t index : deferred) {
+        if (index >= vertexCount) {
+            throw std::runtime_error("OBJ face index is out of range");
+        }
+    }
+    emitter.emit(deferred.data(), deferred.size(), positions.data(), hasColors ? colors.data() : nullptr);
+    emitter.flush();
+}
+
+void importPly(const std::string& path, const MeshBatchSink& sink, const ImportOptions& options, JobSystem& jobs) {
+    const unsigned threadCount = resolveThreadCount(options, jobs);
+    BlockReader reader(path, options.blockSize);
+    PlyHeader header = readPlyHeader(reader);
+    PlyLayout layout = analyzePlyHeader(header);
+    BatchEmitter emitter(sink, options, threadCount, jobs);
+
+    size_t vertexCount = header.elements[layout.vertexElement].count;
+    std::vector<GLfloat> positions(vertexCount * 3);
+    std::vector<GLfloat> colors;
+    if (layout.hasColors()) {
+        colors.resize(vertexCount * 3);
+    }
+
+    if (header.format == PlyFormat::Ascii) {
+        importPlyAscii(reader, header, layout, positions, colors, emitter, threadCount, jobs);
+    } else {
+        importPlyBinary(reader, header, layout, options, positions, colors, emitter, threadCount, jobs);
+    }
+    emitter.flush();
+}
+
+void importModel(const std::string& path, const MeshBatchSink& sink, const ImportOptions& options, JobSystem& jobs) {
+    std::string extension = lowerExtension(path);
+    if (extension == "obj") {
+        importObj(path, sink, options, jobs);
+    } else if (extension == "ply") {
+        importPly(path, sink, options, jobs);
+    } else {
+        throw std::runtime_error("Unsupported model format: " + path);
+    }
+}
+
+MeshBatch importModel(const std::string& path, const ImportOptions& options, JobSystem& jobs) {
+    MeshBatch result;
+    importModel(path, [&result](MeshBatch& batch) {
+        if (result.vertices.empty()) {
+            result.vertices = std::move(batch.vertices);
+            result.colors = std::move(batch.colors);
+        } else {
+            result.vertices.insert(result.vertices.end(), batch.vertices.begin(), batch.vertices.end());
+            result.colors.insert(result.colors.end(), batch.colors.begin(), batch.colors.end());
+        }
+    }, options, jobs);
+    return result;
+}
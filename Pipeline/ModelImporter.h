@@ -0,0 +1,48 @@
+#ifndef MODEL_IMPORTER_H
+#define MODEL_IMPORTER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include "Core/job_system.h"
+
+// 読み込んだ三角形の塊 (非インデックスの三角形リスト。Polygon3Dへそのまま渡せる)
+struct MeshBatch {
+    std::vector<GLfloat> vertices;
+    std::vector<GLfloat> colors;
+};
+
+struct ImportOptions {
+    // 1回に読み込むバイト数。ファイル本体のために確保するメモリはこの程度に収まる
+    size_t blockSize = size_t(32) << 20;
+    // 並列に解析するときの分割数 (0ならJobSystemの同時実行数)
+    unsigned threadCount = 0;
+    // この三角形数を超えるたびにシンクへ渡す
+    size_t batchTriangles = size_t(1) << 20;
+    // 頂点色を持たないファイルに使う色
+    GLfloat defaultColor[3] = {1.0f, 1.0f, 1.0f};
+};
+
+// バッチを受け取るコールバック。受け取ったバッチの中身はムーブしてよい
+using MeshBatchSink = std::function<void(MeshBatch& batch)>;
+
+// ファイルをブロック単位で読み、ブロック内を行境界で分割してjobsで並列に解析する。
+// 面のインデックスを解決するため頂点の位置(と色)だけは最後まで保持するが、
+// 三角形はbatchTrianglesごとにシンクへ流すので出力側のメモリは増えない。
+// OBJで後のブロックの頂点を参照する面は、ファイルを読み終えてから最後に出力する。
+// 失敗した場合はstd::runtime_errorを投げる
+void importObj(const std::string& path, const MeshBatchSink& sink, const ImportOptions& options = ImportOptions(),
+               JobSystem& jobs = JobSystem::instance());
+// ASCIIとバイナリ(リトル/ビッグエンディアン)のPLYに対応
+void importPly(const std::string& path, const MeshBatchSink& sink, const ImportOptions& options = ImportOptions(),
+               JobSystem& jobs = JobSystem::instance());
+
+// 拡張子(.obj/.ply)で形式を判定する
+void importModel(const std::string& path, const MeshBatchSink& sink, const ImportOptions& options = ImportOptions(),
+                 JobSystem& jobs = JobSystem::instance());
+// 全体を1つのバッチにまとめて返す
+MeshBatch importModel(const std::string& path, const ImportOptions& options = ImportOptions(),
+                      JobSystem& jobs = JobSystem::instance());
+
+#endif // MODEL_IMPORTER_H
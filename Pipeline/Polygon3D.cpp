@@ -1,9 +1,16 @@
 #include "Polygon3D.h"
+#include "Profiler.h"
+#include "Core/frame_arena.h"
+#include "Math/morton.h"
+#include <cmath>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 // コンストラクタ
 Polygon3D::Polygon3D(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors)
-    : vertices_(vertices), colors_(colors), vertexBufferObject(0), colorBufferObject(0) {
+    : vertices_(vertices), colors_(colors), vertexBufferObject(0), colorBufferObject(0),
+      normalBufferObject(0), normalBufferBytes_(0), indexBufferObject(0), vertexCount_(0), indexCount_(0) {
     //ポリゴンは3頂点で構成される
     if (vertices.size() % 3 != 0 || colors.size() % 3 != 0) {
         throw std::invalid_argument("Invalid vertex or color data size");
@@ -13,18 +20,45 @@ Polygon3D::Polygon3D(const std::vector<GLfloat>& vertices, const std::vector<GLf
 
 // メモリを事前に確保するコンストラクタ
 Polygon3D::Polygon3D(size_t vertexCount, size_t colorCount)
-    : vertices_(vertexCount), colors_(colorCount), vertexBufferObject(0), colorBufferObject(0) {
+    : vertices_(vertexCount), colors_(colorCount), vertexBufferObject(0), colorBufferObject(0),
+      normalBufferObject(0), normalBufferBytes_(0), indexBufferObject(0), vertexCount_(0), indexCount_(0) {
     vertices_.reserve(vertexCount);
     colors_.reserve(colorCount);
     initializeBuffers();
 }
 
+// ビューからのコンストラクタ => 中間のstd::vectorを経由せずにglBufferDataへ渡す
+Polygon3D::Polygon3D(const MeshView& view, const VertexFormat& format)
+    : format_(format), vertexBufferObject(0), colorBufferObject(0),
+      normalBufferObject(0), normalBufferBytes_(0), indexBufferObject(0), vertexCount_(0), indexCount_(0) {
+    if (view.vertexCount % 3 != 0 || view.colorCount % 3 != 0) {
+        throw std::invalid_argument("Invalid vertex or color data size");
+    }
+    uploadBuffers(view.vertices, view.vertexCount, view.colors, view.colorCount, view.bounds);
+
+    if (view.indexCount > 0) {
+        glGenBuffers(1, &indexBufferObject);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, view.indexCount * sizeof(GLuint), view.indices, GL_STATIC_DRAW);
+        GEO_PROFILE_COUNTER(BytesUploaded, view.indexCount * sizeof(GLuint));
+        indexCount_ = static_cast<GLsizei>(view.indexCount);
+    }
+}
+
 // ムーブコンストラクタ => リソースの一意性を保つために、他のオブジェクトのリソースを移動する
 Polygon3D::Polygon3D(Polygon3D&& other) noexcept
-    : vertices_(std::move(other.vertices_)), colors_(std::move(other.colors_)),
-      vertexBufferObject(other.vertexBufferObject), colorBufferObject(other.colorBufferObject) {
+    : vertices_(std::move(other.vertices_)), colors_(std::move(other.colors_)), normals_(std::move(other.normals_)),
+      format_(other.format_), dequantization_(other.dequantization_),
+      vertexBufferObject(other.vertexBufferObject), colorBufferObject(other.colorBufferObject),
+      normalBufferObject(other.normalBufferObject), normalBufferBytes_(other.normalBufferBytes_),
+      indexBufferObject(other.indexBufferObject), vertexCount_(other.vertexCount_), indexCount_(other.indexCount_) {
     other.vertexBufferObject = 0;
     other.colorBufferObject = 0;
+    other.normalBufferObject = 0;
+    other.normalBufferBytes_ = 0;
+    other.indexBufferObject = 0;
+    other.vertexCount_ = 0;
+    other.indexCount_ = 0;
 }
 
 // ムーブ代入演算子
@@ -34,12 +68,25 @@ Polygon3D& Polygon3D::operator=(Polygon3D&& other) noexcept {
 
         vertices_ = std::move(other.vertices_);
         colors_ = std::move(other.colors_);
+        normals_ = std::move(other.normals_);
+        format_ = other.format_;
+        dequantization_ = other.dequantization_;
 
         vertexBufferObject = other.vertexBufferObject;
         colorBufferObject = other.colorBufferObject;
+        normalBufferObject = other.normalBufferObject;
+        normalBufferBytes_ = other.normalBufferBytes_;
+        indexBufferObject = other.indexBufferObject;
+        vertexCount_ = other.vertexCount_;
+        indexCount_ = other.indexCount_;
 
         other.vertexBufferObject = 0;
         other.colorBufferObject = 0;
+        other.normalBufferObject = 0;
+        other.normalBufferBytes_ = 0;
+        other.indexBufferObject = 0;
+        other.vertexCount_ = 0;
+        other.indexCount_ = 0;
     }
     //ムーブ代入演算なので、いずれにせよ自分自身を返す
     return *this;
@@ -57,36 +104,242 @@ const std::vector<GLfloat>& Polygon3D::getVertices() const noexcept {
 const std::vector<GLfloat>& Polygon3D::getColors() const noexcept {
     return colors_;
 }
+const std::vector<GLfloat>& Polygon3D::getNormals() const noexcept {
+    return normals_;
+}
+size_t Polygon3D::getVertexCount() const noexcept {
+    return static_cast<size_t>(vertexCount_);
+}
 
 // ミューテータメソッド
 // こっちは例外危険性があるので、noexceptをつけない
 void Polygon3D::setVertices(const std::vector<GLfloat>& vertices) {
+    requireCpuCopy("replace vertices of");
     if (vertices.size() % 3 == 0) {
         vertices_ = vertices;
         initializeBuffers(); // バッファを再初期化
     }
 }
 void Polygon3D::setColors(const std::vector<GLfloat>& colors) {
+    requireCpuCopy("replace colors of");
     if (colors.size() % 3 == 0) {
         colors_ = colors;
         initializeBuffers(); // バッファを再初期化
     }
 }
+void Polygon3D::setMesh(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors) {
+    if (vertices.size() % 3 == 0 && colors.size() % 3 == 0) {
+        vertices_ = vertices;
+        colors_ = colors;
+        initializeBuffers(); // バッファを再初期化
+    }
+}
+// 右辺値版 => 呼び出し側のバッファをコピーせずに引き取る
+// 引き取ったデータを黙って捨てないように、大きさが合わなければ例外にする
+void Polygon3D::setVertices(std::vector<GLfloat>&& vertices) {
+    requireCpuCopy("replace vertices of");
+    if (vertices.size() % 3 != 0) {
+        throw std::invalid_argument("Invalid vertex data size");
+    }
+    vertices_ = std::move(vertices);
+    initializeBuffers();
+}
+void Polygon3D::setColors(std::vector<GLfloat>&& colors) {
+    requireCpuCopy("replace colors of");
+    if (colors.size() % 3 != 0) {
+        throw std::invalid_argument("Invalid color data size");
+    }
+    colors_ = std::move(colors);
+    initializeBuffers();
+}
+void Polygon3D::setMesh(std::vector<GLfloat>&& vertices, std::vector<GLfloat>&& colors) {
+    if (vertices.size() % 3 != 0 || colors.size() % 3 != 0) {
+        throw std::invalid_argument("Invalid vertex or color data size");
+    }
+    vertices_ = std::move(vertices);
+    colors_ = std::move(colors);
+    initializeBuffers();
+}
+
+void Polygon3D::setNormals(const std::vector<GLfloat>& normals) {
+    if (!normals.empty() && normals.size() != static_cast<size_t>(vertexCount_) * 3) {
+        throw std::invalid_argument("Normal count does not match vertex count");
+    }
+    normals_ = normals;
+    uploadNormals();
+}
+
+void Polygon3D::permuteTriangles(const std::vector<uint32_t>& order) {
+    requireCpuCopy("permute");
+    const size_t triangleCount = vertices_.size() / 9;
+    if (order.size() != triangleCount) {
+        throw std::invalid_argument("Triangle order size does not match triangle count");
+    }
+    permuteInPlace(vertices_.data(), 9, order.data(), triangleCount);
+    // 色は頂点ごとに揃っているときだけ一緒に動かす
+    if (colors_.size() == vertices_.size()) {
+        permuteInPlace(colors_.data(), 9, order.data(), triangleCount);
+    }
+    if (!normals_.empty()) {
+        permuteInPlace(normals_.data(), 9, order.data(), triangleCount);
+    }
+    initializeBuffers(); // バッファを再初期化
+}
+
+void Polygon3D::setVertexFormat(const VertexFormat& format) {
+    requireCpuCopy("re-encode");
+    format_ = format;
+    initializeBuffers(); // 新しいフォーマットで再アップロード
+}
+
+const VertexFormat& Polygon3D::getVertexFormat() const noexcept {
+    return format_;
+}
+
+const Matrix4& Polygon3D::getDequantizationMatrix() const noexcept {
+    return dequantization_;
+}
+
+// ビューから生成した (CPU側のデータを持たない) ものは、片方だけの差し替えや再エンコードができない
+void Polygon3D::requireCpuCopy(const char* action) const {
+    if (vertices_.empty() && vertexCount_ > 0) {
+        throw std::logic_error(std::string("Polygon3D created from a MeshView has no CPU copy to ") + action);
+    }
+}
 
 // バッファ初期化メソッド
 void Polygon3D::initializeBuffers() {
+    // CPU側のデータは常に非インデックスの三角形リスト
+    if (indexBufferObject != 0) {
+        glDeleteBuffers(1, &indexBufferObject);
+        indexBufferObject = 0;
+        indexCount_ = 0;
+    }
+    uploadBuffers(vertices_.data(), vertices_.size(), colors_.data(), colors_.size(), nullptr);
+    // 頂点数が変わった法線は使えないので外す
+    if (normals_.size() != vertices_.size()) {
+        normals_.clear();
+    }
+    uploadNormals();
+}
+
+void Polygon3D::uploadNormals() {
+    if (normals_.empty()) {
+        if (normalBufferObject != 0) {
+            glDeleteBuffers(1, &normalBufferObject);
+            normalBufferObject = 0;
+            normalBufferBytes_ = 0;
+        }
+        return;
+    }
+    GEO_PROFILE_SCOPE("Polygon3D::uploadNormals");
+    const size_t vertexCount = normals_.size() / 3;
+    const GLsizeiptr bytes = static_cast<GLsizeiptr>(vertexCount * format_.normalStride());
+    const bool octahedral = format_.normal == NormalFormat::Oct16 || format_.normal == NormalFormat::Oct8;
+    ArenaScope scratch;
+    const GLfloat* source = normals_.data();
+    // 量子化した位置は逆量子化行列 (軸ごとの拡大と平行移動) をモデルビュー行列に掛けて描くので、
+    // 固定機能パイプラインが掛ける逆転置行列を打ち消すように、法線に拡大率を掛けておく (長さはGL_NORMALIZEで戻す)。
+    // 整数に詰めても向きが潰れないように、掛けた後で単位長にしておく
+    std::pmr::vector<GLfloat> scaled(&scratch.arena());
+    if (format_.position != PositionFormat::Float32 && !octahedral) {
+        scaled.resize(normals_.size());
+        for (size_t i = 0; i < normals_.size(); i += 3) {
+            GLfloat n[3];
+            for (int k = 0; k < 3; ++k) {
+                n[k] = normals_[i + k] * dequantization_.m[k][k];
+            }
+            const GLfloat length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            const GLfloat inverse = length > 0.0f ? 1.0f / length : 0.0f;
+            for (int k = 0; k < 3; ++k) {
+                scaled[i + k] = n[k] * inverse;
+            }
+        }
+        source = scaled.data();
+    }
+    const void* data = source;
+    // GLshortの配列として確保し、Oct8はバイト列として書く
+    std::pmr::vector<GLshort> packed(&scratch.arena());
+    if (format_.normal != NormalFormat::Float32) {
+        packed.resize((static_cast<size_t>(bytes) + 1) / sizeof(GLshort));
+        switch (format_.normal) {
+        case NormalFormat::Snorm16: encodeNormalsSnorm16(source, normals_.size(), packed.data()); break;
+        case NormalFormat::Oct16:   encodeNormalsOct16(source, normals_.size(), packed.data()); break;
+        default:                    encodeNormalsOct8(source, normals_.size(), reinterpret_cast<GLbyte*>(packed.data())); break;
+        }
+        data = packed.data();
+    }
+    if (normalBufferObject == 0) {
+        glGenBuffers(1, &normalBufferObject);
+        glBindBuffer(GL_ARRAY_BUFFER, normalBufferObject);
+        // 変形するメッシュでは毎フレーム書き換えるのでDYNAMIC
+        glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, normalBufferObject);
+        if (normalBufferBytes_ == bytes) {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+        }
+    }
+    normalBufferBytes_ = bytes;
+    GEO_PROFILE_COUNTER(BytesUploaded, bytes);
+}
+
+// CPU側はfloatのまま保持し、アップロード時にformat_へエンコードする
+void Polygon3D::uploadBuffers(const GLfloat* vertices, size_t vertexCount,
+                              const GLfloat* colors, size_t colorCount,
+                              const QuantizationBounds* bounds) {
+    GEO_PROFILE_SCOPE("Polygon3D::uploadBuffers");
     if (vertexBufferObject == 0) {
         glGenBuffers(1, &vertexBufferObject);
     }
-    if (colorBufferObject == 0) {
+    // 色は頂点と同じ数がそろっているときだけ使う (足りない色の配列をGLに読ませない)
+    const bool hasColors = colors != nullptr && colorCount == vertexCount;
+    if (!hasColors && colorBufferObject != 0) {
+        glDeleteBuffers(1, &colorBufferObject);
+        colorBufferObject = 0;
+    }
+    if (hasColors && colorBufferObject == 0) {
         glGenBuffers(1, &colorBufferObject);
     }
 
+    vertexCount_ = static_cast<GLsizei>(vertexCount / 3);
+    // エンコード用の作業領域はこのスレッドのアリーナから取り、関数を抜けたら返す
+    ArenaScope scratch;
+
     glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(GLfloat), vertices_.data(), GL_STATIC_DRAW);
+    if (format_.position == PositionFormat::Float32) {
+        dequantization_ = Matrix4();
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
+        GEO_PROFILE_COUNTER(BytesUploaded, vertexCount * sizeof(GLfloat));
+    } else {
+        QuantizationBounds quantBounds = bounds ? *bounds : computeQuantizationBounds(vertices, vertexCount);
+        dequantization_ = dequantizationMatrix(quantBounds, format_.position);
+        // GLshortとGLushortは同じサイズなので、同じ作業領域を使う
+        std::pmr::vector<GLshort> packed(vertexCount, &scratch.arena());
+        if (format_.position == PositionFormat::Snorm16) {
+            encodePositionsSnorm16(vertices, vertexCount, quantBounds, packed.data());
+        } else {
+            encodePositionsHalf(vertices, vertexCount, quantBounds, reinterpret_cast<GLushort*>(packed.data()));
+        }
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(GLshort), packed.data(), GL_STATIC_DRAW);
+        GEO_PROFILE_COUNTER(BytesUploaded, packed.size() * sizeof(GLshort));
+    }
 
+    if (!hasColors) {
+        return;
+    }
     glBindBuffer(GL_ARRAY_BUFFER, colorBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, colors_.size() * sizeof(GLfloat), colors_.data(), GL_STATIC_DRAW);
+    if (format_.color == ColorFormat::Float32) {
+        glBufferData(GL_ARRAY_BUFFER, colorCount * sizeof(GLfloat), colors, GL_STATIC_DRAW);
+        GEO_PROFILE_COUNTER(BytesUploaded, colorCount * sizeof(GLfloat));
+    } else {
+        std::pmr::vector<GLubyte> packed(colorCount / 3 * 4, &scratch.arena());
+        encodeColorsUnorm8(colors, colorCount, packed.data());
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(GLubyte), packed.data(), GL_STATIC_DRAW);
+        GEO_PROFILE_COUNTER(BytesUploaded, packed.size() * sizeof(GLubyte));
+    }
 }
 
 // バッファクリーンアップメソッド
@@ -99,35 +352,123 @@ void Polygon3D::cleanupBuffers() {
         glDeleteBuffers(1, &colorBufferObject);
         colorBufferObject = 0;
     }
+    if (normalBufferObject != 0) {
+        glDeleteBuffers(1, &normalBufferObject);
+        normalBufferObject = 0;
+        normalBufferBytes_ = 0;
+    }
+    if (indexBufferObject != 0) {
+        glDeleteBuffers(1, &indexBufferObject);
+        indexBufferObject = 0;
+    }
+    indexCount_ = 0;
 }
 
 // 描画メソッド
 void Polygon3D::draw() const {
+    GEO_PROFILE_GPU_SCOPE("Polygon3D::draw");
+    const bool quantized = format_.position != PositionFormat::Float32;
+    if (quantized) {
+        // 逆量子化行列をモデルビュー行列に掛ける (OpenGLは列優先なので転置して渡す)
+        GLfloat columnMajor[16];
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                columnMajor[j * 4 + i] = dequantization_.m[i][j];
+            }
+        }
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glMultMatrixf(columnMajor);
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
     glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+    switch (format_.position) {
+    case PositionFormat::Snorm16: glVertexPointer(3, GL_SHORT, 0, nullptr); break;
+    case PositionFormat::Half16:  glVertexPointer(3, GL_HALF_FLOAT, 0, nullptr); break;
+    default:                      glVertexPointer(3, GL_FLOAT, 0, nullptr); break;
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, colorBufferObject);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glColorPointer(3, GL_FLOAT, 0, nullptr);
+    // 色が無ければ配列を使わず、現在のglColorで描く
+    const bool hasColors = colorBufferObject != 0;
+    if (hasColors) {
+        glBindBuffer(GL_ARRAY_BUFFER, colorBufferObject);
+        glEnableClientState(GL_COLOR_ARRAY);
+        if (format_.color == ColorFormat::Unorm8) {
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, nullptr);
+        } else {
+            glColorPointer(3, GL_FLOAT, 0, nullptr);
+        }
+    }
 
-    glDrawArrays(GL_TRIANGLES, 0, vertices_.size() / 3);
+    const bool hasNormals = normalBufferObject != 0;
+    // 八面体エンコードは固定機能では読めないので、シェーダ向けに汎用頂点属性として渡す
+    const bool octahedral = format_.normal == NormalFormat::Oct16 || format_.normal == NormalFormat::Oct8;
+    if (hasNormals) {
+        glBindBuffer(GL_ARRAY_BUFFER, normalBufferObject);
+        switch (format_.normal) {
+        case NormalFormat::Snorm16:
+            glEnableClientState(GL_NORMAL_ARRAY);
+            glNormalPointer(GL_SHORT, 0, nullptr);
+            break;
+        case NormalFormat::Oct16:
+            glEnableVertexAttribArray(OCTAHEDRAL_NORMAL_ATTRIBUTE);
+            glVertexAttribPointer(OCTAHEDRAL_NORMAL_ATTRIBUTE, 2, GL_SHORT, GL_TRUE, 0, nullptr);
+            break;
+        case NormalFormat::Oct8:
+            glEnableVertexAttribArray(OCTAHEDRAL_NORMAL_ATTRIBUTE);
+            glVertexAttribPointer(OCTAHEDRAL_NORMAL_ATTRIBUTE, 2, GL_BYTE, GL_TRUE, 0, nullptr);
+            break;
+        default:
+            glEnableClientState(GL_NORMAL_ARRAY);
+            glNormalPointer(GL_FLOAT, 0, nullptr);
+            break;
+        }
+    }
+    // 量子化した位置の法線は拡大率を掛けて送っているので、GL_NORMALIZEで長さを1に戻す。
+    // glIsEnabledで毎回問い合わせるとドライバとの同期が起きうるので、有効にしたまま戻さない
+    // (単位長の法線には結果が変わらない)
+    if (hasNormals && quantized && !octahedral) {
+        glEnable(GL_NORMALIZE);
+    }
+
+    if (indexCount_ > 0) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject);
+        glDrawElements(GL_TRIANGLES, indexCount_, GL_UNSIGNED_INT, nullptr);
+        GEO_PROFILE_COUNTER(Triangles, indexCount_ / 3);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, vertexCount_);
+        GEO_PROFILE_COUNTER(Triangles, vertexCount_ / 3);
+    }
+    GEO_PROFILE_COUNTER(DrawCalls, 1);
 
     glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
+    if (hasColors) {
+        glDisableClientState(GL_COLOR_ARRAY);
+    }
+    if (hasNormals && octahedral) {
+        glDisableVertexAttribArray(OCTAHEDRAL_NORMAL_ATTRIBUTE);
+    } else if (hasNormals) {
+        glDisableClientState(GL_NORMAL_ARRAY);
+    }
+
+    if (quantized) {
+        glPopMatrix();
+    }
 }
 
-void Cube::draw() const {
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+// Cube
+Cube::Cube(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors)
+    : Polygon3D(vertices, colors) {}
 
-    glBindBuffer(GL_ARRAY_BUFFER, colorBufferObject);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glColorPointer(3, GL_FLOAT, 0, nullptr);
+Cube::Cube(size_t vertexCount, size_t colorCount)
+    : Polygon3D(vertexCount, colorCount) {}
 
-    glDrawArrays(GL_TRIANGLES, 0, vertices_.size() / 3);
+Cube::Cube(Cube&& other) noexcept : Polygon3D(std::move(other)) {}
 
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
-}
\ No newline at end of file
+Cube& Cube::operator=(Cube&& other) noexcept {
+    Polygon3D::operator=(std::move(other));
+    return *this;
+}
+
+Cube::~Cube() = default;
@@ -1,36 +1,107 @@
 #ifndef POLYGON3D_H
 #define POLYGON3D_H
 
+#include <cstdint>
 #include <vector>
 #include <GL/glew.h>
+#include "Math/vector_space.h"
+#include "VertexFormat.h"
+
+// 外部メモリ上のメッシュデータを指す所有権のないビュー
+// (メモリマップしたファイルなど。Polygon3Dはコピーせずに直接アップロードする)
+struct MeshView {
+    const GLfloat* vertices = nullptr;
+    size_t vertexCount = 0;   // float要素数 (3の倍数)
+    const GLfloat* colors = nullptr;
+    size_t colorCount = 0;    // float要素数 (vertexCountと同じ。違えば色は使わない)
+    const GLuint* indices = nullptr;
+    size_t indexCount = 0;    // 0なら非インデックス描画
+    // 量子化用のバウンディングボックス (無ければアップロード時に計算する)
+    const QuantizationBounds* bounds = nullptr;
+};
 
 class Polygon3D {
 public:
     Polygon3D(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors);
     Polygon3D(size_t vertexCount, size_t colorCount); // メモリを事前に確保するコンストラクタ
+    // ビューから直接GPUへアップロードするコンストラクタ (CPU側にコピーを持たない)
+    explicit Polygon3D(const MeshView& view, const VertexFormat& format = VertexFormat());
     Polygon3D(Polygon3D&& other) noexcept;            // ムーブコンストラクタ
 
     Polygon3D& operator=(Polygon3D&& other) noexcept; // ムーブ代入演算子
-    ~Polygon3D();
+    virtual ~Polygon3D();
 
     // メソッド
-    void draw() const;
+    virtual void draw() const;
 
+    // ビューから生成した場合は空を返す
     const std::vector<GLfloat>& getVertices() const noexcept;
     const std::vector<GLfloat>& getColors() const noexcept;
+    // 法線 (頂点ごとのxyz、無ければ空)
+    const std::vector<GLfloat>& getNormals() const noexcept;
+    // 描画する頂点数 (ビューから生成した場合も含む)
+    size_t getVertexCount() const noexcept;
+    // 頂点か色の片方だけを差し替える。CPU側のデータを持たない場合はstd::logic_errorを投げる
+    // 色は頂点と同じ数のときだけ描画に使い、足りなければ色の配列を使わずに現在のglColorで描く
     void setVertices(const std::vector<GLfloat>& vertices);
     void setColors(const std::vector<GLfloat>& colors);
+    // 頂点と色を両方差し替える (アップロードは1回で済む)
+    // ビューから生成した場合もメッシュ全体を置き換え、インデックスと法線は外れる
+    void setMesh(const std::vector<GLfloat>& vertices, const std::vector<GLfloat>& colors);
+    // 右辺値版はコピーせずにバッファを引き取る (サイズが3の倍数でなければstd::invalid_argumentを投げ、引数はそのまま残る)
+    void setVertices(std::vector<GLfloat>&& vertices);
+    void setColors(std::vector<GLfloat>&& colors);
+    void setMesh(std::vector<GLfloat>&& vertices, std::vector<GLfloat>&& colors);
+    // 法線ストリームを設定する (空なら外す)。法線のバッファだけを再アップロードし、頂点数が同じなら領域を使い回す
+    // 法線はformat_.normalでエンコードして送る。Float32とSnorm16は固定機能の法線配列に、Oct16とOct8は
+    // 汎用頂点属性OCTAHEDRAL_NORMAL_ATTRIBUTEに渡す (シェーダでdecodeOctahedralと同じ計算をして戻す)。
+    // 量子化した位置を固定機能の法線で描くときはGL_NORMALIZEを有効にする (問い合わせを避けるため、戻さない)。
+    // 長さが頂点と合わなければstd::invalid_argumentを投げる
+    void setNormals(const std::vector<GLfloat>& normals);
+    // 三角形の並びを変える (新しいi番目の三角形は元のorder[i]番目)。頂点・色・法線をその場で並べ替えて再アップロードする
+    // orderが三角形の置換でなければ (長さ・範囲外・重複) std::invalid_argument、CPU側のデータを持たない場合はstd::logic_errorを投げる
+    void permuteTriangles(const std::vector<uint32_t>& order);
+
+    // GPUへアップロードする頂点フォーマットを変更する (バッファを再アップロード)
+    // CPU側のデータを持たない場合はstd::logic_errorを投げる
+    void setVertexFormat(const VertexFormat& format);
+    const VertexFormat& getVertexFormat() const noexcept;
+    // 量子化された位置を元に戻す行列 (Float32のときは単位行列)
+    const Matrix4& getDequantizationMatrix() const noexcept;
     
-private:
+protected:
     std::vector<GLfloat> vertices_;
     std::vector<GLfloat> colors_;
+    std::vector<GLfloat> normals_;
+    // アップロード時の頂点フォーマット
+    VertexFormat format_;
+    // 位置の逆量子化行列
+    Matrix4 dequantization_;
     // 頂点バッファオブジェクトのID
     GLuint vertexBufferObject;
-    // 色バッファオブジェクトのID
+    // 色バッファオブジェクトのID (頂点と同じ数の色が無ければ0)
     GLuint colorBufferObject;       
+    // 法線バッファオブジェクトのID (法線が無ければ0)
+    GLuint normalBufferObject;
+    // 法線バッファの確保済みバイト数 (同じ大きさなら領域を使い回す。GLに問い合わせると同期が起きるので覚えておく)
+    GLsizeiptr normalBufferBytes_;
+    // インデックスバッファオブジェクトのID (非インデックス描画なら0)
+    GLuint indexBufferObject;
+    // 描画する頂点数とインデックス数
+    GLsizei vertexCount_;
+    GLsizei indexCount_;
 
+private:
     // バッファの初期化
     void initializeBuffers(); 
+    // 指定したメモリからバッファへアップロードする
+    void uploadBuffers(const GLfloat* vertices, size_t vertexCount,
+                       const GLfloat* colors, size_t colorCount,
+                       const QuantizationBounds* bounds);
+    // 法線をアップロードする (normals_が空ならバッファを消す)
+    void uploadNormals();
+    // CPU側のデータを持たなければstd::logic_errorを投げる
+    void requireCpuCopy(const char* action) const;
     // バッファのクリーンアップ
     void cleanupBuffers();    
 };
@@ -43,9 +114,7 @@ public:
 
     Cube& operator=(Cube&& other) noexcept;      // ムーブ代入演算子
     ~Cube();
-
-    // メソッド
-    void draw() const override;
+    // 描画はPolygon3D::drawをそのまま使う (頂点フォーマット・インデックス・法線も同じ扱いにする)
 };
 
 #endif // POLYGON3D_H
@@ -0,0 +1,365 @@
+#include "PrimitiveStage.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // 1チャンクの三角形数
+    const size_t CHUNK_TRIANGLES = 4096;
+
+    // アウトコードのビット (頂点がその平面の外側にある)
+    enum : unsigned {
+        OUT_LEFT = 1 << 0,
+        OUT_RIGHT = 1 << 1,
+        OUT_BOTTOM = 1 << 2,
+        OUT_TOP = 1 << 3,
+        OUT_NEAR = 1 << 4,
+        OUT_FAR = 1 << 5,
+        OUT_GUARD_LEFT = 1 << 6,
+        OUT_GUARD_RIGHT = 1 << 7,
+        OUT_GUARD_BOTTOM = 1 << 8,
+        OUT_GUARD_TOP = 1 << 9,
+    };
+    // 3頂点とも同じ平面の外なら見えない
+    const unsigned FRUSTUM_BITS = OUT_LEFT | OUT_RIGHT | OUT_BOTTOM | OUT_TOP | OUT_NEAR | OUT_FAR;
+    // どれか1頂点でも外なら切る必要がある
+    const unsigned CLIP_BITS = OUT_NEAR | OUT_FAR | OUT_GUARD_LEFT | OUT_GUARD_RIGHT | OUT_GUARD_BOTTOM | OUT_GUARD_TOP;
+
+    // 切るときに補間する頂点 (クリップ座標、オブジェクト空間の位置、色)
+    struct ClipVertex {
+        float clip[4];
+        float position[3];
+        float color[3];
+    };
+
+    // ニア・ファー2平面 + ガードバンド4平面で切ると、三角形は最大9角形 (3 + 6) になる
+    const int MAX_POLYGON = 9;
+
+    // 平面の内側ほど大きい符号付き距離 (0以上が内側)
+    float planeDistance(unsigned plane, const float c[4], float guardBand) {
+        switch (plane) {
+        case OUT_NEAR: return c[2] + c[3];
+        case OUT_FAR: return c[3] - c[2];
+        case OUT_GUARD_LEFT: return guardBand * c[3] + c[0];
+        case OUT_GUARD_RIGHT: return guardBand * c[3] - c[0];
+        case OUT_GUARD_BOTTOM: return guardBand * c[3] + c[1];
+        default: return guardBand * c[3] - c[1];
+        }
+    }
+
+    ClipVertex interpolate(const ClipVertex& a, const ClipVertex& b, float t) {
+        ClipVertex v;
+        for (int k = 0; k < 4; ++k) {
+            v.clip[k] = a.clip[k] + (b.clip[k] - a.clip[k]) * t;
+        }
+        // オブジェクト空間からクリップ空間へはアフィン変換なので、同じtで補間すればよい
+        for (int k = 0; k < 3; ++k) {
+            v.position[k] = a.position[k] + (b.position[k] - a.position[k]) * t;
+            v.color[k] = a.color[k] + (b.color[k] - a.color[k]) * t;
+        }
+        return v;
+    }
+
+    // Sutherland–Hodgman法で1平面について切る。結果の頂点数を返す
+    int clipPolygon(unsigned plane, float guardBand, const ClipVertex* in, int count, ClipVertex* out) {
+        int written = 0;
+        for (int i = 0; i < count; ++i) {
+            const ClipVertex& current = in[i];
+            const ClipVertex& next = in[(i + 1) % count];
+            const float dc = planeDistance(plane, current.clip, guardBand);
+            const float dn = planeDistance(plane, next.clip, guardBand);
+            if (dc >= 0) {
+                out[written++] = current;
+            }
+            if ((dc >= 0) != (dn >= 0)) {
+                out[written++] = interpolate(current, next, dc / (dc - dn));
+            }
+        }
+        return written;
+    }
+
+    // 同次座標のまま三角形の向きを求める: det[x y w] = w0 w1 w2 * (NDCでの面積の2倍)
+    float homogeneousArea(const float* a, const float* b, const float* c) {
+        return a[0] * (b[1] * c[3] - c[1] * b[3]) -
+               b[0] * (a[1] * c[3] - c[1] * a[3]) +
+               c[0] * (a[1] * b[3] - b[1] * a[3]);
+    }
+
+    enum class Facing { Front, Back, Degenerate };
+
+    Facing classify(const float* a, const float* b, const float* c, const PrimitiveStageOptions& options) {
+        if (!(a[3] > 0 && b[3] > 0 && c[3] > 0)) {
+            return Facing::Degenerate;
+        }
+        const float area = homogeneousArea(a, b, c);
+        const float scale = a[3] * b[3] * c[3];
+        if (area == 0 || (options.minimumArea > 0 && std::fabs(area) <= options.minimumArea * scale)) {
+            return Facing::Degenerate;
+        }
+        return area > 0 ? Facing::Front : Facing::Back;
+    }
+
+    // チャンクの出力への書き込み。配列はフレームをまたいで使い回して大きくするだけにし、
+    // 頂点はinsertで伸ばさずに確保済みの位置へ直接書く (書いた数はcountで持つ)
+    struct BatchWriter {
+        PrimitiveBatch& batch;
+        bool hasColors;
+        size_t count;     // 書き込んだ頂点数
+        size_t capacity;  // 配列に入る頂点数
+
+        BatchWriter(PrimitiveBatch& batch, bool hasColors) : batch(batch), hasColors(hasColors), count(0) {
+            capacity = std::min(batch.positions.size() / 3, batch.clipPositions.size() / 4);
+            if (hasColors) {
+                capacity = std::min(capacity, batch.colors.size() / 3);
+            }
+        }
+
+        // あとvertices個の頂点を書けるようにする
+        void ensure(size_t vertices) {
+            if (count + vertices <= capacity) {
+                return;
+            }
+            capacity = std::max(count + vertices, capacity * 2);
+            batch.positions.resize(capacity * 3);
+            batch.clipPositions.resize(capacity * 4);
+            if (hasColors) {
+                batch.colors.resize(capacity * 3);
+            }
+        }
+
+        void emit(const float* clip, const float* position, const float* color) {
+            std::copy(clip, clip + 4, batch.clipPositions.data() + count * 4);
+            std::copy(position, position + 3, batch.positions.data() + count * 3);
+            if (hasColors) {
+                std::copy(color, color + 3, batch.colors.data() + count * 3);
+            }
+            ++count;
+        }
+    };
+}
+
+void PrimitiveBatch::clear() {
+    positions.clear();
+    colors.clear();
+    clipPositions.clear();
+}
+
+PrimitiveStage::PrimitiveStage(const PrimitiveStageOptions& options) : options_(options) {}
+
+void PrimitiveStage::process(const Polygon3D& polygon, const Matrix4& modelViewProjection, PrimitiveBatch& out,
+                             JobSystem& jobs) {
+    const std::vector<GLfloat>& vertices = polygon.getVertices();
+    const std::vector<GLfloat>& colors = polygon.getColors();
+    process(vertices.data(), colors.size() == vertices.size() ? colors.data() : nullptr, vertices.size(),
+            modelViewProjection, out, jobs);
+}
+
+void PrimitiveStage::process(const GLfloat* vertices, const GLfloat* colors, size_t vertexCount,
+                             const Matrix4& modelViewProjection, PrimitiveBatch& out, JobSystem& jobs) {
+    GEO_PROFILE_SCOPE("PrimitiveStage::process");
+    const size_t triangleCount = vertexCount / 9;
+    const size_t chunkCount = (triangleCount + CHUNK_TRIANGLES - 1) / CHUNK_TRIANGLES;
+    if (chunks_.size() < chunkCount) {
+        chunks_.resize(chunkCount);
+    }
+
+    jobs.parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            const size_t first = c * CHUNK_TRIANGLES;
+            processChunk(chunks_[c], vertices, colors, first,
+                         std::min(CHUNK_TRIANGLES, triangleCount - first), modelViewProjection);
+        }
+    });
+
+    // チャンクの出力を入力の順につなぐ
+    out.clear();
+    stats_ = PrimitiveStats();
+    size_t outputTriangles = 0;
+    for (size_t c = 0; c < chunkCount; ++c) {
+        const PrimitiveStats& s = chunks_[c].stats;
+        stats_.input += s.input;
+        stats_.outside += s.outside;
+        stats_.backFacing += s.backFacing;
+        stats_.degenerate += s.degenerate;
+        stats_.clipped += s.clipped;
+        outputTriangles += s.output;
+    }
+    stats_.output = outputTriangles;
+    out.positions.reserve(outputTriangles * 9);
+    out.clipPositions.reserve(outputTriangles * 12);
+    if (colors) {
+        out.colors.reserve(outputTriangles * 9);
+    }
+    for (size_t c = 0; c < chunkCount; ++c) {
+        // チャンクの配列は前のフレームの分だけ長いことがあるので、書いた頂点数だけ写す
+        const PrimitiveBatch& batch = chunks_[c].batch;
+        const size_t count = chunks_[c].vertexCount;
+        out.positions.insert(out.positions.end(), batch.positions.begin(), batch.positions.begin() + count * 3);
+        if (colors) {
+            out.colors.insert(out.colors.end(), batch.colors.begin(), batch.colors.begin() + count * 3);
+        }
+        out.clipPositions.insert(out.clipPositions.end(), batch.clipPositions.begin(),
+                                 batch.clipPositions.begin() + count * 4);
+    }
+}
+
+void PrimitiveStage::processChunk(Chunk& chunk, const GLfloat* vertices, const GLfloat* colors,
+                                  size_t firstTriangle, size_t triangleCount, const Matrix4& mvp) const {
+    const size_t vertexCount = triangleCount * 3;
+    const GLfloat* source = vertices + firstTriangle * 9;
+    chunk.x.resize(vertexCount);
+    chunk.y.resize(vertexCount);
+    chunk.z.resize(vertexCount);
+    chunk.w.resize(vertexCount);
+    chunk.outcodes.resize(vertexCount);
+    chunk.stats = PrimitiveStats();
+    chunk.stats.input = triangleCount;
+
+    // クリップ空間への変換 (SoAに書き出す。行列の要素はローカルに取り出しておく)
+    const float m00 = mvp.m[0][0], m01 = mvp.m[0][1], m02 = mvp.m[0][2], m03 = mvp.m[0][3];
+    const float m10 = mvp.m[1][0], m11 = mvp.m[1][1], m12 = mvp.m[1][2], m13 = mvp.m[1][3];
+    const float m20 = mvp.m[2][0], m21 = mvp.m[2][1], m22 = mvp.m[2][2], m23 = mvp.m[2][3];
+    const float m30 = mvp.m[3][0], m31 = mvp.m[3][1], m32 = mvp.m[3][2], m33 = mvp.m[3][3];
+    float* cx = chunk.x.data();
+    float* cy = chunk.y.data();
+    float* cz = chunk.z.data();
+    float* cw = chunk.w.data();
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float px = source[i * 3], py = source[i * 3 + 1], pz = source[i * 3 + 2];
+        cx[i] = m00 * px + m01 * py + m02 * pz + m03;
+        cy[i] = m10 * px + m11 * py + m12 * pz + m13;
+        cz[i] = m20 * px + m21 * py + m22 * pz + m23;
+        cw[i] = m30 * px + m31 * py + m32 * pz + m33;
+    }
+
+    // アウトコード (分岐のない比較だけなので、これもベクトル化される)
+    const float guard = options_.guardBand;
+    unsigned* codes = chunk.outcodes.data();
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float x = cx[i], y = cy[i], z = cz[i], w = cw[i];
+        const float gw = guard * w;
+        codes[i] = (x < -w ? OUT_LEFT : 0u) | (x > w ? OUT_RIGHT : 0u) |
+                   (y < -w ? OUT_BOTTOM : 0u) | (y > w ? OUT_TOP : 0u) |
+                   (z < -w ? OUT_NEAR : 0u) | (z > w ? OUT_FAR : 0u) |
+                   (x < -gw ? OUT_GUARD_LEFT : 0u) | (x > gw ? OUT_GUARD_RIGHT : 0u) |
+                   (y < -gw ? OUT_GUARD_BOTTOM : 0u) | (y > gw ? OUT_GUARD_TOP : 0u);
+    }
+
+    const bool hasColors = colors != nullptr;
+    const GLfloat* sourceColors = hasColors ? colors + firstTriangle * 9 : nullptr;
+    const float white[3] = {1.0f, 1.0f, 1.0f};
+    PrimitiveStats& stats = chunk.stats;
+    // 切らない三角形はそのまま3頂点になるので、まずその分を確保しておく
+    BatchWriter writer(chunk.batch, hasColors);
+    writer.ensure(vertexCount);
+
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const size_t i0 = t * 3, i1 = i0 + 1, i2 = i0 + 2;
+        const unsigned c0 = codes[i0], c1 = codes[i1], c2 = codes[i2];
+        if (c0 & c1 & c2 & FRUSTUM_BITS) {
+            ++stats.outside;
+            continue;
+        }
+
+        if (((c0 | c1 | c2) & CLIP_BITS) == 0) {
+            // 切らずに済む三角形
+            const float a[4] = {cx[i0], cy[i0], cz[i0], cw[i0]};
+            const float b[4] = {cx[i1], cy[i1], cz[i1], cw[i1]};
+            const float c[4] = {cx[i2], cy[i2], cz[i2], cw[i2]};
+            const Facing facing = classify(a, b, c, options_);
+            if (facing == Facing::Degenerate) {
+                ++stats.degenerate;
+                continue;
+            }
+            if (facing == Facing::Back && options_.cullBackFaces) {
+                ++stats.backFacing;
+                continue;
+            }
+            const float* corners[3] = {a, b, c};
+            for (int k = 0; k < 3; ++k) {
+                writer.emit(corners[k], &source[(i0 + k) * 3], hasColors ? &sourceColors[(i0 + k) * 3] : white);
+            }
+            ++stats.output;
+            continue;
+        }
+
+        // ニア・ファー面かガードバンドをまたぐので、またいでいる平面だけで切る
+        ClipVertex buffers[2][MAX_POLYGON];
+        for (int k = 0; k < 3; ++k) {
+            const size_t i = i0 + k;
+            ClipVertex& v = buffers[0][k];
+            v.clip[0] = cx[i];
+            v.clip[1] = cy[i];
+            v.clip[2] = cz[i];
+            v.clip[3] = cw[i];
+            for (int j = 0; j < 3; ++j) {
+                v.position[j] = source[i * 3 + j];
+                v.color[j] = hasColors ? sourceColors[i * 3 + j] : 1.0f;
+            }
+        }
+        int count = 3;
+        int current = 0;
+        const unsigned crossing = (c0 | c1 | c2) & CLIP_BITS;
+        for (unsigned plane = OUT_NEAR; plane <= OUT_GUARD_TOP && count > 0; plane <<= 1) {
+            if (crossing & plane) {
+                count = clipPolygon(plane, guard, buffers[current], count, buffers[1 - current]);
+                current = 1 - current;
+            }
+        }
+        if (count < 3) {
+            ++stats.outside;
+            continue;
+        }
+
+        // 切った多角形は平面上の凸多角形なので、扇形に分けた三角形はどれも同じ向きになる
+        const ClipVertex* polygon = buffers[current];
+        Facing facing = Facing::Degenerate;
+        for (int k = 1; k + 1 < count && facing == Facing::Degenerate; ++k) {
+            facing = classify(polygon[0].clip, polygon[k].clip, polygon[k + 1].clip, options_);
+        }
+        if (facing == Facing::Degenerate) {
+            ++stats.degenerate;
+            continue;
+        }
+        if (facing == Facing::Back && options_.cullBackFaces) {
+            ++stats.backFacing;
+            continue;
+        }
+        ++stats.clipped;
+        // 1つの三角形が最大count - 2個になり、先に確保した3頂点を超えることがある
+        writer.ensure((count - 2) * 3);
+        for (int k = 1; k + 1 < count; ++k) {
+            if (classify(polygon[0].clip, polygon[k].clip, polygon[k + 1].clip, options_) == Facing::Degenerate) {
+                continue;
+            }
+            for (int corner : {0, k, k + 1}) {
+                writer.emit(polygon[corner].clip, polygon[corner].position, polygon[corner].color);
+            }
+            ++stats.output;
+        }
+    }
+    chunk.vertexCount = writer.count;
+}
+
+void PrimitiveStage::submit(const PrimitiveBatch& batch) {
+    GEO_PROFILE_GPU_SCOPE("PrimitiveStage::submit");
+    if (batch.positions.empty()) {
+        return;
+    }
+    // クライアント側の配列を使うので、バッファの割り当てを外しておく
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, batch.positions.data());
+    const bool hasColors = batch.colors.size() == batch.positions.size();
+    if (hasColors) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(3, GL_FLOAT, 0, batch.colors.data());
+    }
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(batch.positions.size() / 3));
+    GEO_PROFILE_COUNTER(Triangles, batch.triangleCount());
+    GEO_PROFILE_COUNTER(DrawCalls, 1);
+    if (hasColors) {
+        glDisableClientState(GL_COLOR_ARRAY);
+    }
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
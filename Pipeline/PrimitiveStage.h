@@ -0,0 +1,92 @@
+#ifndef PRIMITIVE_STAGE_H
+#define PRIMITIVE_STAGE_H
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+#include "Math/vector_space.h"
+#include "Core/job_system.h"
+#include "Polygon3D.h"
+
+struct PrimitiveStageOptions {
+    // 裏向きの三角形を捨てる (表は反時計回り、glFrontFace(GL_CCW)と同じ)
+    bool cullBackFaces = true;
+    // x, yはこの倍率のガードバンド (|x|, |y| <= guardBand * w) を超えたときだけ切る
+    // それより内側で画面からはみ出す分はラスタライザのシザーに任せる
+    float guardBand = 8.0f;
+    // NDCでの面積の2倍がこれ以下の三角形は縮退として捨てる (0なら面積がちょうど0のものだけ)
+    float minimumArea = 0.0f;
+};
+
+// 直前のprocessの内訳 (三角形の数)
+struct PrimitiveStats {
+    size_t input = 0;
+    size_t outside = 0;      // 視錐台の外
+    size_t backFacing = 0;
+    size_t degenerate = 0;
+    size_t clipped = 0;      // ニア・ファー・ガードバンドで切った入力三角形
+    size_t output = 0;       // 出力した三角形 (切った結果、1つから複数になることもある)
+};
+
+// 出力の三角形リスト
+struct PrimitiveBatch {
+    // オブジェクト空間のxyz (Polygon3Dと同じ形。MVPはGL側で掛ける)
+    std::vector<GLfloat> positions;
+    // rgb (入力に色が無ければ空)
+    std::vector<GLfloat> colors;
+    // クリップ空間のxyzw (CPUでラスタライズするとき用)
+    std::vector<GLfloat> clipPositions;
+
+    size_t triangleCount() const noexcept { return positions.size() / 9; }
+    void clear();
+};
+
+// 三角形をまとめて処理するプリミティブステージ
+// 頂点をクリップ空間へ変換し、三角形ごとに
+//   1. 3頂点が同じ平面の外にあれば捨てる (視錐台カリング)
+//   2. ニア・ファー面とガードバンドをまたぐものはSutherland–Hodgman法で切る
+//   3. 裏向きと縮退 (面積0) を捨てる
+// を行い、残ったものを詰めて出力する。
+// 変換と外側判定のビットマスク (アウトコード) は頂点をSoAに並べたループで求めるので、コンパイラがベクトル化できる。
+// 三角形はチャンクに分けてjobsで並列に処理し、チャンクごとの出力を入力の順につなぐ。
+class PrimitiveStage {
+public:
+    explicit PrimitiveStage(const PrimitiveStageOptions& options = PrimitiveStageOptions());
+
+    // verticesはxyzの三角形リスト (vertexCountはfloatの数)、colorsはrgb (nullptrでもよい)
+    // modelViewProjectionはオブジェクト空間からクリップ空間への行列
+    void process(const GLfloat* vertices, const GLfloat* colors, size_t vertexCount,
+                 const Matrix4& modelViewProjection, PrimitiveBatch& out,
+                 JobSystem& jobs = JobSystem::instance());
+    // CPU側のデータを持つPolygon3Dから (ビューから作ったものは空になる)
+    void process(const Polygon3D& polygon, const Matrix4& modelViewProjection, PrimitiveBatch& out,
+                 JobSystem& jobs = JobSystem::instance());
+
+    // 出力をクライアント側の配列からそのまま描画する (GLコンテキストのスレッドで呼ぶ)
+    // 行列は呼ぶ側で設定しておくこと (positionsはオブジェクト空間)
+    static void submit(const PrimitiveBatch& batch);
+
+    const PrimitiveStageOptions& getOptions() const noexcept { return options_; }
+    void setOptions(const PrimitiveStageOptions& options) noexcept { options_ = options; }
+    const PrimitiveStats& getStats() const noexcept { return stats_; }
+
+private:
+    // チャンクごとの作業領域と出力 (フレームをまたいで使い回す)
+    struct Chunk {
+        std::vector<float> x, y, z, w;
+        std::vector<unsigned> outcodes;
+        // 配列は使い回すので、前のフレームの分だけ長いことがある。有効なのは先頭のvertexCount頂点
+        PrimitiveBatch batch;
+        size_t vertexCount = 0;
+        PrimitiveStats stats;
+    };
+
+    void processChunk(Chunk& chunk, const GLfloat* vertices, const GLfloat* colors,
+                      size_t firstTriangle, size_t triangleCount, const Matrix4& mvp) const;
+
+    PrimitiveStageOptions options_;
+    PrimitiveStats stats_;
+    std::vector<Chunk> chunks_;
+};
+
+#endif // PRIMITIVE_STAGE_H
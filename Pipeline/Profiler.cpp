@@ -0,0 +1,318 @@
+#include "Profiler.h"
+
+#ifdef GEOALGO_PROFILE
+
+#include <GL/glew.h>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+std::atomic<uint64_t> Profiler::counters_[static_cast<int>(ProfileCounter::Count)];
+
+namespace {
+
+// スレッドごとのイベント用リングバッファ。
+// 書き込みは所有スレッドだけ、読み出しは回収するスレッドだけ (SPSC)。
+// 満杯のときは待たずにイベントを捨て、その数を数えておく。
+struct ThreadRing {
+    static constexpr uint64_t CAPACITY = 1 << 14;
+
+    ProfileEvent events[CAPACITY];
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    std::atomic<uint64_t> dropped{0};
+    uint32_t threadId = 0;
+
+    void push(const ProfileEvent& event) noexcept {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        events[h & (CAPACITY - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    void drain(std::vector<ProfileEvent>& out) {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        const uint64_t h = head.load(std::memory_order_acquire);
+        for (uint64_t i = t; i < h; ++i) {
+            out.push_back(events[i & (CAPACITY - 1)]);
+        }
+        tail.store(h, std::memory_order_release);
+    }
+};
+
+struct GpuScope {
+    const char* name;
+    GLuint beginQuery;
+    GLuint endQuery;
+};
+
+struct CounterSample {
+    uint64_t timeNs;
+    uint64_t values[static_cast<int>(ProfileCounter::Count)];
+};
+
+// GPUの結果は数フレーム遅れて読む。これより古いものが残っていたら結果を待つ。
+constexpr size_t GPU_LATENCY_FRAMES = 3;
+// 回収したイベントとカウンタの上限 (超えたら古いものを捨てて半分まで減らす)
+constexpr size_t MAX_EVENTS = 1 << 20;
+constexpr size_t MAX_COUNTER_SAMPLES = 1 << 16;
+constexpr uint32_t GPU_THREAD_ID = 0xffffffffu;
+
+const char* const COUNTER_NAMES[] = {"draw calls", "triangles", "bytes uploaded"};
+
+struct ProfilerState {
+    std::mutex mutex;
+    // スレッドが終了しても未回収のイベントを読めるように、リングは解放しない
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::vector<ProfileEvent> events;
+    std::vector<CounterSample> counterSamples;
+    uint64_t lastFrame[static_cast<int>(ProfileCounter::Count)] = {};
+    uint64_t droppedEvents = 0;
+    uint64_t droppedCounterSamples = 0;
+    // 終了できなかったGPU区間 (ScopedGpuTimerのデストラクタで起きたもの)
+    uint64_t failedGpuScopes = 0;
+
+    // GPUクエリ (GLスレッドからだけ触る)
+    std::vector<GLuint> freeQueries;
+    // 開始したがまだ終了していない区間 (フレームの区切りをまたいでも残る)
+    std::vector<GpuScope> openScopes;
+    // このフレームで終了した区間
+    std::vector<GpuScope> closedScopes;
+    std::vector<std::vector<GpuScope>> pendingFrames;
+    bool gpuCalibrated = false;
+    int64_t gpuOffsetNs = 0;
+};
+
+ProfilerState& state() {
+    static ProfilerState instance;
+    return instance;
+}
+
+const std::chrono::steady_clock::time_point& epoch() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+ThreadRing& threadRing() {
+    thread_local ThreadRing* ring = nullptr;
+    if (ring == nullptr) {
+        // 登録はスレッドごとに一度だけ。以降の記録はロックを取らない
+        ProfilerState& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.rings.push_back(std::make_unique<ThreadRing>());
+        ring = s.rings.back().get();
+        ring->threadId = static_cast<uint32_t>(s.rings.size() - 1);
+    }
+    return *ring;
+}
+
+GLuint acquireQuery(ProfilerState& s) {
+    if (s.freeQueries.empty()) {
+        GLuint queries[32];
+        glGenQueries(32, queries);
+        s.freeQueries.insert(s.freeQueries.end(), queries, queries + 32);
+    }
+    GLuint query = s.freeQueries.back();
+    s.freeQueries.pop_back();
+    return query;
+}
+
+// GPUのタイムスタンプをCPU側の時間軸にそろえるための差分を一度だけ測る
+void calibrateGpuClock(ProfilerState& s) {
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    s.gpuOffsetNs = static_cast<int64_t>(Profiler::now()) - static_cast<int64_t>(gpuNow);
+    s.gpuCalibrated = true;
+}
+
+// 結果が出ていればイベントに変換してクエリを返却する
+bool resolveGpuScope(ProfilerState& s, const GpuScope& scope, bool wait) {
+    if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(scope.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+    GLuint64 begin = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(scope.beginQuery, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(scope.endQuery, GL_QUERY_RESULT, &end);
+    ProfileEvent event;
+    event.name = scope.name;
+    event.beginNs = static_cast<uint64_t>(static_cast<int64_t>(begin) + s.gpuOffsetNs);
+    event.endNs = static_cast<uint64_t>(static_cast<int64_t>(end) + s.gpuOffsetNs);
+    event.threadId = GPU_THREAD_ID;
+    s.events.push_back(event);
+    s.freeQueries.push_back(scope.beginQuery);
+    s.freeQueries.push_back(scope.endQuery);
+    return true;
+}
+
+// 上限を超えていれば古いものから捨てて上限の半分にし、捨てた数を返す (1回あたりは償却O(1))
+template <typename T>
+uint64_t trimOldest(std::vector<T>& items, size_t limit) {
+    if (items.size() <= limit) {
+        return 0;
+    }
+    const size_t drop = items.size() - limit / 2;
+    items.erase(items.begin(), items.begin() + static_cast<std::ptrdiff_t>(drop));
+    return drop;
+}
+
+void writeEscaped(std::ofstream& out, const char* text) {
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+}
+
+} // namespace
+
+uint64_t Profiler::now() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch()).count());
+}
+
+void Profiler::recordCpu(const char* name, uint64_t beginNs, uint64_t endNs) noexcept {
+    ThreadRing& ring = threadRing();
+    ring.push(ProfileEvent{name, beginNs, endNs, ring.threadId});
+}
+
+uint32_t Profiler::beginGpu(const char* name) {
+    ProfilerState& s = state();
+    if (!s.gpuCalibrated) {
+        calibrateGpuClock(s);
+    }
+    GpuScope scope;
+    scope.name = name;
+    scope.beginQuery = acquireQuery(s);
+    scope.endQuery = acquireQuery(s);
+    glQueryCounter(scope.beginQuery, GL_TIMESTAMP);
+    s.openScopes.push_back(scope);
+    // 区間は終了クエリのIDで識別する (openScopes内の位置はendFrameや入れ子の終了で変わる)
+    return scope.endQuery;
+}
+
+void Profiler::endGpu(uint32_t scope) {
+    ProfilerState& s = state();
+    // 通常は入れ子の内側から閉じるので後ろから探す
+    for (size_t i = s.openScopes.size(); i-- > 0;) {
+        if (s.openScopes[i].endQuery == scope) {
+            glQueryCounter(scope, GL_TIMESTAMP);
+            s.closedScopes.push_back(s.openScopes[i]);
+            s.openScopes.erase(s.openScopes.begin() + static_cast<std::ptrdiff_t>(i));
+            return;
+        }
+    }
+    throw std::logic_error("Profiler::endGpu: unknown GPU scope");
+}
+
+void Profiler::endGpuNoThrow(uint32_t scope) noexcept {
+    try {
+        endGpu(scope);
+    } catch (...) {
+        ++state().failedGpuScopes;
+    }
+}
+
+void Profiler::endFrame() {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    for (auto& ring : s.rings) {
+        ring->drain(s.events);
+        s.droppedEvents += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    // このフレームで終了したGPU区間を保留に回し、結果が出たものから読み出す
+    // (まだ開いている区間は終了クエリが発行されていないので、次のフレーム以降に回す)
+    if (!s.closedScopes.empty()) {
+        s.pendingFrames.push_back(std::move(s.closedScopes));
+        s.closedScopes.clear();
+    }
+    while (!s.pendingFrames.empty()) {
+        // 遅れが上限を超えた古いフレームは結果を待ってでも回収する
+        const bool wait = s.pendingFrames.size() > GPU_LATENCY_FRAMES;
+        std::vector<GpuScope>& frame = s.pendingFrames.front();
+        size_t resolved = 0;
+        while (resolved < frame.size() && resolveGpuScope(s, frame[resolved], wait)) {
+            ++resolved;
+        }
+        frame.erase(frame.begin(), frame.begin() + static_cast<std::ptrdiff_t>(resolved));
+        if (!frame.empty()) {
+            break;
+        }
+        s.pendingFrames.erase(s.pendingFrames.begin());
+    }
+
+    CounterSample sample;
+    sample.timeNs = now();
+    for (int i = 0; i < static_cast<int>(ProfileCounter::Count); ++i) {
+        sample.values[i] = counters_[i].exchange(0, std::memory_order_relaxed);
+        s.lastFrame[i] = sample.values[i];
+    }
+    s.counterSamples.push_back(sample);
+
+    s.droppedEvents += trimOldest(s.events, MAX_EVENTS);
+    s.droppedCounterSamples += trimOldest(s.counterSamples, MAX_COUNTER_SAMPLES);
+}
+
+uint64_t Profiler::getLastFrameCounter(ProfileCounter counter) noexcept {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.lastFrame[static_cast<int>(counter)];
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+    // ts/durはマイクロ秒
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << GPU_THREAD_ID
+        << ",\"args\":{\"name\":\"GPU\"}}";
+    out.precision(3);
+    out << std::fixed;
+    for (const ProfileEvent& event : s.events) {
+        out << ",\n{\"name\":\"";
+        writeEscaped(out, event.name);
+        out << "\",\"cat\":\"" << (event.threadId == GPU_THREAD_ID ? "gpu" : "cpu")
+            << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadId
+            << ",\"ts\":" << event.beginNs / 1000.0
+            << ",\"dur\":" << (event.endNs - event.beginNs) / 1000.0 << "}";
+    }
+    for (const CounterSample& sample : s.counterSamples) {
+        for (int i = 0; i < static_cast<int>(ProfileCounter::Count); ++i) {
+            out << ",\n{\"name\":\"" << COUNTER_NAMES[i] << "\",\"ph\":\"C\",\"pid\":0,\"ts\":"
+                << sample.timeNs / 1000.0 << ",\"args\":{\"value\":" << sample.values[i] << "}}";
+        }
+    }
+    out << "\n],\"otherData\":{\"droppedEvents\":" << s.droppedEvents
+        << ",\"droppedCounterSamples\":" << s.droppedCounterSamples
+        << ",\"failedGpuScopes\":" << s.failedGpuScopes << "}}\n";
+    return static_cast<bool>(out);
+}
+
+void Profiler::clear() {
+    ProfilerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.events.clear();
+    s.counterSamples.clear();
+    s.droppedEvents = 0;
+    s.droppedCounterSamples = 0;
+    s.failedGpuScopes = 0;
+}
+
+#endif // GEOALGO_PROFILE
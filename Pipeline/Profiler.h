@@ -0,0 +1,111 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// GEOALGO_PROFILEを定義したときだけ計測コードが有効になる。
+// 未定義なら下のマクロはすべて空に展開され、何もコンパイルされない。
+//
+//   GEO_PROFILE_SCOPE("name")          スコープのCPU時間
+//   GEO_PROFILE_GPU_SCOPE("name")      スコープのCPU時間とGPU時間 (GLスレッド専用)
+//   GEO_PROFILE_COUNTER(Counter, n)    フレームごとのカウンタに加算
+//   GEO_PROFILE_FRAME_END()            フレームの区切り (GPU結果とカウンタを回収)
+//
+// 名前には文字列リテラルなど、プログラム終了まで有効な文字列を渡すこと。
+
+#ifdef GEOALGO_PROFILE
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ProfileCounter {
+    DrawCalls,
+    Triangles,
+    BytesUploaded,
+    Count
+};
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t beginNs;
+    uint64_t endNs;
+    uint32_t threadId;
+};
+
+class Profiler {
+public:
+    // 計測の起点からの経過時間 (ナノ秒)
+    static uint64_t now() noexcept;
+
+    // 呼び出したスレッドのリングバッファへ追加する (ロックなし)
+    static void recordCpu(const char* name, uint64_t beginNs, uint64_t endNs) noexcept;
+
+    static void addCounter(ProfileCounter counter, uint64_t value) noexcept {
+        counters_[static_cast<int>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // GLのタイムスタンプクエリで区間を計測する (GLコンテキストのスレッドからだけ呼ぶ)
+    // beginGpuが返すIDはendFrameをまたいでも有効。区間は終了したフレームで回収される
+    // 開いていないIDをendGpuに渡すとstd::logic_errorを投げる
+    static uint32_t beginGpu(const char* name);
+    static void endGpu(uint32_t scope);
+    // 例外を投げないendGpu (デストラクタ用)。失敗は数えてトレースに書き出す
+    static void endGpuNoThrow(uint32_t scope) noexcept;
+
+    // 各スレッドのリングバッファと完了したGPUクエリを回収し、カウンタを締める
+    static void endFrame();
+
+    // 直前のフレームのカウンタ値
+    static uint64_t getLastFrameCounter(ProfileCounter counter) noexcept;
+
+    // 回収済みのイベントをChromeのトレース形式(JSON)で書き出す
+    // 回収したイベントとカウンタは上限を超えると古いものから捨てる (捨てた数もトレースに書く)
+    static bool writeChromeTrace(const std::string& path);
+    static void clear();
+
+private:
+    static std::atomic<uint64_t> counters_[static_cast<int>(ProfileCounter::Count)];
+};
+
+class ScopedCpuTimer {
+public:
+    explicit ScopedCpuTimer(const char* name) noexcept : name_(name), begin_(Profiler::now()) {}
+    ~ScopedCpuTimer() { Profiler::recordCpu(name_, begin_, Profiler::now()); }
+    ScopedCpuTimer(const ScopedCpuTimer&) = delete;
+    ScopedCpuTimer& operator=(const ScopedCpuTimer&) = delete;
+
+private:
+    const char* name_;
+    uint64_t begin_;
+};
+
+class ScopedGpuTimer {
+public:
+    explicit ScopedGpuTimer(const char* name) : scope_(Profiler::beginGpu(name)) {}
+    ~ScopedGpuTimer() { Profiler::endGpuNoThrow(scope_); }
+    ScopedGpuTimer(const ScopedGpuTimer&) = delete;
+    ScopedGpuTimer& operator=(const ScopedGpuTimer&) = delete;
+
+private:
+    uint32_t scope_;
+};
+
+#define GEO_PROFILE_CONCAT_INNER(a, b) a##b
+#define GEO_PROFILE_CONCAT(a, b) GEO_PROFILE_CONCAT_INNER(a, b)
+#define GEO_PROFILE_SCOPE(name) ScopedCpuTimer GEO_PROFILE_CONCAT(profileCpu_, __LINE__)(name)
+#define GEO_PROFILE_GPU_SCOPE(name) \
+    ScopedCpuTimer GEO_PROFILE_CONCAT(profileCpu_, __LINE__)(name); \
+    ScopedGpuTimer GEO_PROFILE_CONCAT(profileGpu_, __LINE__)(name)
+#define GEO_PROFILE_COUNTER(counter, value) Profiler::addCounter(ProfileCounter::counter, static_cast<uint64_t>(value))
+#define GEO_PROFILE_FRAME_END() Profiler::endFrame()
+
+#else
+
+#define GEO_PROFILE_SCOPE(name)
+#define GEO_PROFILE_GPU_SCOPE(name)
+#define GEO_PROFILE_COUNTER(counter, value)
+#define GEO_PROFILE_FRAME_END()
+
+#endif // GEOALGO_PROFILE
+
+#endif // PROFILER_H
@@ -0,0 +1,394 @@
+#include "Shader.h"
+#include "Profiler.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+std::string Shader::sBinaryCacheDirectory;
+
+namespace
+{
+	// Header written in front of each cached program binary
+	struct BinaryCacheHeader
+	{
+		uint32_t magic;
+		uint32_t format;
+		uint64_t key;
+		uint64_t length;
+	};
+	const uint32_t BINARY_CACHE_MAGIC = 0x42505347; // "GSPB"
+
+	// 64-bit FNV-1a
+	uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	uint64_t HashString(uint64_t hash, const char* text)
+	{
+		if (text == nullptr)
+		{
+			return hash;
+		}
+		// Include the terminator so "ab"+"c" differs from "a"+"bc"
+		return HashBytes(hash, text, std::char_traits<char>::length(text) + 1);
+	}
+
+	bool ReadFile(const std::string& fileName, std::string& outContents)
+	{
+		std::ifstream file(fileName);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		std::stringstream sstream;
+		sstream << file.rdbuf();
+		outContents = sstream.str();
+		return true;
+	}
+
+	bool ProgramBinarySupported()
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+}
+
+Shader::Shader()
+	: mVertexShader(0)
+	, mFragShader(0)
+	, mShaderProgram(0)
+	, mFromBinaryCache(false)
+{
+}
+
+Shader::~Shader()
+{
+}
+
+bool Shader::Load(const std::string& vertName, const std::string& fragName)
+{
+	std::string vertSource;
+	std::string fragSource;
+	if (!ReadFile(vertName, vertSource))
+	{
+		std::cerr << "Shader file not found: " << vertName << std::endl;
+		return false;
+	}
+	if (!ReadFile(fragName, fragSource))
+	{
+		std::cerr << "Shader file not found: " << fragName << std::endl;
+		return false;
+	}
+	return LoadFromSource(vertSource, fragSource);
+}
+
+bool Shader::LoadFromSource(const std::string& vertSource, const std::string& fragSource)
+{
+	mFromBinaryCache = false;
+	mShaderProgram = glCreateProgram();
+
+	// Try the cached binary first; this skips GLSL compilation entirely
+	const bool useCache = !sBinaryCacheDirectory.empty() && ProgramBinarySupported();
+	uint64_t key = 0;
+	if (useCache)
+	{
+		key = ComputeCacheKey(vertSource, fragSource);
+		if (LoadBinaryCache(key))
+		{
+			mFromBinaryCache = true;
+			CacheUniformLocations();
+			return true;
+		}
+	}
+
+	// Compile vertex and pixel shaders
+	if (!CompileSource(vertSource, GL_VERTEX_SHADER, mVertexShader) ||
+		!CompileSource(fragSource, GL_FRAGMENT_SHADER, mFragShader))
+	{
+		return false;
+	}
+
+	// Now create a shader program that
+	// links together the vertex/frag shaders
+	glAttachShader(mShaderProgram, mVertexShader);
+	glAttachShader(mShaderProgram, mFragShader);
+	if (useCache)
+	{
+		glProgramParameteri(mShaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(mShaderProgram);
+
+	// Verify that the program linked successfully
+	if (!IsValidProgram())
+	{
+		return false;
+	}
+
+	if (useCache)
+	{
+		SaveBinaryCache(key);
+	}
+	CacheUniformLocations();
+	return true;
+}
+
+void Shader::Unload()
+{
+	// Delete the program/shaders
+	glDeleteProgram(mShaderProgram);
+	if (mVertexShader != 0)
+	{
+		glDeleteShader(mVertexShader);
+	}
+	if (mFragShader != 0)
+	{
+		glDeleteShader(mFragShader);
+	}
+	mShaderProgram = 0;
+	mVertexShader = 0;
+	mFragShader = 0;
+	mUniformLocations.clear();
+}
+
+void Shader::SetActive()
+{
+	GEO_PROFILE_GPU_SCOPE("Shader::SetActive");
+	// Set this program as the active one
+	glUseProgram(mShaderProgram);
+}
+
+GLint Shader::GetUniformLocation(const char* name) const
+{
+	if (name == nullptr)
+	{
+		return -1;
+	}
+	auto iter = mUniformLocations.find(name);
+	return iter != mUniformLocations.end() ? iter->second : -1;
+}
+
+void Shader::SetMatrixUniform(const char* name, const Matrix4& matrix)
+{
+	SetMatrixUniform(GetUniformLocation(name), matrix);
+}
+
+void Shader::SetMatrixUniform(GLint location, const Matrix4& matrix)
+{
+	// Matrix4 is row-major, so let GL transpose it
+	glUniformMatrix4fv(location, 1, GL_TRUE, &matrix.m[0][0]);
+}
+
+void Shader::SetVectorUniform(const char* name, const Vector3& vector)
+{
+	SetVectorUniform(GetUniformLocation(name), vector);
+}
+
+void Shader::SetVectorUniform(GLint location, const Vector3& vector)
+{
+	glUniform3f(location, vector.x, vector.y, vector.z);
+}
+
+void Shader::SetFloatUniform(const char* name, float value)
+{
+	SetFloatUniform(GetUniformLocation(name), value);
+}
+
+void Shader::SetFloatUniform(GLint location, float value)
+{
+	glUniform1f(location, value);
+}
+
+bool Shader::BindUniformBlock(const char* blockName, GLuint bindingPoint)
+{
+	GLuint index = glGetUniformBlockIndex(mShaderProgram, blockName);
+	if (index == GL_INVALID_INDEX)
+	{
+		return false;
+	}
+	glUniformBlockBinding(mShaderProgram, index, bindingPoint);
+	return true;
+}
+
+void Shader::SetBinaryCacheDirectory(const std::string& directory)
+{
+	sBinaryCacheDirectory = directory;
+}
+
+bool Shader::CompileShader(const std::string& fileName,
+	GLenum shaderType,
+	GLuint& outShader)
+{
+	std::string contents;
+	if (!ReadFile(fileName, contents))
+	{
+		std::cerr << "Shader file not found: " << fileName << std::endl;
+		return false;
+	}
+	return CompileSource(contents, shaderType, outShader);
+}
+
+bool Shader::CompileSource(const std::string& source,
+	GLenum shaderType,
+	GLuint& outShader)
+{
+	const char* contentsChar = source.c_str();
+
+	// Create a shader of the specified type
+	outShader = glCreateShader(shaderType);
+	// Set the source characters and try to compile
+	glShaderSource(outShader, 1, &(contentsChar), nullptr);
+	glCompileShader(outShader);
+
+	if (!IsCompiled(outShader))
+	{
+		return false;
+	}
+	return true;
+}
+
+bool Shader::IsCompiled(GLuint shader)
+{
+	GLint status;
+	// Query the compile status
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+	if (status != GL_TRUE)
+	{
+		char buffer[512];
+		memset(buffer, 0, 512);
+		glGetShaderInfoLog(shader, 511, nullptr, buffer);
+		std::cerr << "GLSL Compile Failed:\n" << buffer << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool Shader::IsValidProgram()
+{
+	GLint status;
+	// Query the link status
+	glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char buffer[512];
+		memset(buffer, 0, 512);
+		glGetProgramInfoLog(mShaderProgram, 511, nullptr, buffer);
+		std::cerr << "GLSL Link Status:\n" << buffer << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t Shader::ComputeCacheKey(const std::string& vertSource, const std::string& fragSource) const
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = HashString(hash, vertSource.c_str());
+	hash = HashString(hash, fragSource.c_str());
+	// A binary is only valid for the driver that produced it
+	hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+	hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+	return hash;
+}
+
+bool Shader::LoadBinaryCache(uint64_t key)
+{
+	std::ostringstream path;
+	path << sBinaryCacheDirectory << "/" << std::hex << key << ".glbin";
+	std::ifstream file(path.str(), std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	BinaryCacheHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != BINARY_CACHE_MAGIC || header.key != key || header.length == 0)
+	{
+		return false;
+	}
+	std::vector<char> binary(static_cast<size_t>(header.length));
+	file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+	if (!file)
+	{
+		return false;
+	}
+
+	glProgramBinary(mShaderProgram, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+	// The driver may reject a stale binary (e.g. after an update); fall back to compiling
+	GLint status = GL_FALSE;
+	glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &status);
+	return status == GL_TRUE;
+}
+
+void Shader::SaveBinaryCache(uint64_t key)
+{
+	GLint length = 0;
+	glGetProgramiv(mShaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLenum format = 0;
+	glGetProgramBinary(mShaderProgram, length, nullptr, &format, binary.data());
+
+	std::ostringstream path;
+	path << sBinaryCacheDirectory << "/" << std::hex << key << ".glbin";
+	std::ofstream file(path.str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return;
+	}
+	BinaryCacheHeader header;
+	header.magic = BINARY_CACHE_MAGIC;
+	header.format = format;
+	header.key = key;
+	header.length = static_cast<uint64_t>(length);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+}
+
+void Shader::CacheUniformLocations()
+{
+	mUniformLocations.clear();
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(mShaderProgram, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(mShaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> name(static_cast<size_t>(maxLength > 0 ? maxLength : 1));
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(mShaderProgram, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()),
+			&length, &size, &type, name.data());
+		std::string uniformName(name.data(), static_cast<size_t>(length));
+		// Uniforms inside blocks report -1 and are set through UniformBuffer instead
+		GLint location = glGetUniformLocation(mShaderProgram, uniformName.c_str());
+		if (location < 0)
+		{
+			continue;
+		}
+		mUniformLocations[uniformName] = location;
+		// Arrays are reported as "name[0]"; also register the bare name
+		size_t bracket = uniformName.find('[');
+		if (bracket != std::string::npos)
+		{
+			mUniformLocations[uniformName.substr(0, bracket)] = location;
+		}
+	}
+}
@@ -2,6 +2,8 @@
 
 #pragma once
 #include <GL/glew.h>
+#include <cstdint>
+#include <map>
 #include <string>
 #include "Math/vector_space.h"
 
@@ -12,28 +14,61 @@ public:
 	~Shader();
 	// Load the vertex/fragment shaders with the given names
 	bool Load(const std::string& vertName, const std::string& fragName);
+	// Build the program from in-memory sources (as in sample.h)
+	bool LoadFromSource(const std::string& vertSource, const std::string& fragSource);
 	void Unload();
 	// Set this as the active shader program
 	void SetActive();
+	// Returns the cached location of a uniform (-1 if it is not active).
+	// The lookup does not allocate, but per-frame code should keep the
+	// location and use the GLint setters below
+	GLint GetUniformLocation(const char* name) const;
 	// Sets a Matrix uniform
 	void SetMatrixUniform(const char* name, const Matrix4& matrix);
+	void SetMatrixUniform(GLint location, const Matrix4& matrix);
 	// Sets a Vector3 uniform
 	void SetVectorUniform(const char* name, const Vector3& vector);
+	void SetVectorUniform(GLint location, const Vector3& vector);
 	// Sets a float uniform
 	void SetFloatUniform(const char* name, float value);
+	void SetFloatUniform(GLint location, float value);
+	// Connects a uniform block to a binding point shared with a UniformBuffer
+	bool BindUniformBlock(const char* blockName, GLuint bindingPoint);
+
+	// Directory where linked program binaries are cached (empty disables the cache)
+	static void SetBinaryCacheDirectory(const std::string& directory);
+	// True if the last Load came from the binary cache
+	bool IsFromBinaryCache() const { return mFromBinaryCache; }
 private:
 	// Tries to compile the specified shader
 	bool CompileShader(const std::string& fileName,
 					   GLenum shaderType,
 					   GLuint& outShader);
-	
+	// Compiles shader source that is already in memory
+	bool CompileSource(const std::string& source,
+					   GLenum shaderType,
+					   GLuint& outShader);
+
 	// Tests whether shader compiled successfully
 	bool IsCompiled(GLuint shader);
 	// Tests whether vertex/fragment programs link
 	bool IsValidProgram();
+
+	// Program binary cache keyed by a hash of the sources and the driver
+	uint64_t ComputeCacheKey(const std::string& vertSource, const std::string& fragSource) const;
+	bool LoadBinaryCache(uint64_t key);
+	void SaveBinaryCache(uint64_t key);
+	// Resolves every active uniform location once after linking
+	void CacheUniformLocations();
 private:
 	// Store the shader object IDs
 	GLuint mVertexShader;
 	GLuint mFragShader;
 	GLuint mShaderProgram;
+	// Uniform name -> location, filled at link time.
+	// std::less<> lets find() take the const char* directly (no temporary std::string)
+	std::map<std::string, GLint, std::less<>> mUniformLocations;
+	bool mFromBinaryCache;
+
+	static std::string sBinaryCacheDirectory;
 };
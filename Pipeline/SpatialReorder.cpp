@@ -0,0 +1,78 @@
+#include "SpatialReorder.h"
+#include "Profiler.h"
+#include <stdexcept>
+
+namespace {
+    // 重心や中心を求める1チャンクの要素数
+    const size_t CENTROID_GRAIN = 4096;
+}
+
+void triangleMortonOrder(const GLfloat* vertices, size_t vertexCount, std::vector<uint32_t>& order,
+                         MortonPrecision precision, JobSystem& jobs) {
+    GEO_PROFILE_SCOPE("triangleMortonOrder");
+    const size_t triangleCount = vertexCount / 9;
+    std::vector<Vector3> centroids(triangleCount);
+    jobs.parallelFor(0, triangleCount, CENTROID_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            const GLfloat* v = vertices + t * 9;
+            // 3で割らなくても順序は変わらない
+            centroids[t] = Vector3(v[0] + v[3] + v[6], v[1] + v[4] + v[7], v[2] + v[5] + v[8]);
+        }
+    });
+    mortonOrder(centroids.data(), triangleCount, order, precision, jobs);
+}
+
+void permuteTriangles(std::vector<GLfloat>& vertices, std::vector<GLfloat>& colors,
+                      const std::vector<uint32_t>& order) {
+    const size_t triangleCount = vertices.size() / 9;
+    if (order.size() != triangleCount) {
+        throw std::invalid_argument("Triangle order size does not match triangle count");
+    }
+    if (!colors.empty() && colors.size() != vertices.size()) {
+        throw std::invalid_argument("Color count does not match vertex count");
+    }
+    permuteInPlace(vertices.data(), 9, order.data(), triangleCount);
+    if (!colors.empty()) {
+        permuteInPlace(colors.data(), 9, order.data(), triangleCount);
+    }
+}
+
+void reorderTriangles(Polygon3D& polygon, MortonPrecision precision, JobSystem& jobs) {
+    const std::vector<GLfloat>& vertices = polygon.getVertices();
+    std::vector<uint32_t> order;
+    triangleMortonOrder(vertices.data(), vertices.size(), order, precision, jobs);
+    polygon.permuteTriangles(order);
+}
+
+void objectMortonOrder(const std::vector<DrawObject>& objects, std::vector<uint32_t>& order,
+                       MortonPrecision precision, JobSystem& jobs) {
+    GEO_PROFILE_SCOPE("objectMortonOrder");
+    std::vector<Vector3> centers(objects.size());
+    jobs.parallelFor(0, objects.size(), CENTROID_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Matrix4& model = objects[i].model;
+            float local[3] = {0.0f, 0.0f, 0.0f};
+            if (objects[i].mesh) {
+                const LodChain& chain = objects[i].mesh->getChain();
+                local[0] = chain.center[0];
+                local[1] = chain.center[1];
+                local[2] = chain.center[2];
+            }
+            float world[3];
+            for (int row = 0; row < 3; ++row) {
+                world[row] = model.m[row][0] * local[0] + model.m[row][1] * local[1] +
+                             model.m[row][2] * local[2] + model.m[row][3];
+            }
+            centers[i] = Vector3(world[0], world[1], world[2]);
+        }
+    });
+    mortonOrder(centers.data(), centers.size(), order, precision, jobs);
+}
+
+std::vector<uint32_t> reorderObjects(std::vector<DrawObject>& objects, MortonPrecision precision,
+                                     JobSystem& jobs) {
+    std::vector<uint32_t> order;
+    objectMortonOrder(objects, order, precision, jobs);
+    permuteInPlace(objects, order);
+    return order;
+}
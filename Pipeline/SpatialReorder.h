@@ -0,0 +1,43 @@
+#ifndef SPATIAL_REORDER_H
+#define SPATIAL_REORDER_H
+
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include "Math/vector_space.h"
+#include "Math/morton.h"
+#include "Core/job_system.h"
+#include "DrawList.h"
+#include "Polygon3D.h"
+
+// 三角形やオブジェクトを空間的に近いものが隣り合うように並べ替える
+// 重心 (オブジェクトはバウンディングスフィアの中心) のMorton符号を基数ソートした順序を作り、
+// 配列をその場で並べ替える。カリングやBVHの構築、頂点の読み込みでキャッシュに載りやすくなる。
+
+// 三角形リスト (xyz、vertexCountはfloatの数) の三角形の順序
+void triangleMortonOrder(const GLfloat* vertices, size_t vertexCount, std::vector<uint32_t>& order,
+                         MortonPrecision precision = MortonPrecision::Bits30,
+                         JobSystem& jobs = JobSystem::instance());
+
+// 三角形リストの頂点と色をorderの順にその場で並べ替える (colorsは空でもよい。orderが置換でなければstd::invalid_argument)
+void permuteTriangles(std::vector<GLfloat>& vertices, std::vector<GLfloat>& colors,
+                      const std::vector<uint32_t>& order);
+
+// Polygon3Dの三角形をMorton順に並べ替えて再アップロードする
+// (CPU側のデータを持たない場合はstd::logic_errorを投げる)
+void reorderTriangles(Polygon3D& polygon, MortonPrecision precision = MortonPrecision::Bits30,
+                      JobSystem& jobs = JobSystem::instance());
+
+// オブジェクトのワールド空間での中心 (model * バウンディングスフィアの中心) の順序
+// メッシュの無いオブジェクトはモデル行列の平行移動成分を使う
+void objectMortonOrder(const std::vector<DrawObject>& objects, std::vector<uint32_t>& order,
+                       MortonPrecision precision = MortonPrecision::Bits30,
+                       JobSystem& jobs = JobSystem::instance());
+
+// オブジェクト (とモデル行列) をMorton順に並べ替え、使った順序を返す
+// オブジェクトと並行に持っている配列 (別管理の変換など) はpermuteInPlaceに同じ順序を渡して揃える
+std::vector<uint32_t> reorderObjects(std::vector<DrawObject>& objects,
+                                     MortonPrecision precision = MortonPrecision::Bits30,
+                                     JobSystem& jobs = JobSystem::instance());
+
+#endif // SPATIAL_REORDER_H
@@ -0,0 +1,90 @@
+#include "UniformBuffer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+UniformBuffer::UniformBuffer(GLsizeiptr size, GLuint bindingPoint)
+	: mBuffer(0)
+	, mBindingPoint(bindingPoint)
+	, mStaging(static_cast<size_t>(size), 0)
+	, mDirtyBegin(0)
+	, mDirtyEnd(0)
+{
+	glGenBuffers(1, &mBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	Bind();
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	if (mBuffer != 0)
+	{
+		glDeleteBuffers(1, &mBuffer);
+	}
+}
+
+void UniformBuffer::SetData(GLintptr offset, const void* data, GLsizeiptr size)
+{
+	if (offset < 0 || size < 0 || static_cast<size_t>(offset + size) > mStaging.size())
+	{
+		throw std::out_of_range("Uniform buffer write is out of range");
+	}
+	std::memcpy(mStaging.data() + offset, data, static_cast<size_t>(size));
+	if (mDirtyBegin == mDirtyEnd)
+	{
+		mDirtyBegin = offset;
+		mDirtyEnd = offset + size;
+	}
+	else
+	{
+		mDirtyBegin = std::min(mDirtyBegin, offset);
+		mDirtyEnd = std::max(mDirtyEnd, offset + size);
+	}
+}
+
+void UniformBuffer::SetMatrix(GLintptr offset, const Matrix4& matrix)
+{
+	// Matrix4 is row-major; std140 mat4 is four column vectors
+	float columns[16];
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			columns[j * 4 + i] = matrix.m[i][j];
+		}
+	}
+	SetData(offset, columns, sizeof(columns));
+}
+
+void UniformBuffer::SetVector(GLintptr offset, const Vector3& vector)
+{
+	float values[3] = { vector.x, vector.y, vector.z };
+	SetData(offset, values, sizeof(values));
+}
+
+void UniformBuffer::SetFloat(GLintptr offset, float value)
+{
+	SetData(offset, &value, sizeof(value));
+}
+
+void UniformBuffer::Upload()
+{
+	if (mDirtyBegin == mDirtyEnd)
+	{
+		return;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, mDirtyBegin, mDirtyEnd - mDirtyBegin, mStaging.data() + mDirtyBegin);
+	GEO_PROFILE_COUNTER(BytesUploaded, mDirtyEnd - mDirtyBegin);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	mDirtyBegin = 0;
+	mDirtyEnd = 0;
+}
+
+void UniformBuffer::Bind() const
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, mBindingPoint, mBuffer);
+}
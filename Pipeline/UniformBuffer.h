@@ -0,0 +1,39 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+#include "Math/vector_space.h"
+
+// Uniform buffer object shared by every shader that binds the same block.
+// Per-frame values are staged on the CPU and sent with one upload per frame
+// instead of one glUniform call per value per draw.
+class UniformBuffer
+{
+public:
+	// size is the std140 size of the block in bytes
+	UniformBuffer(GLsizeiptr size, GLuint bindingPoint);
+	~UniformBuffer();
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// Stage raw bytes at a std140 offset
+	void SetData(GLintptr offset, const void* data, GLsizeiptr size);
+	// Stage a mat4 (written column-major as std140 expects)
+	void SetMatrix(GLintptr offset, const Matrix4& matrix);
+	// Stage a vec3 (occupies 16 bytes in std140)
+	void SetVector(GLintptr offset, const Vector3& vector);
+	void SetFloat(GLintptr offset, float value);
+
+	// Send the staged range to the GPU (no-op if nothing changed)
+	void Upload();
+	// Attach the buffer to its binding point
+	void Bind() const;
+
+	GLuint GetBindingPoint() const { return mBindingPoint; }
+private:
+	GLuint mBuffer;
+	GLuint mBindingPoint;
+	std::vector<unsigned char> mStaging;
+	// Dirty byte range [mDirtyBegin, mDirtyEnd)
+	GLintptr mDirtyBegin;
+	GLintptr mDirtyEnd;
+};
@@ -0,0 +1,251 @@
+#include "VertexFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+size_t VertexFormat::positionStride() const noexcept {
+    return position == PositionFormat::Float32 ? 3 * sizeof(GLfloat) : 3 * sizeof(GLshort);
+}
+
+size_t VertexFormat::colorStride() const noexcept {
+    return color == ColorFormat::Float32 ? 3 * sizeof(GLfloat) : 4 * sizeof(GLubyte);
+}
+
+size_t VertexFormat::normalStride() const noexcept {
+    switch (normal) {
+    case NormalFormat::Snorm16: return 3 * sizeof(GLshort);
+    case NormalFormat::Oct16:   return 2 * sizeof(GLshort);
+    case NormalFormat::Oct8:    return 2 * sizeof(GLbyte);
+    default:                    return 3 * sizeof(GLfloat);
+    }
+}
+
+QuantizationBounds computeQuantizationBounds(const GLfloat* positions, size_t floatCount) {
+    QuantizationBounds bounds;
+    if (floatCount < 3) {
+        return bounds;
+    }
+    float minV[3] = {positions[0], positions[1], positions[2]};
+    float maxV[3] = {positions[0], positions[1], positions[2]};
+    for (size_t i = 3; i + 2 < floatCount; i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            minV[k] = std::min(minV[k], positions[i + k]);
+            maxV[k] = std::max(maxV[k], positions[i + k]);
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        bounds.center[k] = 0.5f * (minV[k] + maxV[k]);
+        float half = 0.5f * (maxV[k] - minV[k]);
+        // 厚みのない軸はスケール1のままにしてゼロ除算を避ける
+        bounds.halfExtent[k] = half > 1e-20f ? half : 1.0f;
+    }
+    return bounds;
+}
+
+Matrix4 dequantizationMatrix(const QuantizationBounds& bounds, PositionFormat format) {
+    if (format == PositionFormat::Float32) {
+        return Matrix4();
+    }
+    float s = format == PositionFormat::Snorm16 ? 1.0f / 32767.0f : 1.0f;
+    return Matrix4(
+        bounds.halfExtent[0] * s, 0.0f, 0.0f, bounds.center[0],
+        0.0f, bounds.halfExtent[1] * s, 0.0f, bounds.center[1],
+        0.0f, 0.0f, bounds.halfExtent[2] * s, bounds.center[2],
+        0.0f, 0.0f, 0.0f, 1.0f
+    );
+}
+
+// IEEE754 binary16への変換 (最近接偶数丸め)
+GLushort floatToHalf(float value) noexcept {
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+    uint32_t sign = (f >> 16) & 0x8000u;
+    uint32_t absF = f & 0x7fffffffu;
+
+    if (absF >= 0x7f800000u) {
+        // InfとNaN
+        return static_cast<GLushort>(sign | 0x7c00u | (absF > 0x7f800000u ? 0x0200u : 0u));
+    }
+    if (absF >= 0x477ff000u) {
+        // 半精度の最大値を超える値はInfに丸める
+        return static_cast<GLushort>(sign | 0x7c00u);
+    }
+    if (absF < 0x38800000u) {
+        // 非正規化数 (またはゼロ)
+        if (absF < 0x33000000u) {
+            return static_cast<GLushort>(sign);
+        }
+        uint32_t mantissa = (absF & 0x007fffffu) | 0x00800000u;
+        int shift = 126 - static_cast<int>(absF >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u))) {
+            ++half;
+        }
+        return static_cast<GLushort>(sign | half);
+    }
+    uint32_t half = ((absF - 0x38000000u) >> 13);
+    uint32_t rest = absF & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+        ++half;
+    }
+    return static_cast<GLushort>(sign | half);
+}
+
+float halfToFloat(GLushort value) noexcept {
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x03ffu;
+    uint32_t f;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            f = sign;
+        } else {
+            // 非正規化数を正規化する
+            exponent = 113;
+            while ((mantissa & 0x0400u) == 0) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            mantissa &= 0x03ffu;
+            f = sign | (exponent << 23) | (mantissa << 13);
+        }
+    } else if (exponent == 0x1f) {
+        f = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &f, sizeof(result));
+    return result;
+}
+
+namespace {
+    // 0から遠い方へ丸める (std::lroundと同じ結果で、分岐もライブラリ呼び出しもない)
+    inline int roundHalfAway(float value) noexcept {
+        return static_cast<int>(value + std::copysign(0.5f, value));
+    }
+}
+
+GLshort encodeSnorm16(float value) noexcept {
+    float clamped = std::min(std::max(value, -1.0f), 1.0f);
+    return static_cast<GLshort>(roundHalfAway(clamped * 32767.0f));
+}
+
+float decodeSnorm16(GLshort value) noexcept {
+    return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+GLbyte encodeSnorm8(float value) noexcept {
+    float clamped = std::min(std::max(value, -1.0f), 1.0f);
+    return static_cast<GLbyte>(roundHalfAway(clamped * 127.0f));
+}
+
+float decodeSnorm8(GLbyte value) noexcept {
+    return std::max(static_cast<float>(value) / 127.0f, -1.0f);
+}
+
+GLubyte encodeUnorm8(float value) noexcept {
+    float clamped = std::min(std::max(value, 0.0f), 1.0f);
+    return static_cast<GLubyte>(roundHalfAway(clamped * 255.0f));
+}
+
+float decodeUnorm8(GLubyte value) noexcept {
+    return static_cast<float>(value) / 255.0f;
+}
+
+namespace {
+    inline float signNotZero(float v) {
+        return v >= 0.0f ? 1.0f : -1.0f;
+    }
+}
+
+// 単位球を八面体に射影し、下半分を折り返して正方形に展開する
+void encodeOctahedral(const Vector3& normal, float& u, float& v) noexcept {
+    float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (l1 < 1e-20f) {
+        u = 0.0f;
+        v = 0.0f;
+        return;
+    }
+    float px = normal.x / l1;
+    float py = normal.y / l1;
+    if (normal.z < 0.0f) {
+        float ox = (1.0f - std::fabs(py)) * signNotZero(px);
+        float oy = (1.0f - std::fabs(px)) * signNotZero(py);
+        px = ox;
+        py = oy;
+    }
+    u = px;
+    v = py;
+}
+
+Vector3 decodeOctahedral(float u, float v) noexcept {
+    float z = 1.0f - std::fabs(u) - std::fabs(v);
+    float x = u;
+    float y = v;
+    if (z < 0.0f) {
+        x = (1.0f - std::fabs(v)) * signNotZero(u);
+        y = (1.0f - std::fabs(u)) * signNotZero(v);
+    }
+    return Vector3(x, y, z).normalize();
+}
+
+void encodePositionsSnorm16(const GLfloat* src, size_t floatCount, const QuantizationBounds& bounds, GLshort* dst) {
+    float inv[3];
+    for (int k = 0; k < 3; ++k) {
+        inv[k] = 1.0f / bounds.halfExtent[k];
+    }
+    for (size_t i = 0; i + 2 < floatCount; i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            dst[i + k] = encodeSnorm16((src[i + k] - bounds.center[k]) * inv[k]);
+        }
+    }
+}
+
+void encodePositionsHalf(const GLfloat* src, size_t floatCount, const QuantizationBounds& bounds, GLushort* dst) {
+    float inv[3];
+    for (int k = 0; k < 3; ++k) {
+        inv[k] = 1.0f / bounds.halfExtent[k];
+    }
+    for (size_t i = 0; i + 2 < floatCount; i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            dst[i + k] = floatToHalf((src[i + k] - bounds.center[k]) * inv[k]);
+        }
+    }
+}
+
+void encodeColorsUnorm8(const GLfloat* src, size_t floatCount, GLubyte* dst) {
+    for (size_t i = 0, j = 0; i + 2 < floatCount; i += 3, j += 4) {
+        dst[j + 0] = encodeUnorm8(src[i + 0]);
+        dst[j + 1] = encodeUnorm8(src[i + 1]);
+        dst[j + 2] = encodeUnorm8(src[i + 2]);
+        dst[j + 3] = 255;
+    }
+}
+
+void encodeNormalsSnorm16(const GLfloat* src, size_t floatCount, GLshort* dst) {
+    for (size_t i = 0; i < floatCount; ++i) {
+        dst[i] = encodeSnorm16(src[i]);
+    }
+}
+
+void encodeNormalsOct16(const GLfloat* src, size_t floatCount, GLshort* dst) {
+    for (size_t i = 0, j = 0; i + 2 < floatCount; i += 3, j += 2) {
+        float u, v;
+        encodeOctahedral(Vector3(src[i], src[i + 1], src[i + 2]), u, v);
+        dst[j + 0] = encodeSnorm16(u);
+        dst[j + 1] = encodeSnorm16(v);
+    }
+}
+
+void encodeNormalsOct8(const GLfloat* src, size_t floatCount, GLbyte* dst) {
+    for (size_t i = 0, j = 0; i + 2 < floatCount; i += 3, j += 2) {
+        float u, v;
+        encodeOctahedral(Vector3(src[i], src[i + 1], src[i + 2]), u, v);
+        dst[j + 0] = encodeSnorm8(u);
+        dst[j + 1] = encodeSnorm8(v);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <GL/glew.h>
+#include "Math/vector_space.h"
+
+// 頂点位置の格納形式
+enum class PositionFormat {
+    Float32,  // 32bit浮動小数点 (12バイト/頂点)
+    Snorm16,  // 16bit符号付き整数 (6バイト/頂点)、バウンディングボックスで正規化
+    Half16    // 16bit半精度浮動小数点 (6バイト/頂点)、バウンディングボックスで正規化
+};
+
+// 頂点色の格納形式
+enum class ColorFormat {
+    Float32,  // RGB 32bit浮動小数点 (12バイト/頂点)
+    Unorm8    // RGBA 8bit正規化整数 (4バイト/頂点)
+};
+
+// 法線の格納形式
+enum class NormalFormat {
+    Float32,  // XYZ 32bit浮動小数点 (12バイト/頂点)
+    Snorm16,  // XYZ 16bit符号付き正規化整数 (6バイト/頂点)
+    Oct16,    // 八面体エンコード 16bit x 2 (4バイト/頂点)、シェーダでのデコードが必要
+    Oct8      // 八面体エンコード 8bit x 2 (2バイト/頂点)、シェーダでのデコードが必要
+};
+
+// 八面体エンコードの法線を渡す汎用頂点属性の番号 ([-1, 1]に正規化した2成分。固定機能の法線配列には入らない)
+constexpr GLuint OCTAHEDRAL_NORMAL_ATTRIBUTE = 2;
+
+// Polygon3Dがアップロード時に使用する頂点フォーマット
+struct VertexFormat {
+    PositionFormat position = PositionFormat::Float32;
+    ColorFormat color = ColorFormat::Float32;
+    NormalFormat normal = NormalFormat::Float32;
+
+    // 1頂点あたりのバイト数
+    size_t positionStride() const noexcept;
+    size_t colorStride() const noexcept;
+    size_t normalStride() const noexcept;
+};
+
+// 位置の量子化に使うバウンディングボックス (中心と各軸の半径)
+struct QuantizationBounds {
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    float halfExtent[3] = {1.0f, 1.0f, 1.0f};
+};
+
+// 頂点配列 (xyzの並び) からバウンディングボックスを計算する
+QuantizationBounds computeQuantizationBounds(const GLfloat* positions, size_t floatCount);
+
+// 量子化された位置を元の座標に戻す行列 (メッシュごとにモデル行列へ掛ける)
+// Snorm16は固定機能パイプラインに正規化されない整数として渡すため、1/32767のスケールを含む
+Matrix4 dequantizationMatrix(const QuantizationBounds& bounds, PositionFormat format);
+
+// スカラーの変換
+GLushort floatToHalf(float value) noexcept;
+float halfToFloat(GLushort value) noexcept;
+GLshort encodeSnorm16(float value) noexcept;
+float decodeSnorm16(GLshort value) noexcept;
+GLbyte encodeSnorm8(float value) noexcept;
+float decodeSnorm8(GLbyte value) noexcept;
+GLubyte encodeUnorm8(float value) noexcept;
+float decodeUnorm8(GLubyte value) noexcept;
+
+// 八面体エンコード (単位ベクトル -> [-1, 1]^2)
+void encodeOctahedral(const Vector3& normal, float& u, float& v) noexcept;
+Vector3 decodeOctahedral(float u, float v) noexcept;
+
+// 配列単位のエンコード (floatCountはxyzの並びの要素数)
+void encodePositionsSnorm16(const GLfloat* src, size_t floatCount, const QuantizationBounds& bounds, GLshort* dst);
+void encodePositionsHalf(const GLfloat* src, size_t floatCount, const QuantizationBounds& bounds, GLushort* dst);
+// RGBをRGBA8へ (アルファは255)
+void encodeColorsUnorm8(const GLfloat* src, size_t floatCount, GLubyte* dst);
+void encodeNormalsSnorm16(const GLfloat* src, size_t floatCount, GLshort* dst);
+// 1頂点あたり2要素を書き込む
+void encodeNormalsOct16(const GLfloat* src, size_t floatCount, GLshort* dst);
+void encodeNormalsOct8(const GLfloat* src, size_t floatCount, GLbyte* dst);
+
+#endif // VERTEX_FORMAT_H
@@ -1,5 +1,8 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <cmath>
+#include "FramePipeline.h"
+#include "Profiler.h"
 
 // Function to handle window resize
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -7,6 +10,39 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
   glViewport(0, 0, width, height);
 }
 
+// Unit cube as a triangle list, one color per face
+void make_cube(std::vector<GLfloat>& vertices, std::vector<GLfloat>& colors)
+{
+  const float corners[8][3] = {
+    {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
+    {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}
+  };
+  const int faces[6][4] = {
+    {4, 5, 6, 7}, {1, 0, 3, 2}, {5, 1, 2, 6}, {0, 4, 7, 3}, {7, 6, 2, 3}, {0, 1, 5, 4}
+  };
+  const int corner_order[6] = {0, 1, 2, 0, 2, 3};
+  for (int f = 0; f < 6; f++)
+  {
+    for (int k : corner_order)
+    {
+      const float* p = corners[faces[f][k]];
+      vertices.insert(vertices.end(), p, p + 3);
+      colors.push_back(0.3f + 0.7f * (f & 1));
+      colors.push_back(0.3f + 0.7f * ((f >> 1) & 1));
+      colors.push_back(0.3f + 0.7f * (f >> 2));
+    }
+  }
+}
+
+Matrix4 perspective(float fovY, float aspect, float zNear, float zFar)
+{
+  const float f = 1.0f / std::tan(fovY * 0.5f);
+  return Matrix4(f / aspect, 0.0f, 0.0f, 0.0f,
+                 0.0f, f, 0.0f, 0.0f,
+                 0.0f, 0.0f, (zFar + zNear) / (zNear - zFar), 2.0f * zFar * zNear / (zNear - zFar),
+                 0.0f, 0.0f, -1.0f, 0.0f);
+}
+
 int main()
 {
   // Initialize GLFW
@@ -15,7 +51,8 @@ int main()
   // Configure GLFW
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // Polygon3D draws through the fixed-function pipeline
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
 
   // Create a window
   GLFWwindow* window = glfwCreateWindow(800, 600, "Rendering Pipeline", NULL, NULL);
@@ -38,20 +75,73 @@ int main()
     return -1;
   }
 
+  std::vector<GLfloat> cube_vertices;
+  std::vector<GLfloat> cube_colors;
+  make_cube(cube_vertices, cube_colors);
+  LodMesh cube(buildLodChain(cube_vertices, cube_colors, 1));
+  DrawList draw_list;
+  glEnable(GL_DEPTH_TEST);
+
+  // Update for frame N+1 runs on the job system while frame N is drawn here
+  FramePipeline pipeline(
+    [&cube](const FrameState& previous, FrameState& next)
+    {
+      next.time = glfwGetTime();
+      next.view = Matrix4();
+      next.projection = perspective(1.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+      next.viewportHeight = 600.0f;
+      // A grid of spinning cubes
+      const int grid = 16;
+      next.objects.resize(grid * grid);
+      JobSystem::instance().parallelFor(0, next.objects.size(), 32, [&](size_t begin, size_t end)
+      {
+        for (size_t i = begin; i < end; i++)
+        {
+          const float angle = static_cast<float>(next.time) + 0.1f * i;
+          const float c = std::cos(angle);
+          const float s = std::sin(angle);
+          const float x = 1.5f * (static_cast<int>(i % grid) - grid / 2);
+          const float y = 1.5f * (static_cast<int>(i / grid) - grid / 2);
+          next.objects[i].mesh = &cube;
+          next.objects[i].model = Matrix4(c, 0.0f, s, x,
+                                          0.0f, 1.0f, 0.0f, y,
+                                          -s, 0.0f, c, -30.0f,
+                                          0.0f, 0.0f, 0.0f, 1.0f);
+        }
+      });
+    },
+    [&](const FrameState& state)
+    {
+      {
+        GEO_PROFILE_GPU_SCOPE("clear");
+        // Clear the screen
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      }
+
+      draw_list.prepare(state.objects, state.view, state.projection, state.viewportHeight);
+      draw_list.submit();
+
+      {
+        GEO_PROFILE_SCOPE("swap");
+        // Swap the front and back buffers
+        glfwSwapBuffers(window);
+      }
+
+      // Poll for events
+      glfwPollEvents();
+    });
+
   // Main rendering loop
   while (!glfwWindowShouldClose(window))
   {
-    // Clear the screen
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    // Swap the front and back buffers
-    glfwSwapBuffers(window);
-
-    // Poll for events
-    glfwPollEvents();
+    pipeline.runFrame();
   }
 
+#ifdef GEOALGO_PROFILE
+  Profiler::writeChromeTrace("trace.json");
+#endif
+
   // Terminate GLFW
   glfwTerminate();
 
@@ -163,8 +253,13 @@ while (!glfwWindowShouldClose(window))
   // Bind the VAO
   glBindVertexArray(VAO);
 
-  // Draw the plane
-  glDrawArrays(GL_TRIANGLES, 0, 3);
+  {
+    GEO_PROFILE_GPU_SCOPE("draw plane");
+    // Draw the plane
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GEO_PROFILE_COUNTER(DrawCalls, 1);
+    GEO_PROFILE_COUNTER(Triangles, 1);
+  }
 
   // Unbind the VAO
   glBindVertexArray(0);
@@ -174,6 +269,8 @@ while (!glfwWindowShouldClose(window))
 
   // Poll for events
   glfwPollEvents();
+
+  GEO_PROFILE_FRAME_END();
 }
 
 // Delete the VAO and VBO
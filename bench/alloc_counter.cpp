@@ -0,0 +1,72 @@
+// グローバルなoperator new/deleteを置き換えて、ヒープ確保の回数とバイト数を数える
+#include "benchmark.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<uint64_t> allocationBytes{0};
+
+void* countedAllocate(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* countedAllocateAligned(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    // aligned_allocはサイズがアラインメントの倍数である必要がある
+    const std::size_t rounded = (size + align - 1) / align * align;
+#ifdef _WIN32
+    void* p = _aligned_malloc(rounded ? rounded : align, align);
+#else
+    void* p = std::aligned_alloc(align, rounded ? rounded : align);
+#endif
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void countedFreeAligned(void* p) noexcept {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+} // namespace
+
+AllocationStats allocationStats() noexcept {
+    return AllocationStats{allocationCount.load(std::memory_order_relaxed),
+                           allocationBytes.load(std::memory_order_relaxed)};
+}
+
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAllocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAllocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, alignment); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { countedFreeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { countedFreeAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { countedFreeAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { countedFreeAligned(p); }
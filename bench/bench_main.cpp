@@ -0,0 +1,38 @@
+#include "benchmark.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cout << "usage: " << program << " [--filter <substring>] [--json <path>]"
+              << " [--min-time <seconds>] [--repetitions <n>]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+            options.jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            options.minSeconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            options.repetitions = std::atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    registerMathBenchmarks();
+#ifdef GEOALGO_BENCH_PIPELINE
+    registerPipelineBenchmarks();
+#endif
+    return runBenchmarks(options);
+}
@@ -0,0 +1,464 @@
+#include "benchmark.h"
+#include "Math/batch_transform.h"
+#include "Math/conjugate_gradient.h"
+#include "Math/convex_hull.h"
+#include "Math/gram_schmidt_normalization.h"
+#include "Math/kd_tree.h"
+#include "Math/morton.h"
+#include "Math/operators.h"
+#include "Math/spatial_hash_grid.h"
+#include "Math/sparse_matrix.h"
+#include "Math/svd3.h"
+#include "Math/vector_space.h"
+#ifdef GEOALGO_HAS_GLM
+#include "Math/kabsch.h"
+#include "Math/quaternion.h"
+#endif
+#include <random>
+
+namespace {
+
+std::vector<double> randomVector(std::mt19937& rng, size_t size) {
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<double> v(size);
+    for (double& x : v) {
+        x = dist(rng);
+    }
+    return v;
+}
+
+void registerVectorBenchmarks() {
+    for (size_t size : {16u, 1024u, 65536u}) {
+        const std::string suffix = "/" + std::to_string(size);
+
+        registerBenchmark("dot" + suffix, [size](BenchmarkContext& ctx) {
+            std::mt19937 rng(1);
+            const std::vector<double> a = randomVector(rng, size);
+            const std::vector<double> b = randomVector(rng, size);
+            ctx.setBytesPerOp(2.0 * size * sizeof(double));
+            ctx.run([&] { doNotOptimize(dot(a, b)); });
+        });
+
+        registerBenchmark("norm" + suffix, [size](BenchmarkContext& ctx) {
+            std::mt19937 rng(2);
+            const std::vector<double> a = randomVector(rng, size);
+            ctx.setBytesPerOp(1.0 * size * sizeof(double));
+            ctx.run([&] { doNotOptimize(norm(a)); });
+        });
+
+        registerBenchmark("sub" + suffix, [size](BenchmarkContext& ctx) {
+            std::mt19937 rng(5);
+            const std::vector<double> a = randomVector(rng, size);
+            const std::vector<double> b = randomVector(rng, size);
+            ctx.setBytesPerOp(3.0 * size * sizeof(double));
+            ctx.run([&] { doNotOptimize(sub(a, b)[0]); });
+        });
+
+        registerBenchmark("axpy" + suffix, [size](BenchmarkContext& ctx) {
+            std::mt19937 rng(6);
+            const std::vector<double> x = randomVector(rng, size);
+            std::vector<double> y = randomVector(rng, size);
+            ctx.setBytesPerOp(3.0 * size * sizeof(double));
+            ctx.run([&] {
+                axpy(1e-9, x, y);
+                doNotOptimize(y[0]);
+            });
+        });
+    }
+}
+
+void registerGramSchmidtBenchmarks() {
+    // n本のn次元ベクトルを正規直交化する
+    for (size_t n : {4u, 16u, 64u, 256u}) {
+        for (bool parallel : {false, true}) {
+            const std::string name = parallel ? "gram_schmidt_parallel/" : "gram_schmidt/";
+            registerBenchmark(name + std::to_string(n), [n, parallel](BenchmarkContext& ctx) {
+                std::mt19937 rng(3);
+                std::vector<std::vector<double>> source(n);
+                for (auto& v : source) {
+                    v = randomVector(rng, n);
+                }
+                // 形が同じなので、代入は確保をせずに値だけコピーする
+                std::vector<std::vector<double>> work = source;
+                // 内側のループは2本のベクトルを読み1本を書く
+                ctx.setBytesPerOp(static_cast<double>(n * (n - 1) / 2) * 3.0 * n * sizeof(double));
+                ctx.run([&] {
+                    work = source;
+                    if (parallel) {
+                        gram_schmidt_normalization_parallel(work);
+                    } else {
+                        gram_schmidt_normalization(work);
+                    }
+                    doNotOptimize(work[n - 1][0]);
+                });
+            });
+        }
+    }
+}
+
+// n x nの格子の5点ラプラシアン (対称正定値)
+SparseMatrix gridLaplacian(size_t n) {
+    std::vector<Triplet> triplets;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            const size_t r = i * n + j;
+            triplets.push_back(Triplet{r, r, 4.0});
+            if (i > 0) triplets.push_back(Triplet{r, r - n, -1.0});
+            if (i + 1 < n) triplets.push_back(Triplet{r, r + n, -1.0});
+            if (j > 0) triplets.push_back(Triplet{r, r - 1, -1.0});
+            if (j + 1 < n) triplets.push_back(Triplet{r, r + 1, -1.0});
+        }
+    }
+    return SparseMatrix::fromTriplets(n * n, n * n, triplets);
+}
+
+void registerSparseBenchmarks() {
+    for (size_t n : {64u, 512u}) {
+        for (bool parallel : {false, true}) {
+            const std::string name = parallel ? "spmv_parallel/" : "spmv/";
+            registerBenchmark(name + std::to_string(n * n), [n, parallel](BenchmarkContext& ctx) {
+                const SparseMatrix a = gridLaplacian(n);
+                std::mt19937 rng(7);
+                const std::vector<double> x = randomVector(rng, a.cols());
+                std::vector<double> y(a.rows());
+                // 値・列番号・xを1回ずつ読み、yを書く
+                ctx.setBytesPerOp(a.nonZeros() * (sizeof(double) * 2 + sizeof(size_t)) + a.rows() * sizeof(double));
+                ctx.run([&] {
+                    if (parallel) {
+                        a.multiply(x, y, JobSystem::instance());
+                    } else {
+                        a.multiply(x, y);
+                    }
+                    doNotOptimize(y[0]);
+                });
+            });
+        }
+    }
+
+    for (Preconditioner preconditioner : {Preconditioner::Jacobi, Preconditioner::IncompleteCholesky}) {
+        const std::string name = preconditioner == Preconditioner::Jacobi ? "cg_jacobi/" : "cg_ic0/";
+        registerBenchmark(name + std::to_string(128 * 128), [preconditioner](BenchmarkContext& ctx) {
+            const SparseMatrix a = gridLaplacian(128);
+            std::mt19937 rng(8);
+            const std::vector<double> b = randomVector(rng, a.rows());
+            std::vector<double> x;
+            ConjugateGradientOptions options;
+            options.preconditioner = preconditioner;
+            options.tolerance = 1e-6;
+            ctx.run([&] {
+                x.clear();
+                doNotOptimize(conjugateGradient(a, b, x, options).iterations);
+            });
+        });
+    }
+}
+
+std::vector<Vector3> randomPoints(std::mt19937& rng, size_t count, float extent) {
+    std::uniform_real_distribution<float> dist(-extent, extent);
+    std::vector<Vector3> points(count);
+    for (Vector3& p : points) {
+        p = Vector3(dist(rng), dist(rng), dist(rng));
+    }
+    return points;
+}
+
+void registerSpatialBenchmarks() {
+    // 平均して1セルに1点ほどの密度にする
+    for (size_t count : {65536u, 1048576u}) {
+        const float extent = 0.5f * std::cbrt(static_cast<float>(count));
+        const std::string suffix = "/" + std::to_string(count);
+
+        registerBenchmark("kdtree_build" + suffix, [count, extent](BenchmarkContext& ctx) {
+            std::mt19937 rng(9);
+            const std::vector<Vector3> points = randomPoints(rng, count, extent);
+            ctx.run([&] {
+                KdTree tree(points);
+                doNotOptimize(tree.size());
+            });
+        });
+
+        registerBenchmark("kdtree_knn8_batch" + suffix, [count, extent](BenchmarkContext& ctx) {
+            std::mt19937 rng(10);
+            const KdTree tree(randomPoints(rng, count, extent));
+            const std::vector<Vector3> queries = randomPoints(rng, 16384, extent);
+            std::vector<Neighbor> result;
+            ctx.run([&] {
+                tree.knnBatch(queries.data(), queries.size(), 8, result);
+                doNotOptimize(result[0]);
+            });
+        });
+
+        registerBenchmark("hash_grid_knn8_batch" + suffix, [count, extent](BenchmarkContext& ctx) {
+            std::mt19937 rng(10);
+            const std::vector<Vector3> points = randomPoints(rng, count, extent);
+            SpatialHashGrid grid(1.0f);
+            grid.rebuild(points.data(), points.size());
+            const std::vector<Vector3> queries = randomPoints(rng, 16384, extent);
+            std::vector<Neighbor> result;
+            ctx.run([&] {
+                grid.knnBatch(queries.data(), queries.size(), 8, result);
+                doNotOptimize(result[0]);
+            });
+        });
+    }
+}
+
+void registerConvexHullBenchmarks() {
+    // 立方体の中の一様な点 (凸包の頂点は少ない) と球面上の点 (すべてが凸包の頂点)
+    for (bool sphere : {false, true}) {
+        const std::string name = sphere ? "quickhull_sphere/" : "quickhull_cube/";
+        for (size_t count : {4096u, 262144u}) {
+            if (sphere && count > 65536) {
+                continue;
+            }
+            registerBenchmark(name + std::to_string(count), [count, sphere](BenchmarkContext& ctx) {
+                std::mt19937 rng(11);
+                std::vector<Vector3> points = randomPoints(rng, count, 1.0f);
+                if (sphere) {
+                    for (Vector3& p : points) {
+                        p = p.normalize();
+                    }
+                }
+                ctx.run([&] {
+                    ConvexHull hull = quickhull(points);
+                    doNotOptimize(hull.indices.size());
+                });
+            });
+        }
+    }
+
+    registerBenchmark("quickhull_batch/256x1024", [](BenchmarkContext& ctx) {
+        std::mt19937 rng(12);
+        std::vector<std::vector<Vector3>> sets(256);
+        for (auto& set : sets) {
+            set = randomPoints(rng, 1024, 1.0f);
+        }
+        std::vector<ConvexHull> hulls;
+        ctx.run([&] {
+            quickhullBatch(sets, hulls);
+            doNotOptimize(hulls[0].indices.size());
+        });
+    });
+}
+
+void registerMortonBenchmarks() {
+    for (size_t count : {65536u, 1048576u}) {
+        for (bool wide : {false, true}) {
+            const std::string name = wide ? "morton_order63/" : "morton_order30/";
+            registerBenchmark(name + std::to_string(count), [count, wide](BenchmarkContext& ctx) {
+                std::mt19937 rng(13);
+                const std::vector<Vector3> points = randomPoints(rng, count, 1.0f);
+                std::vector<uint32_t> order;
+                const MortonPrecision precision = wide ? MortonPrecision::Bits63 : MortonPrecision::Bits30;
+                ctx.run([&] {
+                    mortonOrder(points.data(), points.size(), order, precision);
+                    doNotOptimize(order[0]);
+                });
+            });
+        }
+
+        // 三角形1つ分 (float 9個) を単位にその場で並べ替える
+        registerBenchmark("permute_in_place/" + std::to_string(count), [count](BenchmarkContext& ctx) {
+            std::mt19937 rng(14);
+            const std::vector<Vector3> points = randomPoints(rng, count, 1.0f);
+            std::vector<uint32_t> order;
+            mortonOrder(points.data(), points.size(), order);
+            std::vector<float> triangles(count * 9, 1.0f);
+            ctx.setBytesPerOp(2.0 * triangles.size() * sizeof(float));
+            ctx.run([&] {
+                permuteInPlace(triangles.data(), 9, order.data(), count);
+                doNotOptimize(triangles[0]);
+            });
+        });
+    }
+}
+
+std::vector<Matrix3> randomMatrices3(std::mt19937& rng, size_t count) {
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<Matrix3> matrices(count);
+    for (Matrix3& a : matrices) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                a.m[i][j] = dist(rng);
+            }
+        }
+    }
+    return matrices;
+}
+
+void registerSvdBenchmarks() {
+    for (size_t count : {1024u, 65536u, 1048576u}) {
+        registerBenchmark("svd3_batch/" + std::to_string(count), [count](BenchmarkContext& ctx) {
+            std::mt19937 rng(15);
+            const std::vector<Matrix3> matrices = randomMatrices3(rng, count);
+            std::vector<Svd3> out(count);
+            ctx.run([&] {
+                svd3Batch(matrices.data(), count, out.data());
+                doNotOptimize(out[count - 1].sigma);
+            });
+        });
+
+        registerBenchmark("polar_batch/" + std::to_string(count), [count](BenchmarkContext& ctx) {
+            std::mt19937 rng(15);
+            const std::vector<Matrix3> matrices = randomMatrices3(rng, count);
+            std::vector<Matrix3> rotations(count);
+            ctx.run([&] {
+                polarDecompositionBatch(matrices.data(), count, rotations.data(), nullptr);
+                doNotOptimize(rotations[count - 1]);
+            });
+        });
+    }
+}
+
+Matrix4 sampleMatrix() {
+    return Matrix4(0.36f, 0.48f, -0.8f, 1.0f,
+                   -0.8f, 0.6f, 0.0f, 2.0f,
+                   0.48f, 0.64f, 0.6f, 3.0f,
+                   0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void registerMatrixBenchmarks() {
+    registerBenchmark("matrix4_multiply", [](BenchmarkContext& ctx) {
+        Matrix4 a = sampleMatrix();
+        const Matrix4 b = sampleMatrix().transpose();
+        ctx.setBytesPerOp(3.0 * sizeof(float) * 16);
+        ctx.run([&] {
+            a = a * b;
+            doNotOptimize(a);
+        });
+    });
+
+    for (size_t count : {1024u, 65536u, 1048576u}) {
+        registerBenchmark("matrix4_transform/" + std::to_string(count), [count](BenchmarkContext& ctx) {
+            std::mt19937 rng(4);
+            std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+            std::vector<Vector3> points(count);
+            for (Vector3& p : points) {
+                p = Vector3(dist(rng), dist(rng), dist(rng));
+            }
+            std::vector<Vector3> transformed(count);
+            const Matrix4 m = sampleMatrix();
+            ctx.setBytesPerOp(2.0 * count * sizeof(Vector3));
+            ctx.run([&] {
+                for (size_t i = 0; i < count; ++i) {
+                    transformed[i] = m.multiply(points[i]);
+                }
+                doNotOptimize(transformed[count - 1]);
+            });
+        });
+
+        for (bool parallel : {false, true}) {
+            const std::string name = parallel ? "transform_points_parallel/" : "transform_points/";
+            registerBenchmark(name + std::to_string(count), [count, parallel](BenchmarkContext& ctx) {
+                std::mt19937 rng(4);
+                std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+                std::vector<Vector3> points(count);
+                for (Vector3& p : points) {
+                    p = Vector3(dist(rng), dist(rng), dist(rng));
+                }
+                std::vector<Vector3> transformed(count);
+                const Matrix4 m = sampleMatrix();
+                ctx.setBytesPerOp(2.0 * count * sizeof(Vector3));
+                ctx.run([&] {
+                    if (parallel) {
+                        transformPoints(m, points.data(), transformed.data(), count, JobSystem::instance());
+                    } else {
+                        transformPoints(m, points.data(), transformed.data(), count);
+                    }
+                    doNotOptimize(transformed[count - 1]);
+                });
+            });
+        }
+    }
+}
+
+#ifdef GEOALGO_HAS_GLM
+void registerQuaternionBenchmarks() {
+    const Quaternion q1(0.7f, glm::vec3(0.0f, 0.6f, 0.8f));
+    const Quaternion q2(1.3f, glm::vec3(0.8f, 0.0f, 0.6f));
+
+    registerBenchmark("quaternion_multiply", [q1, q2](BenchmarkContext& ctx) {
+        Quaternion q = q1;
+        ctx.run([&] {
+            q = q * q2;
+            q.normalize();
+            doNotOptimize(q);
+        });
+    });
+
+    registerBenchmark("quaternion_to_matrix", [q1](BenchmarkContext& ctx) {
+        Quaternion q = q1;
+        ctx.run([&] {
+            glm::mat4 m = q.toMatrix();
+            doNotOptimize(m);
+            q.x += 1e-7f;
+        });
+    });
+
+    registerBenchmark("quaternion_lerp", [q1, q2](BenchmarkContext& ctx) {
+        float t = 0.0f;
+        ctx.run([&] {
+            Quaternion q = Quaternion::lerp(q1, q2, t);
+            doNotOptimize(q);
+            t = t < 1.0f ? t + 1e-3f : 0.0f;
+        });
+    });
+
+    registerBenchmark("quaternion_inverse", [q1](BenchmarkContext& ctx) {
+        Quaternion q = q1;
+        ctx.run([&] {
+            q = inverse(q);
+            doNotOptimize(q);
+        });
+    });
+}
+
+void registerKabschBenchmarks() {
+    // ICPの1反復分 (対応点の共分散とSVD)
+    for (size_t count : {1024u, 65536u, 1048576u}) {
+        registerBenchmark("kabsch/" + std::to_string(count), [count](BenchmarkContext& ctx) {
+            std::mt19937 rng(16);
+            const std::vector<Vector3> source = randomPoints(rng, count, 1.0f);
+            const std::vector<Vector3> target = randomPoints(rng, count, 1.0f);
+            ctx.setBytesPerOp(2.0 * count * sizeof(Vector3));
+            ctx.run([&] {
+                RigidTransform transform = kabsch(source.data(), target.data(), count);
+                doNotOptimize(transform.translation);
+            });
+        });
+    }
+
+    // 多数の小さな組の位置合わせ (共分散は求めてある)
+    registerBenchmark("kabsch_batch/65536", [](BenchmarkContext& ctx) {
+        std::mt19937 rng(17);
+        const std::vector<Matrix3> matrices = randomMatrices3(rng, 65536);
+        std::vector<PointCovariance> covariances(matrices.size());
+        for (size_t i = 0; i < matrices.size(); ++i) {
+            covariances[i].covariance = matrices[i];
+            covariances[i].count = 16;
+        }
+        std::vector<RigidTransform> out(matrices.size());
+        ctx.run([&] {
+            kabschBatch(covariances.data(), covariances.size(), out.data());
+            doNotOptimize(out.back().translation);
+        });
+    });
+}
+#endif
+
+} // namespace
+
+void registerMathBenchmarks() {
+    registerVectorBenchmarks();
+    registerGramSchmidtBenchmarks();
+    registerSparseBenchmarks();
+    registerSpatialBenchmarks();
+    registerConvexHullBenchmarks();
+    registerMortonBenchmarks();
+    registerSvdBenchmarks();
+    registerMatrixBenchmarks();
+#ifdef GEOALGO_HAS_GLM
+    registerQuaternionBenchmarks();
+    registerKabschBenchmarks();
+#endif
+}
@@ -0,0 +1,155 @@
+#include "benchmark.h"
+#include "headless_gl_context.h"
+#include "MeshAttributes.h"
+#include "Polygon3D.h"
+#include "PrimitiveStage.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace {
+
+// ベンチマーク全体で1つのコンテキストを使い回す
+HeadlessGLContext& glContext() {
+    static HeadlessGLContext context;
+    static bool created = false;
+    if (!created) {
+        created = true;
+        if (context.create()) {
+            std::cout << "GL renderer: " << context.getRenderer() << "\n";
+        } else {
+            std::cout << "Pipeline benchmarks skipped: " << context.getError() << "\n";
+        }
+    }
+    return context;
+}
+
+// 三角形数trianglesのランダムなメッシュ (頂点と色)
+void randomMesh(size_t triangles, std::vector<GLfloat>& vertices, std::vector<GLfloat>& colors) {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> color(0.0f, 1.0f);
+    vertices.resize(triangles * 9);
+    colors.resize(triangles * 9);
+    for (GLfloat& v : vertices) {
+        v = position(rng);
+    }
+    for (GLfloat& c : colors) {
+        c = color(rng);
+    }
+}
+
+void registerUpload(const std::string& name, size_t triangles, const VertexFormat& format) {
+    registerBenchmark(name + "/" + std::to_string(triangles), [triangles, format](BenchmarkContext& ctx) {
+        if (!glContext().isValid()) {
+            return;
+        }
+        std::vector<GLfloat> vertices;
+        std::vector<GLfloat> colors;
+        randomMesh(triangles, vertices, colors);
+        Polygon3D polygon(vertices, colors);
+        polygon.setVertexFormat(format);
+
+        // setVerticesは位置と色の両方を再アップロードする
+        ctx.setBytesPerOp(static_cast<double>(vertices.size() + colors.size()) * sizeof(GLfloat));
+        ctx.run([&] {
+            // 値を変えてドライバが転送を省略できないようにする
+            vertices[0] += 1e-6f;
+            polygon.setVertices(vertices);
+            // 転送の完了までを測る
+            glFinish();
+        });
+    });
+}
+
+} // namespace
+
+// side x sideの格子を波打たせたメッシュ (変形メッシュの1フレーム分)
+IndexedMesh waveGrid(size_t side) {
+    IndexedMesh mesh;
+    mesh.positions.reserve(side * side * 3);
+    for (size_t i = 0; i < side; ++i) {
+        for (size_t j = 0; j < side; ++j) {
+            const float x = static_cast<float>(i) / side;
+            const float y = static_cast<float>(j) / side;
+            mesh.positions.insert(mesh.positions.end(), {x, y, 0.05f * std::sin(20.0f * x) * std::cos(15.0f * y)});
+        }
+    }
+    for (size_t i = 0; i + 1 < side; ++i) {
+        for (size_t j = 0; j + 1 < side; ++j) {
+            const GLuint a = static_cast<GLuint>(i * side + j);
+            const GLuint b = a + 1;
+            const GLuint c = a + static_cast<GLuint>(side);
+            const GLuint d = c + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, c, b, b, c, d});
+        }
+    }
+    return mesh;
+}
+
+void registerPipelineBenchmarks() {
+    VertexFormat compact;
+    compact.position = PositionFormat::Snorm16;
+    compact.color = ColorFormat::Unorm8;
+
+    for (size_t triangles : {1024u, 65536u}) {
+        registerUpload("polygon3d_set_vertices", triangles, VertexFormat());
+        registerUpload("polygon3d_set_vertices_snorm16", triangles, compact);
+
+        registerBenchmark("polygon3d_mesh_view/" + std::to_string(triangles), [triangles](BenchmarkContext& ctx) {
+            if (!glContext().isValid()) {
+                return;
+            }
+            std::vector<GLfloat> vertices;
+            std::vector<GLfloat> colors;
+            randomMesh(triangles, vertices, colors);
+            MeshView view;
+            view.vertices = vertices.data();
+            view.vertexCount = vertices.size();
+            view.colors = colors.data();
+            view.colorCount = colors.size();
+
+            // バッファの生成・アップロード・破棄まで (CPU側のコピーは作らない)
+            ctx.setBytesPerOp(static_cast<double>(vertices.size() + colors.size()) * sizeof(GLfloat));
+            ctx.run([&] {
+                Polygon3D polygon(view);
+                glFinish();
+            });
+        });
+
+        for (bool angle : {false, true}) {
+            const std::string name = angle ? "mesh_normals_angle/" : "mesh_normals_area/";
+            registerBenchmark(name + std::to_string(triangles), [triangles, angle](BenchmarkContext& ctx) {
+                const IndexedMesh mesh = waveGrid(static_cast<size_t>(std::sqrt(triangles / 2.0)) + 1);
+                MeshAttributes attributes(mesh);
+                std::vector<GLfloat> normals;
+                const NormalWeighting weighting = angle ? NormalWeighting::Angle : NormalWeighting::Area;
+                ctx.run([&] {
+                    attributes.computeNormals(mesh, normals, weighting);
+                });
+            });
+        }
+
+        // カリングとクリップだけ (GLは使わない)。メッシュの中にニア面が来るようにして、切る三角形も出す
+        registerBenchmark("primitive_stage/" + std::to_string(triangles), [triangles](BenchmarkContext& ctx) {
+            std::vector<GLfloat> vertices;
+            std::vector<GLfloat> colors;
+            randomMesh(triangles, vertices, colors);
+            const float zNear = 0.1f;
+            const float zFar = 10.0f;
+            // 透視投影 * z方向に-0.5の平行移動
+            const float a = -(zFar + zNear) / (zFar - zNear);
+            const float b = -2 * zFar * zNear / (zFar - zNear);
+            const Matrix4 mvp(1, 0, 0, 0,
+                              0, 1, 0, 0,
+                              0, 0, a, b - 0.5f * a,
+                              0, 0, -1, 0.5f);
+            PrimitiveStage stage;
+            PrimitiveBatch batch;
+            ctx.setBytesPerOp(static_cast<double>(vertices.size() + colors.size()) * sizeof(GLfloat));
+            ctx.run([&] {
+                stage.process(vertices.data(), colors.data(), vertices.size(), mvp, batch);
+            });
+        });
+    }
+}
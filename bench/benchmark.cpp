@@ -0,0 +1,111 @@
+#include "benchmark.h"
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+struct RegisteredBenchmark {
+    std::string name;
+    BenchmarkFunction function;
+};
+
+std::vector<RegisteredBenchmark>& registry() {
+    static std::vector<RegisteredBenchmark> benchmarks;
+    return benchmarks;
+}
+
+std::string compilerName() {
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+bool writeJson(const std::string& path, const std::vector<BenchmarkResult>& results,
+               const BenchmarkOptions& options) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    out << "{\n  \"context\": {\n    \"date\": ";
+    writeJsonString(out, date);
+    out << ",\n    \"compiler\": ";
+    writeJsonString(out, compilerName());
+#ifdef NDEBUG
+    out << ",\n    \"build\": \"release\"";
+#else
+    out << ",\n    \"build\": \"debug\"";
+#endif
+    out << ",\n    \"min_seconds\": " << options.minSeconds
+        << ",\n    \"repetitions\": " << options.repetitions << "\n  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        writeJsonString(out, r.name);
+        out << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.nsPerOp
+            << ", \"gb_per_s\": " << r.gbPerSecond
+            << ", \"allocs_per_op\": " << r.allocsPerOp
+            << ", \"alloc_bytes_per_op\": " << r.allocBytesPerOp << "}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+void registerBenchmark(const std::string& name, BenchmarkFunction function) {
+    registry().push_back(RegisteredBenchmark{name, std::move(function)});
+}
+
+int runBenchmarks(const BenchmarkOptions& options) {
+    std::vector<BenchmarkResult> results;
+    std::printf("%-40s %14s %12s %10s %12s %14s\n",
+                "benchmark", "iterations", "ns/op", "GB/s", "allocs/op", "alloc B/op");
+    for (const RegisteredBenchmark& benchmark : registry()) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        BenchmarkContext context(options.minSeconds, options.repetitions);
+        benchmark.function(context);
+        if (!context.hasResult()) {
+            std::printf("%-40s skipped\n", benchmark.name.c_str());
+            continue;
+        }
+        BenchmarkResult result = context.result();
+        result.name = benchmark.name;
+        std::printf("%-40s %14llu %12.2f %10.3f %12.2f %14.1f\n",
+                    result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+                    result.nsPerOp, result.gbPerSecond, result.allocsPerOp, result.allocBytesPerOp);
+        std::fflush(stdout);
+        results.push_back(result);
+    }
+
+    if (!options.jsonPath.empty() && !writeJson(options.jsonPath, results, options)) {
+        std::cerr << "Failed to write " << options.jsonPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 小さなベンチマークハーネス
+// ns/op、GB/s、1回あたりのヒープ確保回数とバイト数を測り、JSONでも出力する
+
+// alloc_counter.cppのoperator newが数えている値
+struct AllocationStats {
+    uint64_t count;
+    uint64_t bytes;
+};
+AllocationStats allocationStats() noexcept;
+
+// 最適化で計算が消されないようにする
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+    (void)*sink;
+#endif
+}
+
+struct BenchmarkResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0.0;
+    double gbPerSecond = 0.0;   // バイト数が指定されていなければ0
+    double allocsPerOp = 0.0;
+    double allocBytesPerOp = 0.0;
+};
+
+class BenchmarkContext {
+public:
+    BenchmarkContext(double minSeconds, int repetitions)
+        : minSeconds_(minSeconds), repetitions_(repetitions > 0 ? repetitions : 1) {}
+
+    // 1回の操作で読み書きするバイト数 (GB/sの計算用)
+    void setBytesPerOp(double bytes) { bytesPerOp_ = bytes; }
+
+    // opを繰り返し実行して計測する
+    // 反復回数はminSecondsを超えるまで増やし、その回数でrepetitions回測った最小値を採る
+    template <typename Op>
+    void run(Op&& op) {
+        op(); // ウォームアップ
+        uint64_t iterations = 1;
+        double seconds = measure(op, iterations, nullptr);
+        while (seconds < minSeconds_ && iterations < (1ull << 40)) {
+            double scale = seconds > 0.0 ? minSeconds_ * 1.2 / seconds : 100.0;
+            scale = scale < 2.0 ? 2.0 : (scale > 100.0 ? 100.0 : scale);
+            iterations = static_cast<uint64_t>(static_cast<double>(iterations) * scale);
+            seconds = measure(op, iterations, nullptr);
+        }
+
+        double best = 0.0;
+        AllocationStats allocs = {0, 0};
+        for (int r = 0; r < repetitions_; ++r) {
+            AllocationStats repAllocs = {0, 0};
+            double s = measure(op, iterations, &repAllocs);
+            if (r == 0 || s < best) {
+                best = s;
+                allocs = repAllocs;
+            }
+        }
+
+        const double n = static_cast<double>(iterations);
+        result_.iterations = iterations;
+        result_.nsPerOp = best * 1e9 / n;
+        result_.gbPerSecond = bytesPerOp_ > 0.0 ? bytesPerOp_ * n / best / 1e9 : 0.0;
+        result_.allocsPerOp = static_cast<double>(allocs.count) / n;
+        result_.allocBytesPerOp = static_cast<double>(allocs.bytes) / n;
+        ran_ = true;
+    }
+
+    bool hasResult() const { return ran_; }
+    const BenchmarkResult& result() const { return result_; }
+    BenchmarkResult& result() { return result_; }
+
+private:
+    template <typename Op>
+    static double measure(Op& op, uint64_t iterations, AllocationStats* outAllocs) {
+        const AllocationStats before = allocationStats();
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        if (outAllocs) {
+            const AllocationStats after = allocationStats();
+            outAllocs->count = after.count - before.count;
+            outAllocs->bytes = after.bytes - before.bytes;
+        }
+        return std::chrono::duration<double>(end - start).count();
+    }
+
+    double minSeconds_;
+    int repetitions_;
+    double bytesPerOp_ = 0.0;
+    bool ran_ = false;
+    BenchmarkResult result_;
+};
+
+using BenchmarkFunction = std::function<void(BenchmarkContext&)>;
+
+// ベンチマークを名前付きで登録する (名前は"group/size"の形にする)
+void registerBenchmark(const std::string& name, BenchmarkFunction function);
+
+struct BenchmarkOptions {
+    std::string filter;      // 名前にこの文字列を含むものだけ実行する
+    std::string jsonPath;    // 空ならJSONを書かない
+    double minSeconds = 0.2;
+    int repetitions = 3;
+};
+
+// 登録されたベンチマークを実行し、表とJSONを出力する
+int runBenchmarks(const BenchmarkOptions& options);
+
+// 各ファイルの登録関数
+void registerMathBenchmarks();
+#ifdef GEOALGO_BENCH_PIPELINE
+void registerPipelineBenchmarks();
+#endif
+
+#endif // BENCHMARK_H
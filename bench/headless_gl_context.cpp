@@ -0,0 +1,103 @@
+#include "headless_gl_context.h"
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+
+namespace {
+
+// ディスプレイが無い環境でも使えるsurfacelessプラットフォームを優先する
+EGLDisplay openDisplay() {
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) {
+                return display;
+            }
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+} // namespace
+
+HeadlessGLContext::HeadlessGLContext()
+    : display_(EGL_NO_DISPLAY), surface_(EGL_NO_SURFACE), context_(EGL_NO_CONTEXT) {}
+
+HeadlessGLContext::~HeadlessGLContext() {
+    if (display_ != EGL_NO_DISPLAY) {
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context_ != EGL_NO_CONTEXT) {
+            eglDestroyContext(display_, context_);
+        }
+        if (surface_ != EGL_NO_SURFACE) {
+            eglDestroySurface(display_, surface_);
+        }
+        eglTerminate(display_);
+    }
+}
+
+bool HeadlessGLContext::create() {
+    display_ = openDisplay();
+    if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+        display_ = EGL_NO_DISPLAY;
+        error_ = "eglInitialize failed";
+        return false;
+    }
+    // Polygon3Dは固定機能パイプラインを使うので、デスクトップGLの互換プロファイルにする
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        error_ = "desktop OpenGL is not available through EGL";
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display_, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        error_ = "no pbuffer config with desktop OpenGL";
+        return false;
+    }
+
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, 64, EGL_HEIGHT, 64, EGL_NONE};
+    surface_ = eglCreatePbufferSurface(display_, config, surfaceAttributes);
+    if (surface_ == EGL_NO_SURFACE) {
+        error_ = "eglCreatePbufferSurface failed";
+        return false;
+    }
+    context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, nullptr);
+    if (context_ == EGL_NO_CONTEXT) {
+        error_ = "eglCreateContext failed";
+        return false;
+    }
+    if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+        error_ = "eglMakeCurrent failed";
+        return false;
+    }
+
+    // GLX向けにビルドされたGLEWはGLXの初期化で失敗を返すが、GLの関数はその前に読み込まれている
+    glewExperimental = GL_TRUE;
+    const GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+        && glewStatus != GLEW_ERROR_NO_GLX_DISPLAY
+#endif
+    ) {
+        error_ = "glewInit failed";
+        return false;
+    }
+    return true;
+}
+
+std::string HeadlessGLContext::getRenderer() const {
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    return renderer ? reinterpret_cast<const char*>(renderer) : "unknown";
+}
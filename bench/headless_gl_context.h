@@ -0,0 +1,29 @@
+#ifndef HEADLESS_GL_CONTEXT_H
+#define HEADLESS_GL_CONTEXT_H
+
+#include <string>
+
+// ウィンドウを作らずにOpenGLのコンテキストを作る (EGLのpbuffer)
+// Mesaのソフトウェアレンダラでも動くので、CIでもPolygon3Dのベンチマークが取れる
+class HeadlessGLContext {
+public:
+    HeadlessGLContext();
+    ~HeadlessGLContext();
+    HeadlessGLContext(const HeadlessGLContext&) = delete;
+    HeadlessGLContext& operator=(const HeadlessGLContext&) = delete;
+
+    // 作成してカレントにする。失敗したらfalseを返し、getError()に理由を残す
+    bool create();
+    bool isValid() const noexcept { return context_ != nullptr; }
+    const std::string& getError() const noexcept { return error_; }
+    // GL_RENDERERの文字列
+    std::string getRenderer() const;
+
+private:
+    void* display_;
+    void* surface_;
+    void* context_;
+    std::string error_;
+};
+
+#endif // HEADLESS_GL_CONTEXT_H
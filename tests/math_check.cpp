@@ -0,0 +1,368 @@
+// Mathの高速な実装を、同じ問題を総当たり (密な消去法・全点の走査・素朴なビット操作) で解いた結果と比べる
+#include "Math/conjugate_gradient.h"
+#include "Math/convex_hull.h"
+#include "Math/geometric_predicates.h"
+#include "Math/kd_tree.h"
+#include "Math/morton.h"
+#include "Math/sparse_matrix.h"
+#include "Math/spatial_hash_grid.h"
+#include "Math/svd3.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::printf("FAIL %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+// ---- 共役勾配法 ----
+
+// 2次元格子のラプラシアンに対角を足した対称正定値行列 (side * side 行)
+SparseMatrix gridMatrix(size_t side, double shift) {
+    std::vector<Triplet> triplets;
+    for (size_t y = 0; y < side; ++y) {
+        for (size_t x = 0; x < side; ++x) {
+            const size_t i = y * side + x;
+            triplets.push_back({i, i, 4.0 + shift});
+            if (x + 1 < side) {
+                triplets.push_back({i, i + 1, -1.0});
+                triplets.push_back({i + 1, i, -1.0});
+            }
+            if (y + 1 < side) {
+                triplets.push_back({i, i + side, -1.0});
+                triplets.push_back({i + side, i, -1.0});
+            }
+        }
+    }
+    return SparseMatrix::fromTriplets(side * side, side * side, triplets);
+}
+
+// 部分ピボット付きのガウスの消去法で密に解く
+std::vector<double> denseSolve(const SparseMatrix& a, const std::vector<double>& b) {
+    const size_t n = a.rows();
+    std::vector<std::vector<double>> m(n, std::vector<double>(n + 1, 0.0));
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            m[i][j] = a.coeff(i, j);
+        }
+        m[i][n] = b[i];
+    }
+    for (size_t col = 0; col < n; ++col) {
+        size_t pivot = col;
+        for (size_t row = col + 1; row < n; ++row) {
+            if (std::fabs(m[row][col]) > std::fabs(m[pivot][col])) {
+                pivot = row;
+            }
+        }
+        std::swap(m[pivot], m[col]);
+        for (size_t row = col + 1; row < n; ++row) {
+            const double f = m[row][col] / m[col][col];
+            for (size_t j = col; j <= n; ++j) {
+                m[row][j] -= f * m[col][j];
+            }
+        }
+    }
+    std::vector<double> x(n);
+    for (size_t i = n; i-- > 0;) {
+        double sum = m[i][n];
+        for (size_t j = i + 1; j < n; ++j) {
+            sum -= m[i][j] * x[j];
+        }
+        x[i] = sum / m[i][i];
+    }
+    return x;
+}
+
+double maxDifference(const std::vector<double>& a, const std::vector<double>& b) {
+    double difference = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        difference = std::max(difference, std::fabs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+void checkConjugateGradient(std::mt19937& rng) {
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    const SparseMatrix a = gridMatrix(12, 0.1);
+    std::vector<double> b(a.rows());
+    for (double& v : b) {
+        v = uniform(rng);
+    }
+    const std::vector<double> expected = denseSolve(a, b);
+    const BlockSparseMatrix block = BlockSparseMatrix::fromCsr(a, 3);
+
+    JobSystem jobs(2);
+    for (Preconditioner preconditioner :
+         {Preconditioner::None, Preconditioner::Jacobi, Preconditioner::IncompleteCholesky}) {
+        for (bool parallel : {false, true}) {
+            ConjugateGradientOptions options;
+            options.tolerance = 1e-12;
+            options.preconditioner = preconditioner;
+            options.jobs = parallel ? &jobs : nullptr;
+            const std::string name = "CG preconditioner " + std::to_string(static_cast<int>(preconditioner)) +
+                                     (parallel ? " parallel" : "");
+
+            std::vector<double> x;
+            ConjugateGradientResult result = conjugateGradient(a, b, x, options);
+            check(result.converged && maxDifference(x, expected) < 1e-9, name + " (CSR)");
+
+            std::vector<double> y;
+            result = conjugateGradient(block, b, y, options);
+            check(result.converged && maxDifference(y, expected) < 1e-9, name + " (BSR)");
+        }
+    }
+
+    // 三重対角行列ではIC(0)が完全なコレスキー分解になるので、1回の反復で解ける
+    std::vector<Triplet> triplets;
+    const size_t n = 50;
+    for (size_t i = 0; i < n; ++i) {
+        triplets.push_back({i, i, 2.5});
+        if (i + 1 < n) {
+            triplets.push_back({i, i + 1, -1.0});
+            triplets.push_back({i + 1, i, -1.0});
+        }
+    }
+    const SparseMatrix tridiagonal = SparseMatrix::fromTriplets(n, n, triplets);
+    std::vector<double> c(n);
+    for (double& v : c) {
+        v = uniform(rng);
+    }
+    ConjugateGradientOptions options;
+    options.tolerance = 1e-10;
+    options.preconditioner = Preconditioner::IncompleteCholesky;
+    std::vector<double> x;
+    const ConjugateGradientResult result = conjugateGradient(tridiagonal, c, x, options);
+    check(result.converged && result.iterations <= 1 && maxDifference(x, denseSolve(tridiagonal, c)) < 1e-9,
+          "IC(0) is exact on a tridiagonal matrix");
+}
+
+// ---- 近傍探索 ----
+
+float distanceSquared(const Vector3& a, const Vector3& b) {
+    const float dx = a.x - b.x;
+    const float dy = a.y - b.y;
+    const float dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// 全点を走査したときの、近い順の距離
+std::vector<float> bruteDistances(const std::vector<Vector3>& points, const Vector3& query) {
+    std::vector<float> distances;
+    for (const Vector3& p : points) {
+        distances.push_back(distanceSquared(p, query));
+    }
+    std::sort(distances.begin(), distances.end());
+    return distances;
+}
+
+void checkNeighbors(std::mt19937& rng) {
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<Vector3> points(2000);
+    for (Vector3& p : points) {
+        p = Vector3(uniform(rng), uniform(rng), uniform(rng));
+    }
+    const KdTree tree(points);
+    SpatialHashGrid grid(0.2f);
+    grid.rebuild(points.data(), points.size());
+
+    const size_t k = 8;
+    const float radius = 0.25f;
+    std::vector<Neighbor> found;
+    for (int q = 0; q < 50; ++q) {
+        // 一部のクエリは点群の外に置く
+        const float spread = q % 5 == 0 ? 4.0f : 1.0f;
+        const Vector3 query(uniform(rng) * spread, uniform(rng) * spread, uniform(rng) * spread);
+        const std::vector<float> expected = bruteDistances(points, query);
+        const size_t inRadius = static_cast<size_t>(
+            std::upper_bound(expected.begin(), expected.end(), radius * radius) - expected.begin());
+
+        tree.knn(query, k, found);
+        bool same = found.size() == k;
+        for (size_t i = 0; same && i < k; ++i) {
+            same = found[i].distanceSquared == expected[i] &&
+                   distanceSquared(points[found[i].index], query) == expected[i];
+        }
+        check(same, "k-d tree knn query " + std::to_string(q));
+        tree.radiusSearch(query, radius, found);
+        check(found.size() == inRadius, "k-d tree radius query " + std::to_string(q));
+
+        grid.knn(query, k, found);
+        same = found.size() == k;
+        for (size_t i = 0; same && i < k; ++i) {
+            same = found[i].distanceSquared == expected[i];
+        }
+        check(same, "grid knn query " + std::to_string(q));
+        grid.radiusSearch(query, radius, found);
+        check(found.size() == inRadius, "grid radius query " + std::to_string(q));
+    }
+}
+
+// ---- 凸包 ----
+
+void checkConvexHull(std::mt19937& rng) {
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<Vector3> points;
+    // 立方体の角と、その内側の点
+    for (int corner = 0; corner < 8; ++corner) {
+        points.push_back(Vector3(corner & 1 ? 2.0f : -2.0f, corner & 2 ? 2.0f : -2.0f, corner & 4 ? 2.0f : -2.0f));
+    }
+    for (int i = 0; i < 500; ++i) {
+        points.push_back(Vector3(uniform(rng), uniform(rng), uniform(rng)));
+    }
+    ConvexHull hull = quickhull(points);
+    check(hull.vertices.size() == 8 && hull.triangleCount() == 12, "hull of a cube has 8 vertices and 12 triangles");
+
+    // 球面上の点はすべて凸包の頂点になる
+    points.clear();
+    for (int i = 0; i < 300; ++i) {
+        Vector3 p(uniform(rng), uniform(rng), uniform(rng));
+        points.push_back(p.normalize());
+    }
+    for (int i = 0; i < 300; ++i) {
+        points.push_back(Vector3(uniform(rng), uniform(rng), uniform(rng)) * 0.5f);
+    }
+    hull = quickhull(points);
+    // どの入力点も、どの面の外側 (orient3d < 0) にも無い
+    bool inside = true;
+    for (size_t t = 0; t < hull.triangleCount() && inside; ++t) {
+        const Vector3& a = hull.vertices[hull.indices[t * 3]];
+        const Vector3& b = hull.vertices[hull.indices[t * 3 + 1]];
+        const Vector3& c = hull.vertices[hull.indices[t * 3 + 2]];
+        for (const Vector3& p : points) {
+            if (orient3d(a, b, c, p) < 0) {
+                inside = false;
+                break;
+            }
+        }
+    }
+    check(inside, "every point is inside every hull face");
+    // 閉じた三角形分割なら V - E + F = 2 (E = 3F / 2)
+    check(hull.vertices.size() * 2 == hull.triangleCount() + 4, "hull is a closed triangulation");
+    bool sourcesMatch = hull.sourceIndices.size() == hull.vertices.size();
+    for (size_t i = 0; sourcesMatch && i < hull.vertices.size(); ++i) {
+        sourcesMatch = distanceSquared(points[hull.sourceIndices[i]], hull.vertices[i]) == 0.0f;
+    }
+    check(sourcesMatch, "hull source indices");
+}
+
+// ---- Morton順 ----
+
+void checkMorton(std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> cell(0, 1023);
+    bool codesMatch = true;
+    for (int i = 0; i < 1000; ++i) {
+        const uint32_t q[3] = {cell(rng), cell(rng), cell(rng)};
+        // 1ビットずつx, y, zの順に並べる
+        uint32_t expected = 0;
+        for (int bit = 9; bit >= 0; --bit) {
+            for (int axis = 0; axis < 3; ++axis) {
+                expected = (expected << 1) | ((q[axis] >> bit) & 1u);
+            }
+        }
+        // セルの中央の座標を渡す
+        const uint32_t code = mortonCode30((q[0] + 0.5f) / 1024.0f, (q[1] + 0.5f) / 1024.0f, (q[2] + 0.5f) / 1024.0f);
+        codesMatch = codesMatch && code == expected;
+    }
+    check(codesMatch, "mortonCode30 matches bit-by-bit interleaving");
+
+    // 基数ソートは安定ソートと同じ順序になる (同じキーが多く、並列のチャンクをまたぐ大きさで)
+    std::uniform_int_distribution<uint64_t> key(0, (uint64_t(1) << 40) - 1);
+    for (unsigned keyBits : {12u, 30u, 40u}) {
+        std::vector<uint64_t> keys(40000);
+        for (uint64_t& k : keys) {
+            k = key(rng) & ((uint64_t(1) << keyBits) - 1);
+            // 重複を作るために下位をそろえる
+            k &= ~uint64_t(7);
+        }
+        std::vector<uint32_t> expected(keys.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            expected[i] = static_cast<uint32_t>(i);
+        }
+        std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+        std::vector<uint32_t> order;
+        radixSortOrder(keys.data(), keys.size(), keyBits, order);
+        check(order == expected, "radixSortOrder with " + std::to_string(keyBits) + " bits");
+
+        // その場の並べ替えは、コピーして並べた結果と同じ
+        std::vector<uint64_t> permuted = keys;
+        permuteInPlace(permuted, order);
+        bool same = true;
+        for (size_t i = 0; same && i < keys.size(); ++i) {
+            same = permuted[i] == keys[order[i]];
+        }
+        check(same, "permuteInPlace with " + std::to_string(keyBits) + " bits");
+    }
+}
+
+// ---- 3x3の特異値分解 ----
+
+float determinant(const Matrix3& m) {
+    return m.m[0][0] * (m.m[1][1] * m.m[2][2] - m.m[1][2] * m.m[2][1]) -
+           m.m[0][1] * (m.m[1][0] * m.m[2][2] - m.m[1][2] * m.m[2][0]) +
+           m.m[0][2] * (m.m[1][0] * m.m[2][1] - m.m[1][1] * m.m[2][0]);
+}
+
+float maxAbsDifference(const Matrix3& a, const Matrix3& b) {
+    float difference = 0;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            difference = std::max(difference, std::fabs(a.m[i][j] - b.m[i][j]));
+        }
+    }
+    return difference;
+}
+
+void checkSvd3(std::mt19937& rng) {
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    const Matrix3 identity(1, 0, 0, 0, 1, 0, 0, 0, 1);
+    for (int i = 0; i < 200; ++i) {
+        Matrix3 a;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                a.m[r][c] = uniform(rng);
+            }
+        }
+        const Svd3 svd = svd3(a);
+        const Matrix3 sigma(svd.sigma.x, 0, 0, 0, svd.sigma.y, 0, 0, 0, svd.sigma.z);
+        const Matrix3 reconstructed = svd.u * sigma * svd.v.transpose();
+        const std::string name = "svd3 matrix " + std::to_string(i);
+        check(maxAbsDifference(reconstructed, a) < 1e-4f, name + " reconstructs");
+        check(maxAbsDifference(svd.u * svd.u.transpose(), identity) < 1e-4f &&
+                  maxAbsDifference(svd.v * svd.v.transpose(), identity) < 1e-4f,
+              name + " is orthonormal");
+        check(std::fabs(determinant(svd.u) - 1) < 1e-4f && std::fabs(determinant(svd.v) - 1) < 1e-4f,
+              name + " has rotations");
+        check(svd.sigma.x >= svd.sigma.y && svd.sigma.y >= std::fabs(svd.sigma.z) &&
+                  (svd.sigma.z < 0) == (determinant(a) < 0),
+              name + " orders singular values");
+        // 特異値の積は行列式
+        check(std::fabs(svd.sigma.x * svd.sigma.y * svd.sigma.z - determinant(a)) < 1e-4f,
+              name + " singular values multiply to the determinant");
+    }
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(12345);
+    checkConjugateGradient(rng);
+    checkNeighbors(rng);
+    checkConvexHull(rng);
+    checkMorton(rng);
+    checkSvd3(rng);
+    if (failures == 0) {
+        std::printf("math brute force checks: ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+// OBJとPLY (ASCII/バイナリ) を書き出して読み戻し、同じ三角形リストになるかを確かめる
+#include "ModelImporter.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 四角形1つ (扇形に2三角形) と三角形1つの5頂点
+const float POSITIONS[5][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {0.5f, 0.5f, 2}};
+const uint8_t COLORS[5][3] = {{255, 0, 0}, {0, 255, 0}, {0, 0, 255}, {255, 255, 0}, {51, 102, 153}};
+const std::vector<std::vector<int>> FACES = {{0, 1, 2, 3}, {1, 4, 2}};
+
+MeshBatch expectedBatch() {
+    MeshBatch batch;
+    for (const std::vector<int>& face : FACES) {
+        for (size_t i = 2; i < face.size(); ++i) {
+            for (int v : {face[0], face[i - 1], face[i]}) {
+                for (int k = 0; k < 3; ++k) {
+                    batch.vertices.push_back(POSITIONS[v][k]);
+                    batch.colors.push_back(COLORS[v][k] / 255.0f);
+                }
+            }
+        }
+    }
+    return batch;
+}
+
+template <class T>
+void writeValue(std::ofstream& out, T value, bool bigEndian) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (bigEndian) {
+        for (size_t i = 0; i < sizeof(T) / 2; ++i) {
+            std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+        }
+    }
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(T));
+}
+
+void writeObj(const std::string& path) {
+    std::ofstream out(path);
+    for (int v = 0; v < 5; ++v) {
+        out << "v " << POSITIONS[v][0] << ' ' << POSITIONS[v][1] << ' ' << POSITIONS[v][2] << ' '
+            << COLORS[v][0] / 255.0f << ' ' << COLORS[v][1] / 255.0f << ' ' << COLORS[v][2] / 255.0f << '\n';
+    }
+    for (const std::vector<int>& face : FACES) {
+        out << 'f';
+        for (int v : face) {
+            out << ' ' << v + 1;
+        }
+        out << '\n';
+    }
+}
+
+// vertexListがtrueなら頂点要素にリストのプロパティを加える (可変長レコードになる)
+void writePly(const std::string& path, const char* format, bool vertexList) {
+    const bool ascii = std::strcmp(format, "ascii") == 0;
+    const bool bigEndian = std::strcmp(format, "binary_big_endian") == 0;
+    std::ofstream out(path, std::ios::binary);
+    out << "ply\nformat " << format << " 1.0\nelement vertex 5\n"
+        << "property float x\nproperty float y\nproperty float z\n";
+    if (vertexList) {
+        out << "property list uchar int extra\n";
+    }
+    out << "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+        << "element face " << FACES.size() << "\nproperty list uchar int vertex_indices\nend_header\n";
+    for (int v = 0; v < 5; ++v) {
+        if (ascii) {
+            out << POSITIONS[v][0] << ' ' << POSITIONS[v][1] << ' ' << POSITIONS[v][2];
+            if (vertexList) {
+                out << " 2 7 8";
+            }
+            out << ' ' << int(COLORS[v][0]) << ' ' << int(COLORS[v][1]) << ' ' << int(COLORS[v][2]) << '\n';
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            writeValue(out, POSITIONS[v][k], bigEndian);
+        }
+        if (vertexList) {
+            writeValue(out, uint8_t(2), bigEndian);
+            writeValue(out, int32_t(7), bigEndian);
+            writeValue(out, int32_t(8), bigEndian);
+        }
+        for (int k = 0; k < 3; ++k) {
+            writeValue(out, COLORS[v][k], bigEndian);
+        }
+    }
+    for (const std::vector<int>& face : FACES) {
+        if (ascii) {
+            out << face.size();
+            for (int v : face) {
+                out << ' ' << v;
+            }
+            out << '\n';
+            continue;
+        }
+        writeValue(out, static_cast<uint8_t>(face.size()), bigEndian);
+        for (int v : face) {
+            writeValue(out, int32_t(v), bigEndian);
+        }
+    }
+}
+
+// ブロックをまたぐ大きなOBJ。先頭の面は最後の頂点を前方参照し、最後の行は改行で終わらない
+void writeLargeObj(const std::string& path, MeshBatch& expected) {
+    const int size = 60;
+    const int vertexCount = size * size;
+    auto position = [size](int v, int k) {
+        const int x = v % size;
+        const int y = v / size;
+        return static_cast<float>(k == 0 ? x : k == 1 ? y : (x * y) % 7);
+    };
+    auto color = [](int v, int k) { return static_cast<float>((v * 3 + k) % 256) / 255.0f; };
+    std::vector<std::array<int, 3>> triangles;
+    triangles.push_back({vertexCount - 3, vertexCount - 2, vertexCount - 1});
+    for (int y = 0; y + 1 < size; ++y) {
+        for (int x = 0; x + 1 < size; ++x) {
+            const int a = y * size + x;
+            triangles.push_back({a, a + 1, a + size + 1});
+            triangles.push_back({a, a + size + 1, a + size});
+        }
+    }
+
+    std::ofstream out(path);
+    const std::array<int, 3>& forward = triangles.front();
+    out << "f " << forward[0] + 1 << ' ' << forward[1] + 1 << ' ' << forward[2] + 1 << '\n';
+    for (int v = 0; v < vertexCount; ++v) {
+        out << "v " << position(v, 0) << ' ' << position(v, 1) << ' ' << position(v, 2) << ' ' << color(v, 0) << ' '
+            << color(v, 1) << ' ' << color(v, 2) << '\n';
+    }
+    // 四角形として書き、扇形の三角形化で上の2三角形に戻ることも確かめる
+    for (size_t t = 1; t < triangles.size(); t += 2) {
+        out << (t == 1 ? "" : "\n") << "f " << triangles[t][0] + 1 << ' ' << triangles[t][1] + 1 << ' '
+            << triangles[t][2] + 1 << ' ' << triangles[t + 1][2] + 1;
+    }
+
+    for (const std::array<int, 3>& triangle : triangles) {
+        for (int v : triangle) {
+            for (int k = 0; k < 3; ++k) {
+                expected.vertices.push_back(position(v, k));
+                expected.colors.push_back(color(v, k));
+            }
+        }
+    }
+}
+
+// 三角形の並び順によらずに比べるため、位置と色を三角形ごとにまとめて並べ替える
+std::vector<std::array<GLfloat, 18>> sortedTriangles(const MeshBatch& batch) {
+    std::vector<std::array<GLfloat, 18>> triangles(batch.vertices.size() / 9);
+    for (size_t t = 0; t < triangles.size(); ++t) {
+        std::copy(&batch.vertices[t * 9], &batch.vertices[t * 9] + 9, triangles[t].begin());
+        if (batch.colors.size() == batch.vertices.size()) {
+            std::copy(&batch.colors[t * 9], &batch.colors[t * 9] + 9, triangles[t].begin() + 9);
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+bool matches(const std::vector<GLfloat>& actual, const std::vector<GLfloat>& expected) {
+    if (actual.size() != expected.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < actual.size(); ++i) {
+        if (std::fabs(actual[i] - expected[i]) > 1e-5f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const MeshBatch expected = expectedBatch();
+    struct Case {
+        std::string name;
+        const char* plyFormat; // nullptrならOBJ
+        bool vertexList;
+    };
+    const Case cases[] = {
+        {"geoalgo_check.obj", nullptr, false},
+        {"geoalgo_check_ascii.ply", "ascii", false},
+        {"geoalgo_check_ascii_list.ply", "ascii", true},
+        {"geoalgo_check_le.ply", "binary_little_endian", false},
+        {"geoalgo_check_le_list.ply", "binary_little_endian", true},
+        {"geoalgo_check_be.ply", "binary_big_endian", false},
+        {"geoalgo_check_be_list.ply", "binary_big_endian", true},
+    };
+
+    int failures = 0;
+    for (const Case& c : cases) {
+        const std::string path = (directory / c.name).string();
+        if (c.plyFormat == nullptr) {
+            writeObj(path);
+        } else {
+            writePly(path, c.plyFormat, c.vertexList);
+        }
+        for (unsigned threads : {1u, 4u}) {
+            ImportOptions options;
+            options.threadCount = threads;
+            try {
+                const MeshBatch batch = importModel(path, options);
+                if (!matches(batch.vertices, expected.vertices) || !matches(batch.colors, expected.colors)) {
+                    std::printf("FAIL %s (threads %u): decoded mesh differs\n", c.name.c_str(), threads);
+                    ++failures;
+                }
+            } catch (const std::exception& e) {
+                std::printf("FAIL %s (threads %u): %s\n", c.name.c_str(), threads, e.what());
+                ++failures;
+            }
+        }
+        std::filesystem::remove(path);
+    }
+    // 1ブロックに収まらないOBJ (小さなブロックで何度も読む場合と、1ブロックを複数チャンクに分ける場合)
+    const std::string largePath = (directory / "geoalgo_check_large.obj").string();
+    MeshBatch largeExpected;
+    writeLargeObj(largePath, largeExpected);
+    const std::vector<std::array<GLfloat, 18>> expectedTriangles = sortedTriangles(largeExpected);
+    for (size_t blockSize : {size_t(4) << 10, ImportOptions().blockSize}) {
+        for (unsigned threads : {1u, 4u}) {
+            ImportOptions options;
+            options.threadCount = threads;
+            options.blockSize = blockSize;
+            try {
+                const std::vector<std::array<GLfloat, 18>> triangles = sortedTriangles(importModel(largePath, options));
+                bool same = triangles.size() == expectedTriangles.size();
+                for (size_t t = 0; same && t < triangles.size(); ++t) {
+                    for (int i = 0; same && i < 18; ++i) {
+                        same = std::fabs(triangles[t][i] - expectedTriangles[t][i]) <= 1e-5f;
+                    }
+                }
+                if (!same) {
+                    std::printf("FAIL large OBJ (block %zu, threads %u): decoded mesh differs\n", blockSize, threads);
+                    ++failures;
+                }
+            } catch (const std::exception& e) {
+                std::printf("FAIL large OBJ (block %zu, threads %u): %s\n", blockSize, threads, e.what());
+                ++failures;
+            }
+        }
+    }
+    std::filesystem::remove(largePath);
+
+    if (failures == 0) {
+        std::printf("model importer round trip: ok\n");
+    }
+    return failures == 0 ? 0 : 1;
+}